@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "assoc.h"
+
+static uint64_t bucket_of(const assoc_t *a, uint64_t key) {
+  return ((key * 0x9e3779b97f4a7c15ULL) >> 17) & a->bucketMask;
+}
+
+// removes `entry` from the doubly linked list starting at *head (and ending at *tail, if given)
+static void list_unlink(assoc_t *a, int32_t *head, int32_t *tail, int entry) {
+  assoc_entry_t *e = &a->entries[entry];
+  if (e->prev != ASSOC_NONE) {
+    a->entries[e->prev].next = e->next;
+  } else {
+    *head = e->next;
+  }
+  if (e->next != ASSOC_NONE) {
+    a->entries[e->next].prev = e->prev;
+  } else if (tail != NULL) {
+    *tail = e->prev;
+  }
+}
+
+static void list_push(assoc_t *a, int32_t *head, int32_t *tail, int entry) {
+  assoc_entry_t *e = &a->entries[entry];
+  e->prev = ASSOC_NONE;
+  e->next = *head;
+  if (*head != ASSOC_NONE) {
+    a->entries[*head].prev = entry;
+  } else if (tail != NULL) {
+    *tail = entry;
+  }
+  *head = entry;
+}
+
+static void chain_unlink(assoc_t *a, int entry) {
+  int32_t *link = &a->buckets[bucket_of(a, a->entries[entry].key)];
+  while (*link != entry) {
+    link = &a->entries[*link].chain;
+  }
+  *link = a->entries[entry].chain;
+}
+
+void assoc_init(assoc_t *a, int capacity) {
+  assert(capacity > 0);
+  uint64_t buckets = 1;
+  while (buckets < 2 * (uint64_t)capacity) {
+    buckets <<= 1;
+  }
+  a->entries = malloc(capacity * sizeof(assoc_entry_t));
+  a->buckets = malloc(buckets * sizeof(int32_t));
+  assert(a->entries != NULL && a->buckets != NULL);
+  a->bucketMask = buckets - 1;
+  a->capacity = capacity;
+  a->count = 0;
+  a->head = a->tail = ASSOC_NONE;
+  a->free = ASSOC_NONE;
+  for (uint64_t b = 0; b < buckets; b++) {
+    a->buckets[b] = ASSOC_NONE;
+  }
+  for (int i = capacity - 1; i >= 0; i--) {  // entry 0 is handed out first
+    a->entries[i].used = false;
+    a->entries[i].chain = ASSOC_NONE;
+    list_push(a, &a->free, NULL, i);
+  }
+}
+
+int assoc_find(const assoc_t *a, uint64_t key) {
+  int32_t i = a->buckets[bucket_of(a, key)];
+  while (i != ASSOC_NONE && a->entries[i].key != key) {
+    i = a->entries[i].chain;
+  }
+  return i;
+}
+
+int assoc_free_entry(const assoc_t *a) {
+  return a->free;
+}
+
+int assoc_lru(const assoc_t *a) {
+  return a->tail;
+}
+
+void assoc_touch(assoc_t *a, int entry) {
+  assert(a->entries[entry].used);
+  if (a->head != entry) {
+    list_unlink(a, &a->head, &a->tail, entry);
+    list_push(a, &a->head, &a->tail, entry);
+  }
+}
+
+void assoc_set(assoc_t *a, int entry, uint64_t key) {
+  assoc_entry_t *e = &a->entries[entry];
+  if (e->used) {
+    chain_unlink(a, entry);
+    list_unlink(a, &a->head, &a->tail, entry);
+  } else {
+    list_unlink(a, &a->free, NULL, entry);
+    e->used = true;
+    a->count++;
+  }
+  uint64_t b = bucket_of(a, key);
+  e->key = key;
+  e->chain = a->buckets[b];
+  a->buckets[b] = entry;
+  list_push(a, &a->head, &a->tail, entry);
+}
+
+void assoc_remove(assoc_t *a, int entry) {
+  assoc_entry_t *e = &a->entries[entry];
+  assert(e->used);
+  chain_unlink(a, entry);
+  list_unlink(a, &a->head, &a->tail, entry);
+  e->used = false;
+  e->chain = ASSOC_NONE;
+  a->count--;
+  list_push(a, &a->free, NULL, entry);
+}
+
+void assoc_free(assoc_t *a) {
+  free(a->entries);
+  free(a->buckets);
+  a->entries = NULL;
+  a->buckets = NULL;
+}
@@ -0,0 +1,78 @@
+#ifndef __ASSOC_H__
+#define __ASSOC_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Fully associative table: a hash map from key to entry plus an intrusive LRU
+/// list, so lookup, recency update and eviction are O(1) at any capacity. The
+/// caller keeps its payload (lines, translations, ...) in an array indexed by
+/// entry, like the ways of a set.
+///////////////////////////////////////////////////////////////////////////////
+
+#define ASSOC_NONE (-1)
+
+typedef struct
+{
+  uint64_t key;
+  int32_t prev;   // towards the most recently used entry (LRU list) or the free list head
+  int32_t next;   // towards the least recently used entry, or the next free entry
+  int32_t chain;  // next entry in the same hash bucket
+  bool used;
+}assoc_entry_t;
+
+typedef struct assoc
+{
+  assoc_entry_t *entries;
+  int32_t *buckets;     // first entry of every bucket
+  uint64_t bucketMask;  // buckets - 1, a power of two at least twice the capacity
+  int capacity;
+  int count;
+  int32_t head;         // most recently used
+  int32_t tail;         // least recently used
+  int32_t free;         // first unused entry
+}assoc_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * starts an empty table of `capacity` entries, numbered 0 to capacity-1
+ **/
+void assoc_init(assoc_t *a, int capacity);
+
+/**
+ * output : the entry holding `key`, ASSOC_NONE if none
+ **/
+int assoc_find(const assoc_t *a, uint64_t key);
+
+/**
+ * output : an unused entry, ASSOC_NONE if the table is full
+ **/
+int assoc_free_entry(const assoc_t *a);
+
+/**
+ * output : the least recently used entry, ASSOC_NONE if the table is empty
+ **/
+int assoc_lru(const assoc_t *a);
+
+/**
+ * makes `entry` the most recently used one
+ **/
+void assoc_touch(assoc_t *a, int entry);
+
+/**
+ * binds `entry` (unused, or replacing its key) to `key` as the most recently used one
+ **/
+void assoc_set(assoc_t *a, int entry, uint64_t key);
+
+/**
+ * unbinds `entry`, which becomes unused
+ **/
+void assoc_remove(assoc_t *a, int entry);
+
+void assoc_free(assoc_t *a);
+
+#endif // __ASSOC_H__
@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include "cache.h"
+#include "belady.h"
+
+void belady_record(belady_trace_t *trace, unsigned long long address, int type) {
+  if (trace->count == trace->capacity) {
+    trace->capacity = trace->capacity ? 2 * trace->capacity : 4096;
+    trace->addrs = realloc(trace->addrs, trace->capacity * sizeof(*trace->addrs));
+    trace->types = realloc(trace->types, trace->capacity * sizeof(*trace->types));
+    assert(trace->addrs != NULL && trace->types != NULL);
+  }
+  trace->addrs[trace->count] = address;
+  trace->types[trace->count] = type;
+  trace->count++;
+}
+
+/* For every access, the index of the next access to the same block (BELADY_NEVER if
+ * there is none). Walks the trace backwards with an open-addressing table from block
+ * to the most recent index seen.
+ */
+static unsigned long long *next_uses(const belady_trace_t *trace, int blockBits) {
+  size_t slots = 1;
+  while (slots < 2 * trace->count) {
+    slots <<= 1;
+  }
+  unsigned long long *blocks = malloc(slots * sizeof(*blocks));
+  unsigned long long *last = malloc(slots * sizeof(*last));
+  unsigned long long *next = malloc((trace->count + 1) * sizeof(*next));
+  assert(blocks != NULL && last != NULL && next != NULL);
+  for (size_t s = 0; s < slots; s++) {
+    last[s] = BELADY_NEVER;  // free slot
+  }
+
+  for (size_t i = trace->count; i-- > 0;) {
+    unsigned long long block = trace->addrs[i] >> blockBits;
+    size_t s = (block * 0x9e3779b97f4a7c15ULL) >> 32 & (slots - 1);
+    while (last[s] != BELADY_NEVER && blocks[s] != block) {
+      s = (s + 1) & (slots - 1);
+    }
+    next[i] = last[s];
+    blocks[s] = block;
+    last[s] = i;
+  }
+  free(blocks);
+  free(last);
+  return next;
+}
+
+unsigned long long belady_replay(const belady_trace_t *trace, const Cache *config, bool opt) {
+  Cache cache;
+  cache_config(&cache, config->setBits, config->linesPerSet, config->blockBits,
+               opt ? REPLACE_OPT : config->policy, config->hitLatency);
+  cache.writeBack = config->writeBack;
+  cache.writeAllocate = config->writeAllocate;
+  cacheSetUp(&cache, "OPT");
+
+  unsigned long long *next = opt ? next_uses(trace, cache.blockBits) : NULL;
+  for (size_t i = 0; i < trace->count; i++) {
+    if (opt) {
+      cache.next_use = next[i];
+    }
+    accessCache(trace->addrs[i], trace->types[i], &cache);
+  }
+
+  free(next);
+  deallocate(&cache);
+  return cache.miss_count;
+}
+
+void belady_free(belady_trace_t *trace) {
+  free(trace->addrs);
+  free(trace->types);
+  trace->addrs = NULL;
+  trace->types = NULL;
+  trace->count = trace->capacity = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef __BELADY_H__
+#define __BELADY_H__
+
+#include "cache.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BELADY_NEVER (~0ULL)  // next use of a block that is not accessed again
+
+// data accesses in the order the L1D saw them
+typedef struct
+{
+  unsigned long long *addrs;
+  unsigned char *types;       // access_enum
+  size_t count;
+  size_t capacity;
+}belady_trace_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * appends one access (CACHE_READ or CACHE_WRITE) to the trace, growing it as needed
+ **/
+void belady_record(belady_trace_t *trace, unsigned long long address, int type);
+
+/**
+ * replays the trace through a fresh, unconnected cache with the geometry and write policy
+ * of `config`: under its own replacement policy, or under Belady's MIN when `opt` is true.
+ * output : misses of the replay
+ **/
+unsigned long long belady_replay(const belady_trace_t *trace, const Cache *config, bool opt);
+
+void belady_free(belady_trace_t *trace);
+
+#endif // __BELADY_H__
@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bus.h"
+
+bool bus_init(bus_t *bus, int bytesPerCycle, uint64_t window) {
+  if (bytesPerCycle < 1 || window < 1) {
+    return false;
+  }
+  memset(bus, 0, sizeof(*bus));
+  bus->bytesPerCycle = bytesPerCycle;
+  bus->window = window;
+  return true;
+}
+
+// the sample of the window holding `cycle`, adding the windows up to it
+static bus_window_t *sample_at(bus_t *bus, uint64_t cycle) {
+  int index = cycle / bus->window;
+  if (index >= bus->sampleCapacity) {
+    int capacity = bus->sampleCapacity ? bus->sampleCapacity : 64;
+    while (capacity <= index) {
+      capacity *= 2;
+    }
+    bus->samples = realloc(bus->samples, capacity * sizeof(bus_window_t));
+    assert(bus->samples != NULL);
+    memset(&bus->samples[bus->sampleCapacity], 0, (capacity - bus->sampleCapacity) * sizeof(bus_window_t));
+    bus->sampleCapacity = capacity;
+  }
+  if (index >= bus->sampleCount) {
+    bus->sampleCount = index + 1;
+  }
+  return &bus->samples[index];
+}
+
+uint64_t bus_transfer(bus_t *bus, int kind, unsigned int bytes, uint64_t now) {
+  // the transfers still queued or on the bus when this one arrives
+  while (bus->outstanding > 0 && bus->ends[bus->head] <= now) {
+    bus->head = (bus->head + 1) % BUS_TRACKED;
+    bus->outstanding--;
+  }
+  bus->occupancy += bus->outstanding;
+  if (bus->outstanding > bus->max_occupancy) {
+    bus->max_occupancy = bus->outstanding;
+  }
+
+  uint64_t cycles = (bytes + bus->bytesPerCycle - 1) / bus->bytesPerCycle;
+  uint64_t start = (bus->busFree > now) ? bus->busFree : now;
+  uint64_t end = start + cycles;
+  bus->busFree = end;
+  if (bus->outstanding == BUS_TRACKED) {  // only the most recent ones are counted
+    bus->head = (bus->head + 1) % BUS_TRACKED;
+    bus->outstanding--;
+  }
+  bus->ends[(bus->head + bus->outstanding++) % BUS_TRACKED] = end;
+
+  bus->transfers[kind]++;
+  bus->bytes[kind] += bytes;
+  bus->wait[kind] += start - now;
+  bus->busy += cycles;
+  bus_window_t *sample = sample_at(bus, start);
+  sample->bytes += bytes;
+  sample->busy += cycles;
+  sample->transfers[kind]++;
+  return end;
+}
+
+void bus_free(bus_t *bus) {
+  free(bus->samples);
+  bus->samples = NULL;
+}
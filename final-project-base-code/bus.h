@@ -0,0 +1,78 @@
+#ifndef __BUS_H__
+#define __BUS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Memory bus between the lowest cache level and memory, shared by fills,
+/// writebacks and prefetches. It moves `bytesPerCycle` bytes per cycle and
+/// serves its request queue in order, so a transfer waits for every one
+/// queued ahead of it: the more transfers outstanding when a request
+/// arrives, the longer it takes. Bandwidth is also kept per window of time.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BUS_BYTES_PER_CYCLE
+#define BUS_BYTES_PER_CYCLE 8
+#endif
+#ifndef BUS_WINDOW
+#define BUS_WINDOW 100000     // cycles per bandwidth sample
+#endif
+#define BUS_WORD_BYTES 4      // a write-through carries one word
+#define BUS_TRACKED 64        // outstanding transfers counted for the occupancy
+#define BUS_BAR_WIDTH 40      // width of a fully used window in the timeline
+
+enum bus_kind_enum {
+  BUS_FILL = 0,       // demand miss data from memory
+  BUS_WRITEBACK = 1,  // dirty victims and write-throughs to memory
+  BUS_PREFETCH = 2,   // prefetched blocks from memory
+  BUS_KINDS = 3
+};
+
+typedef struct
+{
+  uint64_t bytes;
+  uint64_t busy;                // cycles spent transferring
+  uint64_t transfers[BUS_KINDS];
+}bus_window_t;
+
+typedef struct bus
+{
+  int bytesPerCycle;
+  uint64_t window;              // cycles per sample
+  uint64_t busFree;             // cycle the last queued transfer ends
+  uint64_t ends[BUS_TRACKED];   // end of the outstanding transfers, oldest first (a ring)
+  int head;
+  int outstanding;
+
+  uint64_t transfers[BUS_KINDS];
+  uint64_t bytes[BUS_KINDS];
+  uint64_t wait[BUS_KINDS];     // cycles spent queued behind other transfers
+  uint64_t busy;
+  uint64_t occupancy;           // sum of the transfers outstanding at every arrival
+  int max_occupancy;
+
+  bus_window_t *samples;        // one per window, up to the last transfer
+  int sampleCount;
+  int sampleCapacity;
+}bus_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * an idle bus of `bytesPerCycle` bytes per cycle, sampled every `window` cycles
+ * output : false unless both are positive
+ **/
+bool bus_init(bus_t *bus, int bytesPerCycle, uint64_t window);
+
+/**
+ * queues a transfer (bus_kind_enum) of `bytes` bytes that is ready at cycle `now`
+ * output : the cycle its last byte is across
+ **/
+uint64_t bus_transfer(bus_t *bus, int kind, unsigned int bytes, uint64_t now);
+
+void bus_free(bus_t *bus);
+
+#endif // __BUS_H__
@@ -1,4 +1,9 @@
 #include "cache.h"
+#include "prefetch.h"
+#include "profile.h"
+#include "assoc.h"
+#include "dram.h"
+#include "bus.h"
 #include "dogfault.h"
 #include <assert.h>
 #include <ctype.h>
@@ -8,6 +13,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 // DO NOT MODIFY THIS FILE. INVOKE AFTER EACH ACCESS FROM runTrace
 void print_result(result r) {
@@ -20,60 +28,550 @@ void print_result(result r) {
     printf(" [status: miss, insert_block: 0x%llx]", r.insert_block_addr);
 }
 
-/* This is the entry point to operate the cache for a given address in the trace file.
+/* This is the entry point to operate the cache for a given address in the trace file,
+ * once cache_lookup has made its single pass over the set of the address.
  * First, is increments the global lru_clock in the corresponding cache set for the address.
- * Second, it checks if the address is already in the cache using the "probe_cache" function.
- * If yes, it is a cache hit:
- *     1) call the "hit_cacheline" function to update the counters inside the hit cache 
+ * If the lookup found the address, it is a cache hit:
+ *     1) call the "touch_way" function to update the counters inside the hit cache
  *        line, including its lru_clock and access_counter.
  *     2) record a hit status in the return "result" struct and update hit_count 
  * Otherwise, it is a cache miss:
- *     1) call the "insert_cacheline" function, trying to find an empty cache line in the
- *        cache set and insert the address into the empty line. 
- *     2) if the "insert_cacheline" function returns true, record a miss status and the
-          inserted block address in the return "result" struct and update miss_count
- *     3) otherwise, if the "insert_cacheline" function returns false:
- *          a) call the "victim_cacheline" function to figure which victim cache line to 
- *             replace based on the cache replacement policy (LRU and LFU).
- *          b) call the "replace_cacheline" function to replace the victim cache line with
+ *     1) if the lookup found an empty cache line in the set, call the "fill_way" function
+ *        to insert the address into it, record a miss status and the inserted block
+ *        address in the return "result" struct and update miss_count
+ *     2) otherwise:
+ *          a) the caller has chosen the `victim` way with the "victim_way" function,
+ *             based on the cache replacement policy.
+ *          b) call the "fill_way" function to replace the victim cache line with
  *             the new cache line to insert.
  *          c) record an eviction status, the victim block address, and the inserted block
  *             address in the return "result" struct. Update miss_count and eviction_count.
+ * *way is the way that holds the address afterwards.
  */
 
+static void touch_way(Cache *cache, const unsigned long long set_index, int way);
+static void fill_way(Cache *cache, const unsigned long long set_index, int way, const unsigned long long address);
+static int victim_way(const Cache *cache, const unsigned long long set_index);
+static bool victim_take(Cache *cache, const unsigned long long block, bool *dirty);
+
 // Student 1
-result operateCache(const unsigned long long address, Cache *cache) {
-  Set *set = &cache->sets[cache_set(address, cache)];
+static result demand_access(const Lookup *l, int victim, const unsigned long long address, Cache *cache, int *way) {
+  Set *set = &cache->sets[l->set];
   set->lru_clock += 1; //global lru clock
   result r; // result status of hit or miss
 
-  if (probe_cache(address, cache) == true) { // If cache is found and to be true, updates hit_cacheline function, returns hit status and upcounts hit_count
-    hit_cacheline(address, cache);
+  if (l->way >= 0) { // If cache is found, updates the hit line, returns hit status and upcounts hit_count
+    touch_way(cache, l->set, l->way);
     r.status = CACHE_HIT;
     cache->hit_count += 1;
+    *way = l->way;
     return r;
   }
-  else { // If false, tries to find an empty cache line in the cache set
-    if (insert_cacheline(address, cache) == true) { // if insert in cacheline is true, status is cache_miss and add 1 to miss count
-      r.status = CACHE_MISS;
-      r.insert_block_addr = address_to_block(address, cache);
-      cache->miss_count += 1;
-      return r;
+  else if (l->free_way >= 0) { // if there is an empty line, status is cache_miss and add 1 to miss count
+    fill_way(cache, l->set, l->free_way, address);
+    r.status = CACHE_MISS;
+    r.insert_block_addr = address_to_block(address, cache);
+    cache->miss_count += 1;
+    *way = l->free_way;
+    return r;
+  }
+  else {
+    r.victim_block_addr = set->lines[victim].block_addr;
+    fill_way(cache, l->set, victim, address); // replaces block address
+    r.status = CACHE_EVICT; // record eviction status
+    r.insert_block_addr = address_to_block(address, cache);
+    cache->eviction_count += 1;  // adds 1 eviction count
+    cache->miss_count += 1;
+    *way = victim;
+    return r;
+  }
+}
+
+// data of `block` read from memory at cycle `issued`, then across the bus; returns the cycle it is in
+static unsigned long long memory_read(Cache *cache, const unsigned long long block, unsigned long long issued) {
+  unsigned long long ready = issued + MEM_LATENCY;
+  if (cache->dram != NULL) {
+    ready = dram_access(cache->dram, block, DRAM_READ, issued);
+  }
+  if (cache->bus != NULL) {
+    ready = bus_transfer(cache->bus, cache->prefetching ? BUS_PREFETCH : BUS_FILL, 1U << cache->blockBits, ready);
+  }
+  return ready;
+}
+
+// `bytes` at `block` sent across the bus to memory at cache->now; returns the cycles the
+// write holds up the access that caused it: a DRAM queues it, the fixed memory does not
+static unsigned long long memory_write(Cache *cache, const unsigned long long block, unsigned int bytes) {
+  unsigned long long sent = cache->now;
+  if (cache->bus != NULL) {
+    sent = bus_transfer(cache->bus, BUS_WRITEBACK, bytes, sent);
+  }
+  if (cache->dram != NULL) {
+    return dram_access(cache->dram, block, DRAM_WRITE, sent) - sent;
+  }
+  return (sent - cache->now) + CACHE_OTHER_LATENCY;
+}
+
+// sends a write that this level does not keep to the level below (or memory). A word
+// that allocates a block there has the rest of the block read from further below first;
+// the writer does not wait for it, but the traffic is counted. An exclusive level below
+// only takes blocks evicted from above, so unless it already holds the block the word
+// goes past it.
+static void write_lower(const unsigned long long address, Cache *cache) {
+  cache->write_throughs += 1;
+  if (cache->next != NULL && cache->next->inclusion == CACHE_EXCLUSIVE && find_cacheline(address, cache->next) == NULL) {
+    cache->next->now = cache->now + cache->hitLatency;
+    write_lower(address, cache->next);
+  } else if (cache->next != NULL) {
+    cache->next->now = cache->now + cache->hitLatency;
+    result r = accessCache(address, CACHE_WRITE, cache->next);
+    if (r.status == CACHE_MISS || r.status == CACHE_EVICT) {
+      cache->next->prefetching = false;
+      cache_miss_latency(address, cache->next);
+    }
+  } else if (cache->dram != NULL || cache->bus != NULL) {
+    memory_write(cache, address_to_block(address, cache), BUS_WORD_BYTES);
+  }
+}
+
+/* Demand read or write, with the write policy and the attached prefetcher, if any:
+ *     1) a write miss without write-allocate is sent to the level below and does not
+ *        fill the cache (CACHE_MISS_NO_ALLOCATE), unless the victim cache holds the block:
+ *        it then moves back into the set as in 6) and the write updates it there.
+ *     2) a fill that evicts a dirty line writes it back; writeback_latency is the time
+ *        that adds to the miss.
+ *     3) a write marks the line dirty (write-back) or is also sent to the level below
+ *        (write-through).
+ *     4) the first demand hit on a prefetched line counts as a useful prefetch, and as
+ *        a late one if the fill is still in flight; ready_cycle then holds its completion.
+ *     5) a miss found in the prefetch buffer moves the block into the cache and is
+ *        reported as a hit.
+ *     6) a miss found in the victim cache swaps the block with the set's victim and is
+ *        reported as a hit that is ready victimLatency cycles after a normal one.
+ *     7) the prefetcher is trained and issues its prefetches at cache->now.
+ */
+static result demand_or_prefetched(const unsigned long long address, int type, Cache *cache) {
+  prefetcher_t *pf = cache->prefetcher;
+  unsigned long long block = address_to_block(address, cache);
+  unsigned long long ready = 0;
+  bool useful = false;
+  bool victim_dirty = false;
+  bool swapped = false, swapped_dirty = false;
+  int victim = -1, way;
+  result r;
+
+  Lookup l = cache_lookup(address, cache);
+  Set *set = &cache->sets[l.set];
+  if (l.way < 0 && type == CACHE_WRITE && !cache->writeAllocate && cache_victim_find(address, cache) < 0) {
+    if (cache->victimCount > 0) {
+      cache->victim_probes += 1;
     }
-    else {
-      unsigned long long victim = victim_cacheline(address, cache);
-      replace_cacheline(victim, address, cache); // replaces block address
-      r.status = CACHE_EVICT; // record eviction status
-      r.victim_block_addr = victim;
-      r.insert_block_addr = address_to_block(address, cache);
-      cache->eviction_count += 1;  // adds 1 eviction count
+    set->lru_clock += 1;
+    cache->miss_count += 1;
+    cache->write_misses += 1;
+    write_lower(address, cache);
+    r.status = CACHE_MISS_NO_ALLOCATE;
+    r.ready_cycle = 0;
+    r.writeback_latency = 0;
+    return r;
+  }
+
+  if (l.way >= 0) {
+    Line *line = &set->lines[l.way];
+    if (pf != NULL && line->prefetched) {
+      useful = true;
+      ready = line->prefetch_ready;
+    }
+    line->prefetched = false;
+  } else {
+    if (pf != NULL) {
+      useful = prefetch_buffer_take(pf, block, &ready);
+    }
+    if (!useful && cache->victimCount > 0) {
+      swapped = victim_take(cache, block, &swapped_dirty);
+    }
+    if (l.free_way < 0) {
+      victim = victim_way(cache, l.set);
+      victim_dirty = set->lines[victim].dirty;
+      if (pf != NULL && set->lines[victim].prefetched) {
+        pf->unused++; // the demand fill evicts a prefetch nobody used
+      }
+    }
+  }
+
+  r = demand_access(&l, victim, address, cache, &way);
+  r.ready_cycle = 0;
+  r.writeback_latency = 0;
+  if (r.status == CACHE_EVICT) {
+    r.writeback_latency = cache_evicted(cache, r.victim_block_addr, victim_dirty); // takes the freed victim slot on a swap
+  }
+  if (swapped) {
+    r.status = CACHE_HIT;
+    r.ready_cycle = cache->now + cache->hitLatency + cache->victimLatency;
+    cache->miss_count -= 1;
+    cache->hit_count += 1;
+    set->lines[way].dirty = swapped_dirty;
+  }
+  if (r.status != CACHE_HIT && !useful) {
+    if (type == CACHE_WRITE) cache->write_misses += 1;
+    else cache->read_misses += 1;
+  }
+  if (type == CACHE_WRITE) {
+    if (cache->writeBack) {
+      set->lines[way].dirty = true;
+    } else {
+      write_lower(address, cache);
+    }
+  }
+
+  if (pf == NULL) {
+    return r;
+  }
+  if (useful) {
+    pf->useful++;
+    if (ready > cache->now) {
+      pf->late++;
+      r.ready_cycle = ready;
+    }
+    if (r.status != CACHE_HIT) { // served from the prefetch buffer
+      r.status = CACHE_HIT;
+      cache->miss_count -= 1;
+      cache->hit_count += 1;
+    }
+  } else if (r.status != CACHE_HIT) {
+    prefetch_demand_miss(pf, block);
+  }
+
+  prefetch_train(pf, cache, address, useful || r.status != CACHE_HIT);
+  return r;
+}
+
+// demand access as above, then added to the profile, if any, with its final status
+result accessCache(const unsigned long long address, int type, Cache *cache) {
+  result r = demand_or_prefetched(address, type, cache);
+  if (cache->profile != NULL) {
+    profile_access(cache->profile, cache_set(address, cache), address, r.status);
+  }
+  return r;
+}
+
+// a read access, as replayed from the traces
+result operateCache(const unsigned long long address, Cache *cache) {
+  return accessCache(address, CACHE_READ, cache);
+}
+
+// frees the MSHRs whose fill has completed by cycle `now`
+static void mshr_retire(Cache *cache, unsigned long long now) {
+  for (int i = 0; i < cache->mshrCount; i++) {
+    if (cache->mshrs[i].valid && cache->mshrs[i].ready_cycle <= now) {
+      cache->mshrs[i].valid = false;
+    }
+  }
+}
+
+/* Non-blocking access at cycle `now`. The tag array is updated by operateCache when a
+ * miss is sent to memory, so an outstanding block is found in the MSHRs first:
+ *     1) a miss to a block that is still being filled merges onto its MSHR and gets the
+ *        data when the fill completes (miss-under-miss to the same block).
+ *     2) a hit is served after hitLatency even while other fills are in flight
+ *        (hit-under-miss).
+ *     3) a primary miss allocates an MSHR, waiting for the earliest fill to complete if
+ *        all of them are busy, so independent misses overlap up to mshrCount.
+ * With mshrCount == 0 the access is blocking and costs the hit or miss latency.
+ */
+result operateCacheAt(const unsigned long long address, int type, Cache *cache, unsigned long long now) {
+  unsigned long long block = address_to_block(address, cache);
+  result r;
+  cache->now = now;
+
+  if (cache->mshrCount == 0) {
+    r = accessCache(address, type, cache);
+    unsigned long long latency = cache->hitLatency;
+    if (r.status != CACHE_HIT && r.status != CACHE_MISS_NO_ALLOCATE) {
+      latency = cache_miss_latency(address, cache) + r.writeback_latency;
+    }
+    r.ready_cycle = (r.ready_cycle > now + latency) ? r.ready_cycle : now + latency;
+    return r;
+  }
+
+  mshr_retire(cache, now);
+  for (int i = 0; i < cache->mshrCount; i++) {
+    Mshr *mshr = &cache->mshrs[i];
+    if (mshr->valid && mshr->block_addr == block) {
+      hit_cacheline(address, cache);
+      Line *line = find_cacheline(address, cache);
+      if (type == CACHE_WRITE && line != NULL) {
+        line->dirty = cache->writeBack; // written when the fill arrives
+        if (!cache->writeBack) write_lower(address, cache);
+      }
+      mshr->merged += 1;
+      cache->mshr_secondary += 1;
       cache->miss_count += 1;
+      r.status = CACHE_MISS_MERGED;
+      r.insert_block_addr = block;
+      r.ready_cycle = mshr->ready_cycle;
       return r;
     }
   }
+
+  r = accessCache(address, type, cache);
+  if (r.status == CACHE_HIT || r.status == CACHE_MISS_NO_ALLOCATE) {
+    r.ready_cycle = (r.ready_cycle > now + cache->hitLatency) ? r.ready_cycle : now + cache->hitLatency;
+    return r;
+  }
+
+  // primary miss: find a free MSHR, or wait for the earliest fill to complete
+  Mshr *free_mshr = NULL;
+  unsigned long long start = now;
+  for (int i = 0; i < cache->mshrCount; i++) {
+    if (!cache->mshrs[i].valid) {
+      free_mshr = &cache->mshrs[i];
+      break;
+    }
+    if (free_mshr == NULL || cache->mshrs[i].ready_cycle < free_mshr->ready_cycle) {
+      free_mshr = &cache->mshrs[i];
+    }
+  }
+  if (free_mshr->valid) {
+    start = free_mshr->ready_cycle;
+    cache->mshr_full_stalls += start - now;
+  }
+
+  cache->now = start; // the fill is requested once it has an MSHR
+  r.ready_cycle = start + cache_miss_latency(address, cache) + r.writeback_latency;
+  free_mshr->valid = true;
+  free_mshr->block_addr = block;
+  free_mshr->ready_cycle = r.ready_cycle;
+  free_mshr->merged = 0;
+
+  // memory-level parallelism: fill time over the cycles with any fill outstanding
+  cache->mshr_primary += 1;
+  cache->mshr_miss_cycles += r.ready_cycle - start;
+  if (start >= cache->mshr_busy_until) {
+    cache->mshr_busy_cycles += r.ready_cycle - start;
+  } else if (r.ready_cycle > cache->mshr_busy_until) {
+    cache->mshr_busy_cycles += r.ready_cycle - cache->mshr_busy_until;
+  }
+  if (r.ready_cycle > cache->mshr_busy_until) {
+    cache->mshr_busy_until = r.ready_cycle;
+  }
   return r;
 }
 
+// average number of outstanding fills while at least one is outstanding
+double cache_mlp(const Cache *cache) {
+  if (cache->mshr_busy_cycles == 0) {
+    return 0.0;
+  }
+  return (double)cache->mshr_miss_cycles / cache->mshr_busy_cycles;
+}
+
+// VICTIM CACHE
+
+// entry of the victim cache holding the block of `address`, -1 if none
+int cache_victim_find(const unsigned long long address, const Cache *cache) {
+  if (cache->victimCount == 0) {
+    return -1;
+  }
+  return assoc_find(cache->victimIndex, address_to_block(address, cache));
+}
+
+// looks up a set miss; a hit frees the entry, as its block moves back into the set
+static bool victim_take(Cache *cache, const unsigned long long block, bool *dirty) {
+  cache->victim_probes += 1;
+  int i = cache_victim_find(block, cache);
+  if (i < 0) {
+    return false;
+  }
+  cache->victim_hits += 1;
+  cache->victims[i].valid = false;
+  assoc_remove(cache->victimIndex, i);
+  *dirty = cache->victims[i].dirty;
+  return true;
+}
+
+// keeps a block evicted from the sets in a free entry or in place of the least recently
+// inserted one; returns true with *block and *dirty replaced by that one if it was displaced
+static bool victim_put(Cache *cache, unsigned long long *block, bool *dirty) {
+  int i = assoc_free_entry(cache->victimIndex);
+  if (i < 0) {
+    i = assoc_lru(cache->victimIndex);  // entries are never touched, so this is the oldest
+  }
+  VictimLine *slot = &cache->victims[i];
+  VictimLine old = *slot;
+  slot->valid = true;
+  slot->block_addr = *block;
+  slot->dirty = *dirty;
+  assoc_set(cache->victimIndex, i, *block);
+  if (old.valid) {
+    cache->victim_evictions += 1;
+    *block = old.block_addr;
+    *dirty = old.dirty;
+  }
+  return old.valid;
+}
+
+// MULTI-LEVEL HIERARCHY
+
+// makes `lower` the level `upper` sends its misses to
+void cache_connect(Cache *upper, Cache *lower) {
+  assert(lower->upperCount < CACHE_MAX_UPPER);
+  upper->next = lower;
+  lower->upper[lower->upperCount++] = upper;
+}
+
+// invalidates the line holding `address`, if any
+static bool invalidate_cacheline(const unsigned long long address, Cache *cache) {
+  Lookup l = cache_lookup(address, cache);
+  if (l.way < 0) {
+    return false;
+  }
+  Line *line = &cache->sets[l.set].lines[l.way];
+  cache->tags[l.set * cache->tagStride + l.way] = CACHE_TAG_INVALID;
+  if (cache->index != NULL) {
+    assoc_remove(cache->index, l.way);
+  }
+  line->valid = false;
+  line->prefetched = false;
+  line->dirty = false;
+  return true;
+}
+
+// drops the block holding `address` from this level only, from the sets or the victim
+// cache; a dirty copy goes out with the invalidation. Returns true if the level held it
+bool cache_invalidate(const unsigned long long address, Cache *cache) {
+  Line *line = find_cacheline(address, cache);
+  if (line != NULL && line->dirty) {
+    cache->writebacks += 1;
+  }
+  if (invalidate_cacheline(address, cache)) {
+    return true;
+  }
+  int v = cache_victim_find(address, cache);
+  if (v >= 0) {
+    cache->writebacks += cache->victims[v].dirty;
+    cache->victims[v].valid = false;
+    assoc_remove(cache->victimIndex, v);
+    return true;
+  }
+  return false;
+}
+
+// invalidates every line of the levels above `cache` that overlaps `block`
+static void back_invalidate(Cache *cache, Cache *origin, const unsigned long long block) {
+  unsigned long long end = block + (1ULL << origin->blockBits);
+  for (int u = 0; u < cache->upperCount; u++) {
+    Cache *upper = cache->upper[u];
+    for (unsigned long long a = address_to_block(block, upper); a < end; a += (1ULL << upper->blockBits)) {
+      if (cache_invalidate(a, upper)) {
+        origin->back_invalidations += 1;
+      }
+    }
+    back_invalidate(upper, origin, block);
+  }
+}
+
+// installs a block evicted from the level above into an exclusive level
+static void exclusive_fill(Cache *cache, const unsigned long long block, bool dirty) {
+  Line *line = find_cacheline(block, cache);
+  if (line == NULL) {
+    cache->sets[cache_set(block, cache)].lru_clock += 1;
+    bool victim_dirty = false;
+    if (!insert_cacheline(block, cache)) {
+      unsigned long long victim = victim_cacheline(block, cache);
+      victim_dirty = find_cacheline(victim, cache)->dirty;
+      replace_cacheline(victim, block, cache);
+      cache->eviction_count += 1;
+      cache_evicted(cache, victim, victim_dirty);
+    }
+    line = find_cacheline(block, cache);
+  }
+  line->dirty = line->dirty || dirty;
+}
+
+/* A block left `cache` through replacement:
+ *     0) with a victim cache, the block is kept there instead, and it is the block
+ *        displaced from the victim cache, if any, that leaves the level below.
+ *     1) an inclusive level back-invalidates the block in every level above it.
+ *     2) an exclusive level below receives the block as its victim fill.
+ *     3) otherwise a dirty block is written back to the level below, or to memory
+ *        at CACHE_OTHER_LATENCY. The DRAM model queues it instead, and the miss only
+ *        waits when the write queue is full. Either way it crosses the bus first.
+ * Returns the cycles the writeback adds to the miss that caused the eviction.
+ */
+unsigned long long cache_evicted(Cache *cache, unsigned long long victim_block_addr, bool dirty) {
+  if (cache->victimCount > 0 && !victim_put(cache, &victim_block_addr, &dirty)) {
+    return 0;
+  }
+  if (cache->inclusion == CACHE_INCLUSIVE) {
+    back_invalidate(cache, cache, victim_block_addr);
+  }
+  if (cache->next != NULL && cache->next->inclusion == CACHE_EXCLUSIVE) {
+    exclusive_fill(cache->next, victim_block_addr, dirty);
+    return dirty ? cache->next->hitLatency : 0;
+  }
+  if (!dirty) {
+    return 0;
+  }
+
+  cache->writebacks += 1;
+  if (cache->next != NULL) {
+    accessCache(victim_block_addr, CACHE_WRITE, cache->next);
+    return cache->next->hitLatency;
+  }
+  return memory_write(cache, victim_block_addr, 1U << cache->blockBits);
+}
+
+// demand lookup at a lower level on behalf of the level above; returns its latency.
+// *dirty is set when an exclusive level hands up a dirty block.
+static unsigned long long level_access(const unsigned long long address, Cache *cache, bool *dirty) {
+  if (cache->inclusion == CACHE_EXCLUSIVE) {
+    Line *line = find_cacheline(address, cache);
+    if (line != NULL) {
+      *dirty = line->dirty;
+      invalidate_cacheline(address, cache); // the block moves up
+      cache->hit_count += 1;
+      return cache->hitLatency;
+    }
+    cache->miss_count += 1;
+    cache->read_misses += 1;
+    return cache_miss_latency(address, cache); // not filled here, it arrives when the level above evicts it
+  }
+
+  result r = operateCache(address, cache);
+  if (r.status == CACHE_HIT) {
+    return cache->hitLatency;
+  }
+  return cache_miss_latency(address, cache) + r.writeback_latency;
+}
+
+// cycles to bring the block of `address` into `cache` from the levels below (or memory).
+// The request leaves this level after its lookup, which is when the level below sees it.
+unsigned long long cache_miss_latency(const unsigned long long address, Cache *cache) {
+  if (cache->next == NULL) {
+    return memory_read(cache, address_to_block(address, cache), cache->now + cache->hitLatency) - cache->now;
+  }
+
+  bool dirty = false;
+  cache->next->now = cache->now + cache->hitLatency;
+  cache->next->prefetching = cache->prefetching;
+  unsigned long long latency = cache->hitLatency + level_access(address, cache->next, &dirty);
+  Line *line = find_cacheline(address, cache);
+  if (dirty && line != NULL) {
+    line->dirty = true;
+  }
+  return latency;
+}
+
+// average memory access time seen by `cache`, from the hit rates of it and the levels below
+double cache_amat(const Cache *cache) {
+  unsigned long long accesses = cache->hit_count + cache->miss_count;
+  double miss_rate = accesses ? (double)cache->miss_count / accesses : 0.0;
+  double miss_penalty = (cache->next != NULL) ? cache_amat(cache->next)
+                        : (cache->dram != NULL) ? dram_read_latency(cache->dram) : MEM_LATENCY;
+  return cache->hitLatency + miss_rate * miss_penalty;
+}
+
 // HELPER FUNCTIONS USEFUL FOR IMPLEMENTING THE CACHE
 // Given an address, return the block (aligned) address,
 // i.e., byte offset bits are cleared to 0
@@ -94,80 +592,159 @@ unsigned long long cache_set(const unsigned long long address, const Cache *cach
   return ((address >> cache->blockBits) & ((1 << cache->setBits) - 1)); // return address masked at the last s bits
 }
 
+typedef unsigned long long tag_vector_t __attribute__((vector_size(CACHE_TAG_LANES * sizeof(unsigned long long))));
+typedef long long tag_mask_t __attribute__((vector_size(CACHE_TAG_LANES * sizeof(long long))));
+
+// one bit per lane of a vector compare
+static inline unsigned lane_bits(const tag_mask_t *m) {
+#ifdef __AVX2__
+  return _mm256_movemask_pd((__m256d)*m);
+#else
+  unsigned bits = 0;
+  for (int lane = 0; lane < CACHE_TAG_LANES; lane++) {
+    bits |= (unsigned)((*m)[lane] & 1) << lane;
+  }
+  return bits;
+#endif
+}
+
+// compares `chunks` vectors of a tag row at once; inlined with a constant `chunks`
+// for the common associativities
+static inline __attribute__((always_inline))
+void lookup_row(const unsigned long long *row, int chunks, Lookup *l) {
+  tag_vector_t want = (tag_vector_t){0} + l->tag;
+  tag_vector_t invalid = (tag_vector_t){0} + CACHE_TAG_INVALID;
+  for (int c = 0; c < chunks; c++) {
+    tag_vector_t tags = *(const tag_vector_t *)(row + c * CACHE_TAG_LANES);
+    tag_mask_t hits = (tags == want);
+    tag_mask_t frees = (tags == invalid);
+    unsigned hit = lane_bits(&hits);
+    if (hit) {
+      l->way = c * CACHE_TAG_LANES + __builtin_ctz(hit);
+      return;
+    }
+    unsigned free = lane_bits(&frees);
+    if (free && l->free_way < 0) {
+      l->free_way = c * CACHE_TAG_LANES + __builtin_ctz(free);
+    }
+  }
+}
+
+/* Single pass over the set of `address`: the tags of a set are contiguous (cache->tags),
+ * so all of its ways are compared with a few vector compares, which also find the
+ * first invalid way for a fill. The set index and tag are computed once and returned.
+ * A level with a hash index (cache->index) finds the way in O(1) instead, and any
+ * invalid way may be the one filled.
+ */
+Lookup cache_lookup(const unsigned long long address, const Cache *cache) {
+  Lookup l;
+  l.set = cache_set(address, cache);
+  l.tag = cache_tag(address, cache);
+  l.way = -1;
+  l.free_way = -1;
+  if (cache->index != NULL) {
+    l.way = assoc_find(cache->index, l.tag);
+    l.free_way = (l.way < 0) ? assoc_free_entry(cache->index) : -1;
+    return l;
+  }
+  const unsigned long long *row = &cache->tags[l.set * cache->tagStride];
+  switch (cache->tagStride / CACHE_TAG_LANES) {
+    case 1:  lookup_row(row, 1, &l); break;  // up to 4 ways
+    case 2:  lookup_row(row, 2, &l); break;  // 8 ways
+    case 4:  lookup_row(row, 4, &l); break;  // 16 ways
+    default: lookup_row(row, cache->tagStride / CACHE_TAG_LANES, &l); break;
+  }
+  return l;
+}
+
 // Check if the address is found in the cache. If so, return true. else return false.
 // Student 2
 bool probe_cache(const unsigned long long address, const Cache *cache) {
-  unsigned long long localTag = cache_tag(address, cache);
-  Set *set = &cache->sets[cache_set(address, cache)]; // get the set that the address is in
+  return cache_lookup(address, cache).way >= 0;
+}
 
-  for (int i = 0; i < cache->linesPerSet; i++) {
-    if (set->lines[i].valid && (set->lines[i].tag == localTag)) {
-      return true;
-    }
+// Return the valid line holding the address, or NULL if it is not in the cache.
+Line *find_cacheline(const unsigned long long address, Cache *cache) {
+  Lookup l = cache_lookup(address, cache);
+  return (l.way >= 0) ? &cache->sets[l.set].lines[l.way] : NULL;
+}
+
+// Update the LRU (least recently used) or LFU (least frequently used) counters of a hit
+// line, and the state of the other replacement policies.
+static void touch_way(Cache *cache, const unsigned long long set_index, int way) {
+  Set *set = &cache->sets[set_index];
+  Line *line = &set->lines[way];
+  line->lru_clock = set->lru_clock;
+  line->access_counter += 1;
+  if (cache->index != NULL) {
+    assoc_touch(cache->index, way);
   }
-  return false;
+  replace_update(cache, set_index, way, false);
 }
 
 // Access address in cache. Called only if probe is successful.
-// Update the LRU (least recently used) or LFU (least frequently used) counters.
 // Student 1
 void hit_cacheline(const unsigned long long address, Cache *cache){
-  Set *set = &cache->sets[cache_set(address, cache)];
-  unsigned long long localTag = cache_tag(address, cache);
-
-  for (int i = 0; i < cache->linesPerSet; i++) {
-    Line *line = &set->lines[i];
-    if (line->valid && (line->tag == cache_tag(address, cache))) {
-      line->lru_clock = set->lru_clock;
-      line->access_counter += 1;
-      return;
-    }
+  Lookup l = cache_lookup(address, cache);
+  if (l.way >= 0) {
+    touch_way(cache, l.set, l.way);
+  }
+}
+
+// Insert the block of the address into the line at `way`, marking it valid. The line's
+// lru_clock follows the global lru_clock in the cache set and its access_counter restarts.
+static void fill_way(Cache *cache, const unsigned long long set_index, int way, const unsigned long long address) {
+  Set *set = &cache->sets[set_index];
+  Line *line = &set->lines[way];
+  line->block_addr = address_to_block(address, cache);
+  line->valid = true;
+  line->tag = cache_tag(address, cache);
+  line->lru_clock = set->lru_clock;
+  line->access_counter = 1; // re init the lfu access_counter
+  line->prefetched = false;
+  line->dirty = false;
+  cache->tags[set_index * cache->tagStride + way] = line->tag;
+  if (cache->index != NULL) {
+    assoc_set(cache->index, way, line->tag);
   }
-  return;
- }
+  replace_update(cache, set_index, way, true);
+}
 
 /* This function is only called if probe_cache returns false, i.e., the address is
  * not in the cache. In this function, it will try to find an empty (i.e., invalid)
  * cache line for the address to insert. 
- * If it found an empty one:
- *     1) it inserts the address into that cache line (marking it valid).
- *     2) it updates the cache line's lru_clock based on the global lru_clock 
- *        in the cache set and initiates the cache line's access_counter.
- *     3) it returns true.
+ * If it found an empty one, it inserts the address into that cache line with
+ * "fill_way" and returns true.
  * Otherwise, it returns false.  
  */ 
 
 // Student 1
 bool insert_cacheline(const unsigned long long address, Cache *cache) {
-  unsigned long long localTag = cache_tag(address, cache);
-  unsigned long long localsetIndx = cache_set(address, cache);
-  unsigned long long localBlock = address_to_block(address, cache);
-  Set *set = &cache->sets[localsetIndx];
-
-  for (int i = 0; i < cache->linesPerSet; i++) {
-    Line *line = &set->lines[i];
-    if (!(set->lines[i].valid)) {
-      set->lines[i].block_addr = localBlock;
-      set->lines[i].valid = true; 
-      set->lines[i].tag = localTag;
-      set->lines[i].lru_clock = set->lru_clock;
-      set->lines[i].access_counter = 1;
-      return true;
-    }
+  Lookup l = cache_lookup(address, cache);
+  if (l.way >= 0 || l.free_way < 0) {
+    return false;
   }
-  return false;
+  fill_way(cache, l.set, l.free_way, address);
+  return true;
 }
 
 // If there is no empty cacheline, this method figures out which cacheline to replace
-// depending on the cache replacement policy (LRU and LFU). It returns the block address
-// of the victim cacheline; note we no longer have access to the full address of the victim
+// depending on the cache replacement policy (LRU and LFU here, the others in replace.c).
+// It returns the way of the victim cacheline.
 
 // Student 2
-unsigned long long victim_cacheline(const unsigned long long address, const Cache *cache) {
-  Set *set = &cache->sets[cache_set(address, cache)]; // select the set with the address of the victim
+static int victim_way(const Cache *cache, const unsigned long long set_index) {
+  Set *set = &cache->sets[set_index]; // select the set with the address of the victim
   Line *victim = &set->lines[0]; // set as the current "best" victim
 
-  if (cache->lfu == 0) {
+  if (cache->policy > REPLACE_LFU) {
+    return replace_victim(cache, set_index);
+  }
+  if (cache->index != NULL && cache->policy == REPLACE_LRU) {
+    return assoc_lru(cache->index);  // the tail of the recency list, instead of a scan
+  }
+
+  if (cache->policy == REPLACE_LRU) {
     for (int i = 0; i < cache->linesPerSet; i++) {
       if (set->lines[i].valid && (set->lines[i].lru_clock < victim->lru_clock)) {
         // LRU policy
@@ -176,7 +753,7 @@ unsigned long long victim_cacheline(const unsigned long long address, const Cach
     }
   }
 
-  if (cache->lfu == 1) {
+  if (cache->policy == REPLACE_LFU) {
     for (int i = 0; i < cache->linesPerSet; i++) {
       if (set->lines[i].valid && (set->lines[i].access_counter < victim->access_counter)) {
         // LFU policy
@@ -191,30 +768,48 @@ unsigned long long victim_cacheline(const unsigned long long address, const Cach
       }
     }
   }
-  return victim->block_addr;
+  return victim - set->lines;
+}
+
+// Returns the block address of the victim cacheline; note we no longer have access to
+// the full address of the victim
+unsigned long long victim_cacheline(const unsigned long long address, const Cache *cache) {
+  unsigned long long set_index = cache_set(address, cache);
+  return cache->sets[set_index].lines[victim_way(cache, set_index)].block_addr;
 }
 
 
 /* Replace the victim cacheline with the new address to insert. Note for the victim cachline,
  * we only have its block address. For the new address to be inserted, we have its full address.
- * Remember to update the new cache line's lru_clock based on the global lru_clock in the cache
- * set and initiate the cache line's access_counter.
  */
 // Student 2
 void replace_cacheline(const unsigned long long victim_block_addr, const unsigned long long insert_addr, Cache *cache) {
-  Set *set = &cache->sets[cache_set(insert_addr, cache)];
-
-  for (int i = 0; i < cache->linesPerSet; i++) {
-    if ((set->lines[i].valid) && set->lines[i].block_addr == victim_block_addr) {
-      set->lines[i].block_addr = address_to_block(insert_addr, cache);
-      set->lines[i].lru_clock = set->lru_clock;
-      set->lines[i].tag = cache_tag(insert_addr, cache);
-      set->lines[i].access_counter = 1; // re init the lfu access_counter
-      break;
-    } 
+  Lookup l = cache_lookup(victim_block_addr, cache);
+  if (l.way >= 0) {
+    fill_way(cache, l.set, l.way, insert_addr);
   }
 }
 
+// geometry, replacement policy and hit latency of a cache level; every other field is
+// cleared, so the level starts out blocking, without a prefetcher or victim cache and unconnected.
+// cacheSetUp then allocates it.
+void cache_config(Cache *cache, int setBits, int linesPerSet, int blockBits, int policy, int hitLatency) {
+  memset(cache, 0, sizeof(*cache));
+  cache->setBits = setBits;
+  cache->linesPerSet = linesPerSet;
+  cache->blockBits = blockBits;
+  cache->policy = policy;
+  cache->hitLatency = hitLatency;
+  cache->displayTrace = CACHE_DISPLAY_TRACE;
+  cache->mshrCount = 0;
+  cache->victimCount = 0;
+  cache->victimLatency = CACHE_VICTIM_LATENCY;
+  cache->prefetcher = NULL;
+  cache->inclusion = CACHE_NON_INCLUSIVE;
+  cache->writeBack = CACHE_WRITE_BACK;
+  cache->writeAllocate = CACHE_WRITE_ALLOCATE;
+}
+
 // allocate the memory space for the cache with the given cache parameters
 // and initialize the cache sets and lines.
 // Initialize the cache name to the given name
@@ -228,13 +823,20 @@ void cacheSetUp(Cache *cache, char *name) {
 
 
   cache->sets = malloc(sizeof(Set) * s); //Allocate the memory for the sets
+  cache->lineStore = malloc(sizeof(Line) * s * cache->linesPerSet); //and for the lines of all of them
+  cache->tagStride = (cache->linesPerSet + CACHE_TAG_LANES - 1) / CACHE_TAG_LANES * CACHE_TAG_LANES;
+  cache->tags = aligned_alloc(sizeof(tag_vector_t), sizeof(unsigned long long) * s * cache->tagStride);
+  assert(cache->sets != NULL && cache->lineStore != NULL && cache->tags != NULL);
 
   for (int i = 0; i < s; i++) {
     Set *set = &cache->sets[i];
-    set->lines = malloc(sizeof(Line) * cache->linesPerSet); //Allocate memory for each lines
+    set->lines = &cache->lineStore[i * cache->linesPerSet];
 
     set->lru_clock = 0;
 
+    for (int j = 0; j < cache->tagStride; j++) {
+      cache->tags[i * cache->tagStride + j] = (j < cache->linesPerSet) ? CACHE_TAG_INVALID : CACHE_TAG_PAD;
+    }
     for (int j = 0; j < cache->linesPerSet; j++) {
       Line *line = &set->lines[j];
       line->valid = false;
@@ -242,20 +844,77 @@ void cacheSetUp(Cache *cache, char *name) {
       line->block_addr = 0;
       line->lru_clock = 0;
       line->access_counter = 0;
+      line->prefetched = false;
+      line->prefetch_ready = 0;
+      line->next_use = 0;
+      line->dirty = false;
     }
   }
   cache->name = name;
+  replace_init(cache);
+
+  // the index gives up the first-invalid-way fill order, which PLRU, RRIP and random depend on
+  cache->index = NULL;
+  if (cache->setBits == 0 && cache->linesPerSet >= CACHE_INDEX_MIN_WAYS &&
+      (cache->policy <= REPLACE_LFU || cache->policy == REPLACE_OPT)) {
+    cache->index = malloc(sizeof(assoc_t));
+    assert(cache->index != NULL);
+    assoc_init(cache->index, cache->linesPerSet);
+  }
+
+  cache->mshrs = NULL;
+  if (cache->mshrCount > 0) {
+    cache->mshrs = calloc(cache->mshrCount, sizeof(Mshr));
+  }
+  cache->mshr_primary = 0;
+  cache->mshr_secondary = 0;
+  cache->mshr_full_stalls = 0;
+  cache->mshr_miss_cycles = 0;
+  cache->mshr_busy_cycles = 0;
+  cache->mshr_busy_until = 0;
+
+  cache->victims = NULL;
+  cache->victimIndex = NULL;
+  if (cache->victimCount > 0) {
+    cache->victims = calloc(cache->victimCount, sizeof(VictimLine));
+    cache->victimIndex = malloc(sizeof(assoc_t));
+    assert(cache->victims != NULL && cache->victimIndex != NULL);
+    assoc_init(cache->victimIndex, cache->victimCount);
+  }
+  cache->victim_probes = 0;
+  cache->victim_hits = 0;
+  cache->victim_evictions = 0;
+  cache->now = 0;
+  cache->pc = 0;
+
+  cache->next = NULL;
+  cache->upperCount = 0;
+  cache->back_invalidations = 0;
+
+  cache->read_misses = 0;
+  cache->write_misses = 0;
+  cache->writebacks = 0;
+  cache->write_throughs = 0;
 }
 
 // deallocate the memory space for the cache
 
 // Student 2
 void deallocate(Cache *cache) {
-  for (int i = 0; i < (1 << cache->setBits); i++) { // number of sets per cache = 2 * setBits
-      free(cache->sets[i].lines); // free all the lines in each set
-  }
+  free(cache->lineStore); // the lines of every set are one allocation
+  free(cache->tags);
   // free all sets in cache:
   free(cache->sets);
+  free(cache->mshrs);
+  free(cache->victims);
+  if (cache->index != NULL) {
+    assoc_free(cache->index);
+    free(cache->index);
+  }
+  if (cache->victimIndex != NULL) {
+    assoc_free(cache->victimIndex);
+    free(cache->victimIndex);
+  }
 }
 
 // print out summary stats for the cache
@@ -12,10 +12,18 @@
 #include <stdio.h>
 #include "utils.h"
 #include "config.h"
+#include "replace.h"
 enum status_enum {
   CACHE_MISS = 0,
   CACHE_HIT = 1,
-  CACHE_EVICT = 2
+  CACHE_EVICT = 2,
+  CACHE_MISS_MERGED = 3, // secondary miss on a block that is already being filled
+  CACHE_MISS_NO_ALLOCATE = 4 // write miss sent to the level below without filling the cache
+};
+
+enum access_enum {
+  CACHE_READ = 0,
+  CACHE_WRITE = 1
 };
 
 #define CACHE_HIT_LATENCY 2    // hit latency
@@ -25,7 +33,89 @@ enum status_enum {
 #define CACHE_LINES_PER_SET 4 // Number of lines per set (associativity)
 #define CACHE_BLOCK_BITS 6 // number of blocks (2^CACHE_BLOCK_BITS)
 #define CACHE_DISPLAY_TRACE false
-#define CACHE_LFU 1 // LRU
+#ifndef CACHE_POLICY
+#define CACHE_POLICY REPLACE_LFU // replace_policy_enum (see replace.h), -R overrides it
+#endif
+#ifndef CACHE_WRITE_BACK
+#define CACHE_WRITE_BACK 1 // 1: write-back with dirty lines, 0: write-through (-W overrides it)
+#endif
+#ifndef CACHE_WRITE_ALLOCATE
+#define CACHE_WRITE_ALLOCATE 1 // 1: write misses fill the cache, 0: they go around it
+#endif
+// instruction cache geometry and policy (independent of the data cache)
+#ifndef ICACHE_SET_BITS
+#define ICACHE_SET_BITS 4
+#endif
+#ifndef ICACHE_LINES_PER_SET
+#define ICACHE_LINES_PER_SET 2
+#endif
+#ifndef ICACHE_BLOCK_BITS
+#define ICACHE_BLOCK_BITS 6
+#endif
+#ifndef ICACHE_POLICY
+#define ICACHE_POLICY REPLACE_LRU
+#endif
+// lower levels, added with -L (unified: both L1s fill from the L2)
+#ifndef L2_SET_BITS
+#define L2_SET_BITS 6
+#endif
+#ifndef L2_LINES_PER_SET
+#define L2_LINES_PER_SET 8
+#endif
+#ifndef L2_BLOCK_BITS
+#define L2_BLOCK_BITS 6
+#endif
+#ifndef L2_POLICY
+#define L2_POLICY REPLACE_LRU
+#endif
+#ifndef L2_HIT_LATENCY
+#define L2_HIT_LATENCY 10
+#endif
+#ifndef LLC_SET_BITS
+#define LLC_SET_BITS 9
+#endif
+#ifndef LLC_LINES_PER_SET
+#define LLC_LINES_PER_SET 16
+#endif
+#ifndef LLC_BLOCK_BITS
+#define LLC_BLOCK_BITS 6
+#endif
+#ifndef LLC_POLICY
+#define LLC_POLICY REPLACE_LRU
+#endif
+#ifndef LLC_HIT_LATENCY
+#define LLC_HIT_LATENCY 30
+#endif
+#define CACHE_MAX_UPPER 4 // caches that fill from one lower level
+
+// how a level's contents relate to the levels above it
+enum inclusion_enum {
+  CACHE_NON_INCLUSIVE = 0, // filled on misses from above, evictions do not affect the levels above
+  CACHE_INCLUSIVE = 1,     // as non-inclusive, and evictions back-invalidate the levels above
+  CACHE_EXCLUSIVE = 2      // holds only blocks evicted from above; a hit moves the block up
+};
+
+#ifndef CACHE_MSHR_COUNT
+#define CACHE_MSHR_COUNT 0 // outstanding misses, 0 is a blocking cache (-M overrides it)
+#endif
+#define CACHE_MSHR_MAX 64
+
+#ifndef CACHE_VICTIM_ENTRIES
+#define CACHE_VICTIM_ENTRIES 0 // fully associative victim cache lines, 0 disables it (-V overrides it)
+#endif
+#ifndef CACHE_VICTIM_LATENCY
+#define CACHE_VICTIM_LATENCY 1 // cycles a victim cache hit adds to the hit latency
+#endif
+#define CACHE_VICTIM_MAX 64
+
+#ifndef CACHE_INDEX_MIN_WAYS
+#define CACHE_INDEX_MIN_WAYS 64 // a fully associative level this wide finds its ways through a hash index
+#endif
+
+// tag rows used by cache_lookup
+#define CACHE_TAG_INVALID (~0ULL)     // tag of an invalid way
+#define CACHE_TAG_PAD (~0ULL - 1)     // tag of the padding after the last way of a row
+#define CACHE_TAG_LANES 4             // tags compared per vector
 
 // Struct definitions
 typedef struct {
@@ -34,41 +124,135 @@ typedef struct {
     unsigned long long block_addr;
     int lru_clock;
     int access_counter;
+    bool dirty;                         // written since the fill, must be written back on eviction
+    bool prefetched;                    // filled by a prefetch and not yet used by a demand access
+    unsigned long long prefetch_ready;  // cycle that prefetch fill completes
+    unsigned long long next_use;        // OPT: index of the next access to the block
 } Line;
 
 typedef struct {
     Line *lines;
     int lru_clock;
+    replace_set_t repl;  // state of the policies that do not scan the lines
 } Set;
 
+// outcome of one pass of cache_lookup over a set
+typedef struct {
+    unsigned long long set;
+    unsigned long long tag;
+    int way;       // way holding the address, -1 on a miss
+    int free_way;  // on a miss, the first invalid way, -1 if the set is full
+} Lookup;
+
+// victim cache line: a block evicted from the sets, kept until it is reused or displaced
 typedef struct {
+    bool valid;
+    bool dirty;
+    unsigned long long block_addr;
+} VictimLine;
+
+// miss status holding register: one outstanding block fill
+typedef struct {
+    bool valid;
+    unsigned long long block_addr;
+    unsigned long long ready_cycle; // cycle the fill completes
+    int merged;                     // secondary misses waiting on this fill
+} Mshr;
+
+typedef struct cache_s {
     Set *sets;
+    Line *lineStore;          // the lines of every set, contiguous
+    unsigned long long *tags; // tag of every way, in rows of tagStride per set (see cache_lookup)
+    int tagStride;            // linesPerSet rounded up to whole vectors of CACHE_TAG_LANES
+    struct assoc *index;      // tag -> way and LRU order of a wide fully associative level, else NULL
     int hit_count;
     int miss_count;
     int eviction_count;
-    int lfu;
+    int policy;          // replace_policy_enum
+    int psel;            // set dueling selector, above half favours BRRIP
+    unsigned int rng;    // random replacement and BRRIP insertion
+    unsigned long long next_use; // OPT: next use of the access in progress, set by the replay
     bool displayTrace;
     int setBits;
     int linesPerSet;
     int blockBits;
     char *name;
+
+    // non-blocking operation, only used when mshrCount > 0
+    Mshr *mshrs;
+    int mshrCount;
+    unsigned long long mshr_primary;      // misses that allocated an MSHR
+    unsigned long long mshr_secondary;    // misses merged onto an outstanding fill
+    unsigned long long mshr_full_stalls;  // cycles a miss waited for a free MSHR
+    unsigned long long mshr_miss_cycles;  // sum of the fill time of every primary miss
+    unsigned long long mshr_busy_cycles;  // cycles with at least one fill outstanding
+    unsigned long long mshr_busy_until;
+
+    // victim cache, only used when victimCount > 0
+    VictimLine *victims;
+    struct assoc *victimIndex;        // block -> entry, oldest entry first out
+    int victimCount;
+    int victimLatency;
+    unsigned long long victim_probes;     // set misses looked up in the victim cache
+    unsigned long long victim_hits;       // found there and swapped back into the set
+    unsigned long long victim_evictions;  // lines displaced from the victim cache, which leave the level
+
+    unsigned long long now;           // cycle of the access in progress, set by operateCacheAt
+    unsigned long long pc;            // PC of the access in progress, 0 if unknown
+    bool prefetching;                 // the fill in progress is a prefetch, set by the prefetcher
+    struct prefetcher *prefetcher;    // NULL disables prefetching (see prefetch.h)
+    struct cache_profile *profile;    // NULL disables the 3C/reuse/heatmap profile (see profile.h)
+
+    // hierarchy, linked with cache_connect
+    int hitLatency;
+    int inclusion;                    // inclusion_enum, relative to the levels above
+    struct cache_s *next;             // level misses are sent to, NULL for memory
+    struct dram *dram;                // memory below the last level, NULL for the fixed MEM_LATENCY (see dram.h)
+    struct bus *bus;                  // bus to that memory, NULL for unlimited bandwidth (see bus.h)
+    struct cache_s *upper[CACHE_MAX_UPPER];
+    int upperCount;
+    unsigned long long back_invalidations; // lines invalidated above because this level evicted them
+
+    // write policy
+    bool writeBack;
+    bool writeAllocate;
+    unsigned long long read_misses;
+    unsigned long long write_misses;
+    unsigned long long writebacks;      // dirty lines written to the level below
+    unsigned long long write_throughs;  // writes sent to the level below without a writeback
 } Cache;
 
 typedef struct {
     int status;
     unsigned long long insert_block_addr;
     unsigned long long victim_block_addr;
+    unsigned long long ready_cycle; // set by operateCacheAt: cycle the data is available
+    unsigned long long writeback_latency; // cycles the writeback of a dirty victim adds to the miss
 } result;
 
 // Function declarations
+void cache_config(Cache *cache, int setBits, int linesPerSet, int blockBits, int policy, int hitLatency);
 void cacheSetUp(Cache *cache, char *name);
 void deallocate(Cache *cache);
+void print_result(result r);
+void printSummary(const Cache *cache);
 result operateCache(const unsigned long long address, Cache *cache);
+result accessCache(const unsigned long long address, int type, Cache *cache);
+result operateCacheAt(const unsigned long long address, int type, Cache *cache, unsigned long long now);
+double cache_mlp(const Cache *cache);
+void cache_connect(Cache *upper, Cache *lower);
+unsigned long long cache_miss_latency(const unsigned long long address, Cache *cache);
+unsigned long long cache_evicted(Cache *cache, unsigned long long victim_block_addr, bool dirty);
+int cache_victim_find(const unsigned long long address, const Cache *cache);
+bool cache_invalidate(const unsigned long long address, Cache *cache);
+double cache_amat(const Cache *cache);
 int processCacheOperation(unsigned long address, Cache *cache);
 unsigned long long address_to_block(const unsigned long long address, const Cache *cache);
 unsigned long long cache_tag(const unsigned long long address, const Cache *cache);
 unsigned long long cache_set(const unsigned long long address, const Cache *cache);
+Lookup cache_lookup(const unsigned long long address, const Cache *cache);
 bool probe_cache(const unsigned long long address, const Cache *cache);
+Line *find_cacheline(const unsigned long long address, Cache *cache);
 void hit_cacheline(const unsigned long long address, Cache *cache);
 bool insert_cacheline(const unsigned long long address, Cache *cache);
 unsigned long long victim_cacheline(const unsigned long long address, const Cache *cache);
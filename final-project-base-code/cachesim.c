@@ -0,0 +1,430 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cache.h"
+#include "replace.h"
+#include "trace.h"
+#include "stackdist.h"
+#include "profile.h"
+#include "sample.h"
+#include "belady.h"
+#include "sweep.h"
+
+/* Trace-driven cache simulator: replays a memory address trace through one cache level
+ * with operateCache/accessCache, without the cycle simulator, and prints printSummary.
+ * With -D it instead computes the LRU stack distances of the trace and prints the
+ * miss-ratio curve of every geometry in one pass. With -S it loads the trace once and
+ * replays it through every combination of the listed parameters on a thread pool.
+ */
+
+#define SWEEP_MAX_VALUES 64  // values per swept parameter
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-hvIH] -s <setBits> -E <lines> -b <blockBits> [-R <policy>] [-V <entries>] [-w <out>] -t <trace>\n", prog);
+  fprintf(stderr, "       %s -k <ratio>[,hash] [-FI] -s <setBits> -E <lines> -b <blockBits> [-R <policy>] -t <trace>\n", prog);
+  fprintf(stderr, "       %s -D [-I] -b <blockBits> -t <trace>\n", prog);
+  fprintf(stderr, "       %s -S [-I] -s <list> -E <list> -b <list> [-R <list>] [-l <list>] [-m <list>] [-j <threads>] [-f csv|json] [-u] -t <trace>\n", prog);
+  fprintf(stderr, "  -s <setBits>   number of set index bits (2^s sets)\n");
+  fprintf(stderr, "  -E <lines>     lines per set (associativity)\n");
+  fprintf(stderr, "  -b <blockBits> number of block bits (2^b bytes per block)\n");
+  fprintf(stderr, "  -R <policy>    lru, lfu, plru, srrip, brrip, drrip or random (default lru)\n");
+  fprintf(stderr, "  -V <entries>   add a fully associative victim cache of <entries> lines\n");
+  fprintf(stderr, "  -t <trace>     lackey or binary trace file\n");
+  fprintf(stderr, "  -I             also replay instruction fetches (skipped by default)\n");
+  fprintf(stderr, "  -w <out>       also write the replayed accesses to <out> in the binary format\n");
+  fprintf(stderr, "  -v             print the result of every access\n");
+  fprintf(stderr, "  -H             also print the 3C miss classes, reuse distances and per-set heatmap\n");
+  fprintf(stderr, "  -D             print the LRU miss-ratio curve of every geometry instead\n");
+  fprintf(stderr, "  -k <ratio>     simulate one in <ratio> sets (every <ratio>th, or chosen by hash) and scale the counts\n");
+  fprintf(stderr, "  -F             with -k, also run the full cache and print the error of the estimate\n");
+  fprintf(stderr, "  -S             sweep: lists are comma separated values or lo:hi ranges, e.g. 1,2,4 or 4:8\n");
+  fprintf(stderr, "  -l, -m <list>  hit and memory latencies for the AMAT column (default %d and %d)\n",
+          CACHE_HIT_LATENCY, MEM_LATENCY);
+  fprintf(stderr, "  -j <threads>   sweep threads (default: online CPUs)\n");
+  fprintf(stderr, "  -f csv|json    sweep output format (default csv)\n");
+  fprintf(stderr, "  -u             sweep every configuration on its own instead of batching them in SIMD lanes\n");
+}
+
+// one access, as the trace runner of the cache assignment printed it in verbose mode
+static void runTrace(Cache *cache, unsigned long long addr, int type, bool verbose) {
+  result r = accessCache(addr, type, cache);
+  if (verbose) {
+    print_result(r);
+  }
+}
+
+// parses "1,2,4", "4:8" or a mix of both into values[]; returns the count, -1 if malformed
+static int parse_list(const char *arg, int *values) {
+  int count = 0;
+  char *copy = strdup(arg);
+  for (char *item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+    char *range = strchr(item, ':');
+    int lo = atoi(item), hi = (range != NULL) ? atoi(range + 1) : lo;
+    if (hi < lo || count + (hi - lo + 1) > SWEEP_MAX_VALUES) {
+      count = -1;
+      break;
+    }
+    for (int v = lo; v <= hi; v++) {
+      values[count++] = v;
+    }
+  }
+  free(copy);
+  return count;
+}
+
+static int parse_policies(const char *arg, int *values) {
+  int count = 0;
+  char *copy = strdup(arg);
+  for (char *item = strtok(copy, ","); item != NULL && count >= 0; item = strtok(NULL, ",")) {
+    values[count] = replace_policy(item);
+    count = (values[count] < 0 || count + 1 > SWEEP_MAX_VALUES) ? -1 : count + 1;
+  }
+  free(copy);
+  return count;
+}
+
+/* Runs every combination of the swept parameters over the trace loaded in memory and
+ * prints one row per combination and latency pair. Latencies only change the AMAT, so
+ * they do not add simulations.
+ */
+static int run_sweep(const belady_trace_t *trace, const char *sets_arg, const char *lines_arg,
+                     const char *blocks_arg, const char *policy_arg, const char *hit_arg,
+                     const char *mem_arg, int threads, bool batch, bool json) {
+  int sets[SWEEP_MAX_VALUES], lines[SWEEP_MAX_VALUES], blocks[SWEEP_MAX_VALUES];
+  int policies[SWEEP_MAX_VALUES], hits[SWEEP_MAX_VALUES], mems[SWEEP_MAX_VALUES];
+  int nsets = parse_list(sets_arg, sets);
+  int nlines = parse_list(lines_arg, lines);
+  int nblocks = parse_list(blocks_arg, blocks);
+  int npolicies = parse_policies(policy_arg, policies);
+  int nhits = parse_list(hit_arg, hits);
+  int nmems = parse_list(mem_arg, mems);
+  if (nsets <= 0 || nlines <= 0 || nblocks <= 0 || npolicies <= 0 || nhits <= 0 || nmems <= 0) {
+    fprintf(stderr, "Bad sweep list\n");
+    return -1;
+  }
+
+  sweep_point_t *points = calloc(nsets * nlines * nblocks * npolicies, sizeof(sweep_point_t));
+  int count = 0;
+  for (int s = 0; s < nsets; s++)
+    for (int e = 0; e < nlines; e++)
+      for (int b = 0; b < nblocks; b++)
+        for (int p = 0; p < npolicies; p++) {
+          if (sets[s] < 0 || lines[e] < 1 || blocks[b] < 0 ||
+              (policies[p] > REPLACE_LFU && lines[e] > REPLACE_MAX_WAYS)) {
+            continue;  // not a valid geometry for this policy
+          }
+          points[count].setBits = sets[s];
+          points[count].linesPerSet = lines[e];
+          points[count].blockBits = blocks[b];
+          points[count].policy = policies[p];
+          count++;
+        }
+
+  sweep_run(points, count, trace, threads, batch);
+
+  if (json) {
+    printf("[\n");
+  } else {
+    printf("sets,ways,block,policy,bytes,hit_latency,mem_latency,accesses,hits,misses,evictions,writebacks,miss_ratio,amat\n");
+  }
+  int rows = count * nhits * nmems, row = 0;
+  for (int i = 0; i < count; i++) {
+    sweep_point_t *pt = &points[i];
+    unsigned long long accesses = pt->hits + pt->misses;
+    double miss_ratio = accesses ? (double)pt->misses / accesses : 0.0;
+    unsigned long long bytes = (unsigned long long)pt->linesPerSet << (pt->setBits + pt->blockBits);
+    for (int h = 0; h < nhits; h++) {
+      for (int m = 0; m < nmems; m++) {
+        double amat = hits[h] + miss_ratio * mems[m];
+        if (json) {
+          printf("  {\"sets\": %d, \"ways\": %d, \"block\": %d, \"policy\": \"%s\", \"bytes\": %llu, "
+                 "\"hit_latency\": %d, \"mem_latency\": %d, \"accesses\": %llu, \"hits\": %llu, "
+                 "\"misses\": %llu, \"evictions\": %llu, \"writebacks\": %llu, \"miss_ratio\": %.6f, "
+                 "\"amat\": %.4f}%s\n",
+                 1 << pt->setBits, pt->linesPerSet, 1 << pt->blockBits, replace_name(pt->policy), bytes,
+                 hits[h], mems[m], accesses, pt->hits, pt->misses, pt->evictions, pt->writebacks,
+                 miss_ratio, amat, (++row < rows) ? "," : "");
+        } else {
+          printf("%d,%d,%d,%s,%llu,%d,%d,%llu,%llu,%llu,%llu,%llu,%.6f,%.4f\n",
+                 1 << pt->setBits, pt->linesPerSet, 1 << pt->blockBits, replace_name(pt->policy), bytes,
+                 hits[h], mems[m], accesses, pt->hits, pt->misses, pt->evictions, pt->writebacks,
+                 miss_ratio, amat);
+        }
+      }
+    }
+  }
+  if (json) {
+    printf("]\n");
+  }
+  free(points);
+  return 0;
+}
+
+/* Set sampling: the accesses to the sampled sets are simulated on a cache of just those
+ * sets; with `full`, the whole cache replays the same accesses for comparison.
+ */
+static int run_sampled(trace_reader_t *reader, FILE *out, bool instructions, int setBits, int lines,
+                       int blockBits, int policy, int ratio, int kind, bool full) {
+  sample_t sample;
+  if (!sample_init(&sample, setBits, lines, blockBits, policy, ratio, kind)) {
+    fprintf(stderr, "Sampling ratio must be a power of two between 1 and the number of sets\n");
+    return -1;
+  }
+  Cache cache;
+  if (full) {
+    cache_config(&cache, setBits, lines, blockBits, policy, CACHE_HIT_LATENCY);
+    cacheSetUp(&cache, "L1");
+  }
+
+  trace_record_t record;
+  while (trace_next(reader, &record)) {
+    if (record.op == TRACE_INSTR && !instructions) {
+      continue;
+    }
+    if (out != NULL) {
+      trace_write_record(out, record.addr, record.size, record.op);
+    }
+    int type = (record.op == TRACE_STORE) ? CACHE_WRITE : CACHE_READ;
+    for (int pass = (record.op == TRACE_MODIFY) ? 0 : 1; pass < 2; pass++) {
+      if (record.op == TRACE_MODIFY) {
+        type = pass ? CACHE_WRITE : CACHE_READ;
+      }
+      sample_access(&sample, record.addr, type);
+      if (full) {
+        accessCache(record.addr, type, &cache);
+      }
+    }
+  }
+
+  sample_print(&sample, full ? &cache : NULL);
+  sample_free(&sample);
+  if (full) {
+    deallocate(&cache);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *sets_arg = NULL, *lines_arg = NULL, *blocks_arg = NULL, *policy_arg = "lru";
+  char hit_default[16], mem_default[16];
+  snprintf(hit_default, sizeof(hit_default), "%d", CACHE_HIT_LATENCY);
+  snprintf(mem_default, sizeof(mem_default), "%d", MEM_LATENCY);
+  const char *hit_arg = hit_default, *mem_arg = mem_default;
+  bool verbose = false, instructions = false, mrc = false, sweep = false, json = false;
+  bool batch = true, profiled = false;
+  int victims = 0, ratio = 0, sample_kind = SAMPLE_STRIDE;
+  bool sample_full = false;
+  int threads = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *trace_path = NULL, *out_path = NULL;
+  int c;
+
+  while ((c = getopt(argc, argv, "hvIDSHuFs:E:b:R:t:w:l:m:j:f:V:k:")) != -1) {
+    switch (c) {
+    case 's':
+      sets_arg = optarg; break;
+    case 'E':
+      lines_arg = optarg; break;
+    case 'b':
+      blocks_arg = optarg; break;
+    case 'R':
+      policy_arg = optarg; break;
+    case 't':
+      trace_path = optarg; break;
+    case 'w':
+      out_path = optarg; break;
+    case 'I':
+      instructions = true; break;
+    case 'v':
+      verbose = true; break;
+    case 'D':
+      mrc = true; break;
+    case 'S':
+      sweep = true; break;
+    case 'u':
+      batch = false; break;
+    case 'H':
+      profiled = true; break;
+    case 'k': {
+      char *kind = strchr(optarg, ',');
+      if (kind != NULL) {
+        *kind++ = '\0';
+        if (strcmp(kind, "hash") != 0 && strcmp(kind, "stride") != 0) {
+          fprintf(stderr, "Set selection must be stride or hash\n");
+          return -1;
+        }
+        sample_kind = (strcmp(kind, "hash") == 0) ? SAMPLE_HASH : SAMPLE_STRIDE;
+      }
+      ratio = atoi(optarg);
+      break;
+    }
+    case 'F':
+      sample_full = true; break;
+    case 'V':
+      victims = atoi(optarg);
+      if (victims < 0 || victims > CACHE_VICTIM_MAX) {
+        fprintf(stderr, "Victim cache entries must be between 0 and %d\n", CACHE_VICTIM_MAX);
+        return -1;
+      }
+      break;
+    case 'l':
+      hit_arg = optarg; break;
+    case 'm':
+      mem_arg = optarg; break;
+    case 'j':
+      threads = atoi(optarg); break;
+    case 'f':
+      json = (strcmp(optarg, "json") == 0);
+      if (!json && strcmp(optarg, "csv") != 0) {
+        fprintf(stderr, "Sweep output format must be csv or json\n");
+        return -1;
+      }
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  if ((!mrc && (sets_arg == NULL || lines_arg == NULL)) || blocks_arg == NULL || trace_path == NULL) {
+    usage(argv[0]);
+    return -1;
+  }
+  int setBits = atoi(sets_arg ? sets_arg : "0"), lines = atoi(lines_arg ? lines_arg : "1");
+  int blockBits = atoi(blocks_arg);
+  int policy = replace_policy(policy_arg);
+  if (!sweep && policy < 0) {
+    fprintf(stderr, "Replacement policy must be lru, lfu, plru, srrip, brrip, drrip or random\n");
+    return -1;
+  }
+  if (!sweep && (setBits < 0 || lines < 1 || blockBits < 0)) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  trace_reader_t reader;
+  if (!trace_open(&reader, trace_path)) {
+    fprintf(stderr, "Cannot read trace %s\n", trace_path);
+    return -1;
+  }
+  FILE *out = NULL;
+  if (out_path != NULL) {
+    out = fopen(out_path, "wb");
+    if (out == NULL) {
+      fprintf(stderr, "Cannot write %s\n", out_path);
+      return -1;
+    }
+    trace_write_header(out);
+  }
+
+  if (sweep) {
+    belady_trace_t trace = {0};
+    trace_record_t record;
+    while (trace_next(&reader, &record)) {
+      if (record.op == TRACE_INSTR && !instructions) {
+        continue;
+      }
+      if (out != NULL) {
+        trace_write_record(out, record.addr, record.size, record.op);
+      }
+      if (record.op == TRACE_MODIFY) {
+        belady_record(&trace, record.addr, CACHE_READ);
+      }
+      belady_record(&trace, record.addr, (record.op == TRACE_STORE || record.op == TRACE_MODIFY) ? CACHE_WRITE : CACHE_READ);
+    }
+    int status = run_sweep(&trace, sets_arg, lines_arg, blocks_arg, policy_arg, hit_arg, mem_arg, threads, batch, json);
+    belady_free(&trace);
+    if (out != NULL) {
+      fclose(out);
+    }
+    trace_close(&reader);
+    return status;
+  }
+
+  if (mrc) {
+    stackdist_t sd;
+    stackdist_init(&sd, blockBits, STACKDIST_MAX_SET_BITS);
+    trace_record_t record;
+    while (trace_next(&reader, &record)) {
+      if (record.op == TRACE_INSTR && !instructions) {
+        continue;
+      }
+      if (out != NULL) {
+        trace_write_record(out, record.addr, record.size, record.op);
+      }
+      if (record.op == TRACE_MODIFY) {
+        stackdist_access(&sd, record.addr);  // the store always hits behind the load
+      }
+      stackdist_access(&sd, record.addr);
+    }
+    stackdist_print(&sd);
+    stackdist_free(&sd);
+    if (out != NULL) {
+      fclose(out);
+    }
+    trace_close(&reader);
+    return 0;
+  }
+
+  if (ratio > 0) {
+    int status = run_sampled(&reader, out, instructions, setBits, lines, blockBits, policy, ratio, sample_kind,
+                             sample_full);
+    if (out != NULL) {
+      fclose(out);
+    }
+    trace_close(&reader);
+    return status;
+  }
+
+  Cache cache;
+  cache_config(&cache, setBits, lines, blockBits, policy, CACHE_HIT_LATENCY);
+  cache.displayTrace = verbose;
+  cache.victimCount = victims;
+  cache_profile_t profile;
+  if (profiled) {
+    profile_init(&profile, setBits, lines, blockBits);
+    cache.profile = &profile;
+  }
+  cacheSetUp(&cache, "L1");
+
+  trace_record_t record;
+  while (trace_next(&reader, &record)) {
+    if (record.op == TRACE_INSTR && !instructions) {
+      continue;
+    }
+    if (out != NULL) {
+      trace_write_record(out, record.addr, record.size, record.op);
+    }
+    if (verbose) {
+      printf("%c %llx,%u", record.op, (unsigned long long)record.addr, record.size);
+    }
+    if (record.op == TRACE_MODIFY) {
+      runTrace(&cache, record.addr, CACHE_READ, verbose);
+      runTrace(&cache, record.addr, CACHE_WRITE, verbose);
+    } else {
+      runTrace(&cache, record.addr, (record.op == TRACE_STORE) ? CACHE_WRITE : CACHE_READ, verbose);
+    }
+    if (verbose) {
+      printf("\n");
+    }
+  }
+
+  printSummary(&cache);
+  if (victims > 0) {
+    printf("%s victim cache hits: %llu of %llu probes, evictions: %llu\n", cache.name, cache.victim_hits,
+           cache.victim_probes, cache.victim_evictions);
+  }
+  if (profiled) {
+    profile_print(&profile, cache.name);
+    profile_free(&profile);
+  }
+  if (out != NULL) {
+    fclose(out);
+  }
+  trace_close(&reader);
+  deallocate(&cache);
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "coherence.h"
+
+void coherence_init(coherence_t *coh, int cores, int blockBits) {
+  assert(cores <= COHERENCE_MAX_CORES);
+  memset(coh, 0, sizeof(*coh));
+  coh->cores = cores;
+  coh->blockBits = blockBits;
+  assoc_init(&coh->map, COHERENCE_DIR_ENTRIES);
+  coh->entries = calloc(COHERENCE_DIR_ENTRIES, sizeof(dir_entry_t));
+  assert(coh->entries != NULL);
+  pthread_mutex_init(&coh->lock, NULL);
+}
+
+// every copy but the one of `self` goes
+static void invalidate_others(coherence_t *coh, dir_entry_t *entry, uint32_t self) {
+  coh->invalidations += __builtin_popcount(entry->sharers & ~self);
+  entry->sharers &= self;
+}
+
+// a new entry for `block`, in place of the least recently used one when the directory is full
+static int allocate(coherence_t *coh, uint64_t block) {
+  int e = assoc_free_entry(&coh->map);
+  if (e == ASSOC_NONE) {
+    e = assoc_lru(&coh->map);
+    coh->evictions++;
+    coh->invalidations += __builtin_popcount(coh->entries[e].sharers);
+  }
+  assoc_set(&coh->map, e, block);
+  coh->entries[e] = (dir_entry_t){MESI_INVALID, 0, 0};
+  return e;
+}
+
+int coherence_access(coherence_t *coh, int core, Cache *l1, uint64_t address, int type) {
+  uint64_t block = address >> coh->blockBits;
+  uint32_t self = 1u << core;
+  int latency = 0;
+
+  pthread_mutex_lock(&coh->lock);
+  int e = assoc_find(&coh->map, block);
+  dir_entry_t *entry = (e != ASSOC_NONE) ? &coh->entries[e] : NULL;
+  bool listed = (entry != NULL) && (entry->sharers & self);
+  bool cached = probe_cache(address, l1) || cache_victim_find(address, l1) >= 0;
+
+  // another core's write or a directory eviction took the copy away
+  if (cached && !listed) {
+    cache_invalidate(address, l1);
+    coh->invalidation_misses[core]++;
+    cached = false;
+  }
+
+  if (cached) {
+    assoc_touch(&coh->map, e);
+    if (type == CACHE_WRITE && entry->state == MESI_SHARED) {
+      coh->upgrades++;
+      invalidate_others(coh, entry, self);
+      latency = COHERENCE_DIR_LATENCY;
+    }
+    if (type == CACHE_WRITE) {
+      entry->state = MESI_MODIFIED;  // E becomes M silently
+      entry->owner = core;
+    }
+  } else {
+    if (entry == NULL) {
+      e = allocate(coh, block);
+      entry = &coh->entries[e];
+    } else {
+      assoc_touch(&coh->map, e);
+      entry->sharers &= ~self;  // our copy was evicted without telling the directory
+      if (entry->sharers == 0) {
+        entry->state = MESI_INVALID;
+      }
+    }
+
+    latency = COHERENCE_DIR_LATENCY;
+    if (entry->state == MESI_EXCLUSIVE || entry->state == MESI_MODIFIED) {
+      coh->forwards++;
+      latency += COHERENCE_FORWARD_LATENCY;
+    }
+    if (type == CACHE_READ) {
+      coh->gets++;
+      coh->owner_writebacks += (entry->state == MESI_MODIFIED);
+      entry->state = (entry->sharers != 0) ? MESI_SHARED : MESI_EXCLUSIVE;
+      entry->sharers |= self;
+    } else {
+      coh->getm++;
+      invalidate_others(coh, entry, self);
+      entry->state = MESI_MODIFIED;
+      entry->sharers = self;
+    }
+    entry->owner = core;  // only read while the state is E or M
+  }
+  pthread_mutex_unlock(&coh->lock);
+  return latency;
+}
+
+uint64_t coherence_invalidation_misses(const coherence_t *coh) {
+  uint64_t misses = 0;
+  for (int c = 0; c < coh->cores; c++) {
+    misses += coh->invalidation_misses[c];
+  }
+  return misses;
+}
+
+void coherence_free(coherence_t *coh) {
+  assoc_free(&coh->map);
+  free(coh->entries);
+  coh->entries = NULL;
+  pthread_mutex_destroy(&coh->lock);
+}
@@ -0,0 +1,88 @@
+#ifndef __COHERENCE_H__
+#define __COHERENCE_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "cache.h"
+#include "assoc.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// MESI directory that keeps the private L1 data caches of the cores of -N
+/// coherent. Every block an L1 may hold has an entry with its state and its
+/// sharers. A core asks the directory on an L1 miss and on a write to a copy
+/// it does not own; the directory invalidates the other copies, or forwards
+/// the request to the owner of an E or M copy. The cores run on their own host
+/// threads and only touch their own L1, so an invalidation takes effect when
+/// its core next accesses the block: the copy is dropped and the access misses
+/// (an invalidation miss). Silent evictions leave stale sharers behind, which
+/// only cost extra invalidations.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef COHERENCE_DIR_ENTRIES
+#define COHERENCE_DIR_ENTRIES 16384  // blocks tracked, evicting one invalidates its copies
+#endif
+#ifndef COHERENCE_DIR_LATENCY
+#define COHERENCE_DIR_LATENCY 20     // request to the directory and its reply
+#endif
+#ifndef COHERENCE_FORWARD_LATENCY
+#define COHERENCE_FORWARD_LATENCY 20 // extra when the owner of an E or M copy has to answer
+#endif
+#define COHERENCE_MAX_CORES 32       // width of the sharer vector
+
+enum mesi_enum {
+  MESI_INVALID = 0,
+  MESI_SHARED = 1,     // clean, possibly in several L1s
+  MESI_EXCLUSIVE = 2,  // clean, in the owner's L1 only
+  MESI_MODIFIED = 3    // dirty, in the owner's L1 only
+};
+
+typedef struct
+{
+  int state;         // mesi_enum
+  uint32_t sharers;  // one bit per core that may hold a copy
+  int owner;         // the core holding the E or M copy
+}dir_entry_t;
+
+typedef struct coherence
+{
+  int cores;
+  int blockBits;
+  assoc_t map;            // block -> entry, least recently used first out
+  dir_entry_t *entries;
+  pthread_mutex_t lock;   // the cores call in from their own threads
+
+  uint64_t gets;               // read misses (GetS)
+  uint64_t getm;               // write misses (GetM)
+  uint64_t upgrades;           // writes to a shared copy
+  uint64_t invalidations;      // copies invalidated for a writer or a directory eviction
+  uint64_t forwards;           // requests forwarded to the owner
+  uint64_t owner_writebacks;   // modified copies written back because another core read them
+  uint64_t evictions;          // directory entries replaced
+  uint64_t invalidation_misses[COHERENCE_MAX_CORES];  // accesses that missed because the copy was invalidated
+}coherence_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * an empty directory for the L1s of `cores` cores, with blocks of 2^blockBits bytes
+ **/
+void coherence_init(coherence_t *coh, int cores, int blockBits);
+
+/**
+ * the coherence actions of an access (CACHE_READ or CACHE_WRITE) by `core` to its L1 `l1`,
+ * made before the access itself; a copy the directory took away is dropped from `l1` first
+ * output : cycles the directory adds to the access, 0 if the L1 already has the permission
+ **/
+int coherence_access(coherence_t *coh, int core, Cache *l1, uint64_t address, int type);
+
+/**
+ * output : the invalidation misses of all the cores
+ **/
+uint64_t coherence_invalidation_misses(const coherence_t *coh);
+
+void coherence_free(coherence_t *coh);
+
+#endif // __COHERENCE_H__
@@ -28,4 +28,7 @@
 #define PRINT_CACHE_TRACES      // prints cache trace for each memory access 
 #define PRINT_CACHE_STATS	// prints the cache stats at the end of program
 
+// optional, not part of any reference trace
+// #define PRINT_STALL_STATS	// breaks #Stalls down by cause (load-use, branch, functional units)
+
 #endif // __CONFIG_H__
@@ -11,11 +11,13 @@ void print_branch(char *, Instruction);
 void print_lui(Instruction);
 void print_jal(Instruction);
 void print_ecall(Instruction);
+void print_atomic(char *, Instruction);
 void write_rtype(Instruction); 
 void write_itype_except_load(Instruction); 
 void write_load(Instruction);
 void write_store(Instruction);
 void write_branch(Instruction);
+void write_atomic(Instruction);
 
 
 void decode_instruction(uint32_t instruction_bits) {
@@ -53,6 +55,9 @@ void decode_instruction(uint32_t instruction_bits) {
         case 0x73:
             print_ecall(instruction);
             break;
+        case 0x2F:
+            write_atomic(instruction);
+            break;
         default: // undefined opcode
             handle_invalid_instruction(instruction);
             break;
@@ -309,6 +314,52 @@ void write_branch(Instruction instruction) {
     }
 }
 
+// RV32A, funct5 in the top bits of funct7 (the aq and rl bits are ignored)
+void write_atomic(Instruction instruction) {
+    if (instruction.rtype.funct3 != 0x2) {
+        handle_invalid_instruction(instruction);
+        return;
+    }
+    switch (instruction.rtype.funct7 >> 2) {
+        case 0x02:
+            printf(LR_FORMAT, "lr.w", instruction.rtype.rd, instruction.rtype.rs1);
+            break;
+        case 0x03:
+            print_atomic("sc.w", instruction);
+            break;
+        case 0x01:
+            print_atomic("amoswap.w", instruction);
+            break;
+        case 0x00:
+            print_atomic("amoadd.w", instruction);
+            break;
+        case 0x04:
+            print_atomic("amoxor.w", instruction);
+            break;
+        case 0x0C:
+            print_atomic("amoand.w", instruction);
+            break;
+        case 0x08:
+            print_atomic("amoor.w", instruction);
+            break;
+        case 0x10:
+            print_atomic("amomin.w", instruction);
+            break;
+        case 0x14:
+            print_atomic("amomax.w", instruction);
+            break;
+        case 0x18:
+            print_atomic("amominu.w", instruction);
+            break;
+        case 0x1C:
+            print_atomic("amomaxu.w", instruction);
+            break;
+        default:
+            handle_invalid_instruction(instruction);
+            break;
+    }
+}
+
 void print_rtype(char *name, Instruction instruction) {
   printf(RTYPE_FORMAT, name, instruction.rtype.rd, instruction.rtype.rs1,
          instruction.rtype.rs2);
@@ -342,3 +393,7 @@ void print_jal(Instruction instruction) {
 void print_ecall(Instruction instruction) {
     printf(ECALL_FORMAT);
 }
+
+void print_atomic(char *name, Instruction instruction) {
+    printf(AMO_FORMAT, name, instruction.rtype.rd, instruction.rtype.rs2, instruction.rtype.rs1);
+}
@@ -0,0 +1,182 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dram.h"
+
+static bool power_of_two(int n) {
+  return n > 0 && (n & (n - 1)) == 0;
+}
+
+static uint64_t later(uint64_t a, uint64_t b) {
+  return (a > b) ? a : b;
+}
+
+bool dram_init(dram_t *dram, int channels, int ranks, int banks, int policy) {
+  if (!power_of_two(channels) || !power_of_two(ranks) || !power_of_two(banks) ||
+      channels * ranks * banks > DRAM_MAX_BANKS) {
+    return false;
+  }
+  memset(dram, 0, sizeof(*dram));
+  dram->channels = channels;
+  dram->ranks = ranks;
+  dram->banks = banks;
+  dram->policy = policy;
+  dram->rowBits = __builtin_ctz(DRAM_ROW_BYTES);
+  dram->channel = calloc(channels, sizeof(dram_channel_t));
+  assert(dram->channel != NULL);
+  for (int c = 0; c < channels; c++) {
+    dram_channel_t *ch = &dram->channel[c];
+    ch->banks = calloc(ranks * banks, sizeof(dram_bank_t));
+    ch->queue = calloc(DRAM_QUEUE_SIZE, sizeof(dram_request_t));
+    assert(ch->banks != NULL && ch->queue != NULL);
+    for (int b = 0; b < ranks * banks; b++) {
+      ch->banks[b].openRow = DRAM_ROW_CLOSED;
+    }
+  }
+  return true;
+}
+
+// row:rank:bank:channel:column, so consecutive blocks share a row and rows interleave over the channels
+static dram_channel_t *decode(const dram_t *dram, uint64_t addr, dram_request_t *req) {
+  uint64_t rest = addr >> dram->rowBits;
+  int channel = rest & (dram->channels - 1);
+  rest >>= __builtin_ctz(dram->channels);
+  req->bank = rest & (dram->ranks * dram->banks - 1);  // rank and bank together
+  rest >>= __builtin_ctz(dram->ranks * dram->banks);
+  req->row = rest;
+  req->addr = addr;
+  return &dram->channel[channel];
+}
+
+// cycle the bank could start `req`
+static uint64_t start_of(const dram_channel_t *ch, const dram_request_t *req) {
+  return later(req->arrival, ch->banks[req->bank].ready);
+}
+
+// serves `req` on its bank and the data bus; returns the cycle its burst ends
+static uint64_t service(dram_t *dram, dram_channel_t *ch, const dram_request_t *req) {
+  dram_bank_t *bank = &ch->banks[req->bank];
+  uint64_t t = start_of(ch, req);
+  if (bank->openRow == req->row) {
+    dram->row_hits++;
+  } else if (bank->openRow == DRAM_ROW_CLOSED) {
+    dram->row_empty++;
+    t += DRAM_TRCD;
+  } else {
+    dram->row_conflicts++;
+    t += DRAM_TRP + DRAM_TRCD;
+  }
+  uint64_t data = later(t + DRAM_TCAS, ch->busFree);
+  ch->busFree = data + DRAM_TBURST;
+
+  if (dram->policy == DRAM_OPEN_PAGE) {
+    bank->openRow = req->row;
+    bank->ready = data + DRAM_TBURST - DRAM_TCAS;  // the next column command's burst follows this one
+  } else {
+    bank->openRow = DRAM_ROW_CLOSED;
+    bank->ready = data + DRAM_TBURST + DRAM_TRP;
+  }
+  return data + DRAM_TBURST;
+}
+
+/* FR-FCFS over the queued writes of a channel that could start before cycle `before`:
+ * the oldest one that hits the open row of its bank, else the oldest one.
+ * Returns its index, -1 if none can start by then.
+ */
+static int pick(const dram_channel_t *ch, uint64_t before) {
+  int oldest = -1;
+  for (int i = 0; i < ch->count; i++) {
+    const dram_request_t *req = &ch->queue[i];
+    if (start_of(ch, req) >= before) {
+      continue;
+    }
+    if (ch->banks[req->bank].openRow == req->row) {
+      return i;
+    }
+    if (oldest < 0) {
+      oldest = i;
+    }
+  }
+  return oldest;
+}
+
+// serves queued write `i` and removes it from the queue; returns the cycle it started
+static uint64_t serve_queued(dram_t *dram, dram_channel_t *ch, int i) {
+  uint64_t start = start_of(ch, &ch->queue[i]);
+  service(dram, ch, &ch->queue[i]);
+  memmove(&ch->queue[i], &ch->queue[i + 1], (ch->count - i - 1) * sizeof(dram_request_t));
+  ch->count--;
+  return start;
+}
+
+// serves the writes the scheduler starts before cycle `now`
+static void drain(dram_t *dram, dram_channel_t *ch, uint64_t now) {
+  int i;
+  while ((i = pick(ch, now)) >= 0) {
+    serve_queued(dram, ch, i);
+  }
+}
+
+static void record_read(dram_t *dram, uint64_t latency) {
+  int bucket = latency / DRAM_LATENCY_BUCKET;
+  dram->latency[(bucket < DRAM_LATENCY_BUCKETS) ? bucket : DRAM_LATENCY_BUCKETS - 1]++;
+  dram->read_cycles += latency;
+  dram->max_latency = later(dram->max_latency, latency);
+}
+
+uint64_t dram_access(dram_t *dram, uint64_t addr, int type, uint64_t now) {
+  dram_request_t req;
+  dram_channel_t *ch = decode(dram, addr, &req);
+  req.arrival = now + DRAM_CTRL_LATENCY / 2;
+  drain(dram, ch, req.arrival);
+
+  if (type == DRAM_WRITE) {
+    dram->writes++;
+    uint64_t accepted = now;
+    if (ch->count == DRAM_QUEUE_SIZE) {
+      // a full queue frees the entry of the write the scheduler would serve next
+      uint64_t start = serve_queued(dram, ch, pick(ch, UINT64_MAX));
+      accepted = later(now, start);
+      dram->queue_full_stalls += accepted - now;
+    }
+    req.arrival = later(req.arrival, accepted);
+    ch->queue[ch->count++] = req;
+    return accepted;
+  }
+
+  // reads go ahead of the queued writes, which only take idle banks
+  dram->reads++;
+  uint64_t done = service(dram, ch, &req) + (DRAM_CTRL_LATENCY - DRAM_CTRL_LATENCY / 2);
+  record_read(dram, done - now);
+  return done;
+}
+
+void dram_flush(dram_t *dram) {
+  for (int c = 0; c < dram->channels; c++) {
+    drain(dram, &dram->channel[c], UINT64_MAX);
+  }
+}
+
+double dram_row_hit_rate(const dram_t *dram) {
+  uint64_t served = dram->row_hits + dram->row_empty + dram->row_conflicts;
+  return served ? (double)dram->row_hits / served : 0.0;
+}
+
+double dram_read_latency(const dram_t *dram) {
+  return dram->reads ? (double)dram->read_cycles / dram->reads : 0.0;
+}
+
+int dram_page_policy(const char *name) {
+  if (strcmp(name, "open") == 0) return DRAM_OPEN_PAGE;
+  if (strcmp(name, "closed") == 0) return DRAM_CLOSED_PAGE;
+  return -1;
+}
+
+void dram_free(dram_t *dram) {
+  for (int c = 0; c < dram->channels; c++) {
+    free(dram->channel[c].banks);
+    free(dram->channel[c].queue);
+  }
+  free(dram->channel);
+  dram->channel = NULL;
+}
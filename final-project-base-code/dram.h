@@ -0,0 +1,143 @@
+#ifndef __DRAM_H__
+#define __DRAM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// DRAM controller: channels of ranks of banks, each bank with a row buffer,
+/// in place of the fixed MEM_LATENCY below the last cache level. A read pays
+/// tCAS on a row hit, tRCD + tCAS on a closed bank and tRP + tRCD + tCAS on a
+/// row conflict, then its burst on the channel's data bus. Writebacks are
+/// posted to a request queue that the controller drains FR-FCFS, row hits
+/// first; reads are not kept waiting behind them. All times are CPU cycles.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DRAM_CHANNELS
+#define DRAM_CHANNELS 1
+#endif
+#ifndef DRAM_RANKS
+#define DRAM_RANKS 1         // per channel
+#endif
+#ifndef DRAM_BANKS
+#define DRAM_BANKS 8         // per rank
+#endif
+#ifndef DRAM_ROW_BYTES
+#define DRAM_ROW_BYTES 2048  // row buffer of one bank
+#endif
+#ifndef DRAM_TRCD
+#define DRAM_TRCD 42         // activate to column command, about 14 ns at 3 GHz
+#endif
+#ifndef DRAM_TCAS
+#define DRAM_TCAS 42         // column command to data
+#endif
+#ifndef DRAM_TRP
+#define DRAM_TRP 42          // precharge
+#endif
+#ifndef DRAM_TBURST
+#define DRAM_TBURST 8        // one block on the data bus
+#endif
+#ifndef DRAM_CTRL_LATENCY
+#define DRAM_CTRL_LATENCY 16 // controller and interconnect, request and response together
+#endif
+#ifndef DRAM_QUEUE_SIZE
+#define DRAM_QUEUE_SIZE 32   // posted writes per channel
+#endif
+#define DRAM_MAX_BANKS 256   // channels * ranks * banks
+#define DRAM_LATENCY_BUCKET 16  // cycles per bucket of the read latency histogram
+#define DRAM_LATENCY_BUCKETS 16
+
+#define DRAM_ROW_CLOSED (-1)
+
+enum dram_page_enum {
+  DRAM_OPEN_PAGE = 0,    // the row stays open for the next access to the bank
+  DRAM_CLOSED_PAGE = 1   // the bank precharges after every access
+};
+
+enum dram_access_enum {
+  DRAM_READ = 0,
+  DRAM_WRITE = 1
+};
+
+typedef struct
+{
+  uint64_t addr;
+  uint64_t arrival;
+  int bank;        // within the channel
+  int64_t row;
+}dram_request_t;
+
+typedef struct
+{
+  int64_t openRow;   // DRAM_ROW_CLOSED once precharged
+  uint64_t ready;    // cycle the bank takes its next command
+}dram_bank_t;
+
+typedef struct
+{
+  dram_bank_t *banks;      // ranks * banks
+  uint64_t busFree;        // cycle the data bus is free
+  dram_request_t *queue;   // posted writes, oldest first
+  int count;
+}dram_channel_t;
+
+typedef struct dram
+{
+  int channels;
+  int ranks;
+  int banks;
+  int policy;    // dram_page_enum
+  int rowBits;   // log2 DRAM_ROW_BYTES, the column bits of an address
+  dram_channel_t *channel;
+
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t row_hits;
+  uint64_t row_empty;       // the bank was precharged: activate only
+  uint64_t row_conflicts;   // another row was open: precharge and activate
+  uint64_t queue_full_stalls;  // cycles writes waited for a queue entry
+  uint64_t read_cycles;     // sum of the read latencies
+  uint64_t max_latency;
+  uint64_t latency[DRAM_LATENCY_BUCKETS];  // reads by latency, the last bucket open ended
+}dram_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * sets up `channels` channels of `ranks` ranks of `banks` banks, all precharged
+ * output : false if there are more than DRAM_MAX_BANKS banks or a count is not a power of two
+ **/
+bool dram_init(dram_t *dram, int channels, int ranks, int banks, int policy);
+
+/**
+ * one block access (dram_access_enum) arriving at the controller at cycle `now`
+ * output : for a read, the cycle its data is back; for a write, the cycle it entered
+ *          the queue, later than `now` only when the queue was full
+ **/
+uint64_t dram_access(dram_t *dram, uint64_t addr, int type, uint64_t now);
+
+/**
+ * serves every queued write, so that the row buffer counts include them
+ **/
+void dram_flush(dram_t *dram);
+
+/**
+ * output : row hits over all the accesses served
+ **/
+double dram_row_hit_rate(const dram_t *dram);
+
+/**
+ * output : average read latency, from the request to the data, in cycles
+ **/
+double dram_read_latency(const dram_t *dram);
+
+/**
+ * output : the dram_page_enum called `name` (open or closed), -1 if none
+ **/
+int dram_page_policy(const char *name);
+
+void dram_free(dram_t *dram);
+
+#endif // __DRAM_H__
@@ -1,8 +1,11 @@
 #include <stdio.h> // for stderr
 #include <stdlib.h> // for exit()
+#include <pthread.h>
 #include "types.h"
 #include "utils.h"
 #include "riscv.h"
+#include "pipeline.h"
+#include "multicore.h"
 
 void execute_rtype(Instruction, Processor *);
 void execute_itype_except_load(Instruction, Processor *);
@@ -12,6 +15,7 @@ void execute_load(Instruction, Processor *, Byte *);
 void execute_store(Instruction, Processor *, Byte *);
 void execute_ecall(Processor *, Byte *);
 void execute_lui(Instruction, Processor *);
+void execute_atomic(Instruction, Processor *, Byte *);
 
 void execute_instruction(uint32_t instruction_bits, Processor *processor, Byte *memory) {    
     Instruction instruction = parse_instruction(instruction_bits);
@@ -40,6 +44,9 @@ void execute_instruction(uint32_t instruction_bits, Processor *processor, Byte *
         case 0x37:
             execute_lui(instruction, processor);
             break;
+        case 0x2F:
+            execute_atomic(instruction, processor, memory);
+            break;
         default: // undefined opcode
             handle_invalid_instruction(instruction);
             exit(-1);
@@ -413,36 +420,32 @@ void execute_branch(Instruction instruction, Processor *processor) {
 
 void execute_load(Instruction instruction, Processor *processor, Byte *memory) {
     /* YOUR CODE HERE */
+    Address address = translate(processor->R[instruction.itype.rs1] + sign_extend_number(instruction.itype.imm, 12), MMU_LOAD);
     switch (instruction.itype.funct3) {
         case 0x0:
             // lb - LOAD BYTE - must sign extend after loading the value because it needs to be 32 bits long, and LENGTH_BYTE is just 8 bits long 
             processor->R[instruction.itype.rd] = 
-            sign_extend_number(load(memory, processor->R[instruction.itype.rs1] + 
-            sign_extend_number(instruction.itype.imm, 12), LENGTH_BYTE), 8);
+            sign_extend_number(load(memory, address, LENGTH_BYTE), 8);
             break;
         case 0x1:
             // lh - LOAD HALF BYTE - must also sign extend after loading since HALF_WORD is only 16 bits long
             processor->R[instruction.itype.rd] = 
-            sign_extend_number(load(memory, processor->R[instruction.itype.rs1] + 
-            sign_extend_number(instruction.itype.imm, 12),  LENGTH_HALF_WORD), 16);
+            sign_extend_number(load(memory, address,  LENGTH_HALF_WORD), 16);
             break;
         case 0x2:
             // lw - signed but no need to sign extend because a word length is 32 bits long
             processor->R[instruction.itype.rd] = 
-            load(memory, processor->R[instruction.itype.rs1] + 
-            sign_extend_number(instruction.itype.imm, 12),  LENGTH_WORD);
+            load(memory, address,  LENGTH_WORD);
             break; 
         case 0x4:
             // lbu - LOAD BYTE UNSIGNED - unsigned, so no sign extension needed when setting rd
             processor->R[instruction.itype.rd] = 
-            load(memory, processor->R[instruction.itype.rs1] + 
-            sign_extend_number(instruction.itype.imm, 12), LENGTH_BYTE);
+            load(memory, address, LENGTH_BYTE);
             break;
         case 0x5:
             // lhu - LOAD HALF WORD UNSIGNED - unsigned, so no sign extension needed when setting rd
             processor->R[instruction.itype.rd] = 
-            load(memory, processor->R[instruction.itype.rs1] + 
-            sign_extend_number(instruction.itype.imm, 12), LENGTH_HALF_WORD);
+            load(memory, address, LENGTH_HALF_WORD);
             break;
         default:
             handle_invalid_instruction(instruction);
@@ -454,21 +457,19 @@ void execute_load(Instruction instruction, Processor *processor, Byte *memory) {
 }
 
 void execute_store(Instruction instruction, Processor *processor, Byte *memory) {
+    Address address = translate(processor->R[instruction.stype.rs1] + get_store_offset(instruction), MMU_STORE);
     switch (instruction.stype.funct3) {
         case 0x0:
             // sb - STORE BYTE - stores a byte sized value rs2 into memory at address = rs1 + imm
-            store(memory, processor->R[instruction.stype.rs1] + 
-            get_store_offset(instruction), LENGTH_BYTE, processor->R[instruction.stype.rs2]); // dont forget to store the value of rs2 not the actual address of rs2
+            store(memory, address, LENGTH_BYTE, processor->R[instruction.stype.rs2]); // dont forget to store the value of rs2 not the actual address of rs2
             break;
         case 0x1:
             // sh - STORE HALF WORD - stores a half word size (2 bytes) into memory at address = rs1 + imm
-            store(memory, processor->R[instruction.stype.rs1] + 
-            get_store_offset(instruction), LENGTH_HALF_WORD, processor->R[instruction.stype.rs2]);
+            store(memory, address, LENGTH_HALF_WORD, processor->R[instruction.stype.rs2]);
             break;
         case 0x2:
             // sw - STORE WORD - stores a full word size (4 bytes) into memory at address = rs1 + imm
-            store(memory, processor->R[instruction.stype.rs1] + 
-            get_store_offset(instruction), LENGTH_WORD, processor->R[instruction.stype.rs2]);
+            store(memory, address, LENGTH_WORD, processor->R[instruction.stype.rs2]);
             break;
         default:
             handle_invalid_instruction(instruction);
@@ -493,10 +494,174 @@ void execute_lui(Instruction instruction, Processor *processor) {
     processor->PC += 4;
 }
 
+void execute_atomic(Instruction instruction, Processor *processor, Byte *memory) {
+    if (instruction.rtype.funct3 != 0x2) {
+        handle_invalid_instruction(instruction);
+        exit(-1);
+    }
+    unsigned int funct5 = instruction.rtype.funct7 >> 2; // the aq and rl bits below it are ignored, every access is sequentially consistent
+    Address address = translate(processor->R[instruction.rtype.rs1], (funct5 == 0x02) ? MMU_LOAD : MMU_STORE);
+    Word rs2 = processor->R[instruction.rtype.rs2];
+    Word old;
+    switch (funct5) {
+        case 0x02:
+            // lr.w - LOAD RESERVED - loads the word at rs1 and reserves it for the next sc.w
+            old = load_reserved(memory, address);
+            break;
+        case 0x03:
+            // sc.w - STORE CONDITIONAL - stores rs2 at rs1 if the reservation holds, rd = 0 if it did and 1 if not
+            old = !store_conditional(memory, address, rs2);
+            break;
+        default:
+            // amoswap/amoadd/amoxor/amoand/amoor/amomin/amomax/amominu/amomaxu.w - rd = the word at rs1, which becomes (word op rs2)
+            if (!atomic_rmw(memory, address, funct5, rs2, &old)) {
+                handle_invalid_instruction(instruction);
+                exit(-1);
+            }
+            break;
+    }
+    processor->R[instruction.rtype.rd] = old;
+
+    // update PC
+    processor->PC += 4;
+}
+
+// the word an atomic works on; RV32A has no misaligned atomics
+static Word *atomic_word(Byte *memory, Address address) {
+    if ((address & 0x3) != 0 || address > MEMORY_SPACE - 4) {
+        printf("Error: Misaligned atomic at address %08x\n", address);
+        exit(-1);
+    }
+    return (Word *)&memory[address];
+}
+
+/* the reservations of lr.w, one per hart (core_id), each the reserved word's address | 1,
+   or 0 for none. Every store, AMO and successful sc.w clears the reservations other harts
+   hold on the words it writes, so sc.w fails once its word was written since the lr.w,
+   whatever value was written. With more than one hart (-N) the reservation checks and the
+   write happen under the lock of the word, so that none of them falls in between. */
+#define RESERVATION_LOCKS 64
+static Word reservations[MULTICORE_MAX_CORES];
+static int reservation_harts = 1;
+static pthread_mutex_t reservation_locks[RESERVATION_LOCKS];
+
+void reservations_init(int harts) {
+    reservation_harts = harts;
+    for (int i = 0; i < RESERVATION_LOCKS; i++) {
+        pthread_mutex_init(&reservation_locks[i], NULL);
+    }
+}
+
+// locks the words from first to last (addresses >> 2, at most two), in lock order
+static void reservation_lock(Address first, Address last, bool lock) {
+    if (reservation_harts <= 1) {
+        return;
+    }
+    unsigned int a = first % RESERVATION_LOCKS;
+    unsigned int b = last % RESERVATION_LOCKS;
+    if (a > b) {
+        unsigned int t = a; a = b; b = t;
+    }
+    if (lock) {
+        pthread_mutex_lock(&reservation_locks[a]);
+        if (b != a) pthread_mutex_lock(&reservation_locks[b]);
+    } else {
+        if (b != a) pthread_mutex_unlock(&reservation_locks[b]);
+        pthread_mutex_unlock(&reservation_locks[a]);
+    }
+}
+
+// clears the reservations of the other harts on the words from first to last
+static void reservation_clear_others(Address first, Address last) {
+    for (int hart = 0; hart < reservation_harts; hart++) {
+        if (hart == core_id) {
+            continue;
+        }
+        for (Address word = first; word <= last; word++) {
+            Word expected = (word << 2) | 1;
+            __atomic_compare_exchange_n(&reservations[hart], &expected, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        }
+    }
+}
+
+bool atomic_rmw(Byte *memory, Address address, unsigned int funct5, Word operand, Word *old) {
+    Word *word = atomic_word(memory, address);
+    bool known = true;
+    reservation_lock(address >> 2, address >> 2, true);
+    switch (funct5) {
+        case 0x01: // amoswap.w
+            *old = __atomic_exchange_n(word, operand, __ATOMIC_SEQ_CST);
+            break;
+        case 0x00: // amoadd.w
+            *old = __atomic_fetch_add(word, operand, __ATOMIC_SEQ_CST);
+            break;
+        case 0x04: // amoxor.w
+            *old = __atomic_fetch_xor(word, operand, __ATOMIC_SEQ_CST);
+            break;
+        case 0x0C: // amoand.w
+            *old = __atomic_fetch_and(word, operand, __ATOMIC_SEQ_CST);
+            break;
+        case 0x08: // amoor.w
+            *old = __atomic_fetch_or(word, operand, __ATOMIC_SEQ_CST);
+            break;
+        case 0x10: // amomin.w
+        case 0x14: // amomax.w
+        case 0x18: // amominu.w
+        case 0x1C: { // amomaxu.w
+            Word value = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+            Word result;
+            do {
+                switch (funct5) {
+                    case 0x10: result = ((sWord)value < (sWord)operand) ? value : operand; break;
+                    case 0x14: result = ((sWord)value > (sWord)operand) ? value : operand; break;
+                    case 0x18: result = (value < operand) ? value : operand; break;
+                    default:   result = (value > operand) ? value : operand; break;
+                }
+            } while (!__atomic_compare_exchange_n(word, &value, result, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+            *old = value;
+            break;
+        }
+        default:
+            known = false;
+            break;
+    }
+    if (known) {
+        reservation_clear_others(address >> 2, address >> 2);
+    }
+    reservation_lock(address >> 2, address >> 2, false);
+    return known;
+}
+
+Word load_reserved(Byte *memory, Address address) {
+    Word *word = atomic_word(memory, address);
+    reservation_lock(address >> 2, address >> 2, true);
+    __atomic_store_n(&reservations[core_id], address | 1, __ATOMIC_SEQ_CST);
+    Word value = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+    reservation_lock(address >> 2, address >> 2, false);
+    return value;
+}
+
+bool store_conditional(Byte *memory, Address address, Word value) {
+    Word *word = atomic_word(memory, address);
+    reservation_lock(address >> 2, address >> 2, true);
+    bool held = __atomic_exchange_n(&reservations[core_id], 0, __ATOMIC_SEQ_CST) == (address | 1);
+    if (held) {
+        reservation_clear_others(address >> 2, address >> 2);
+        __atomic_store_n(word, value, __ATOMIC_SEQ_CST);
+    }
+    reservation_lock(address >> 2, address >> 2, false);
+    return held;
+}
+
 void store(Byte *memory, Address address, Alignment alignment, Word value) {
     /* YOUR CODE HERE */ 
     // reference the load function here. muust include 3 cases: LENGTH BYTE, LENGTH HALF WORD, LENGTH WORD
     // address is a 32 bit index in memory, memory (RAM) is a stack/array that contains stored words
+    Address first = address >> 2, last = (address + alignment - 1) >> 2;
+    reservation_lock(first, last, true);
+    if (reservation_harts > 1) {
+        reservation_clear_others(first, last);
+    }
     switch(alignment) {
         case LENGTH_BYTE:
             memory[address] = value & 0xFF; // store 1 byte of the value of the word by masking the first 8 bits of value
@@ -512,6 +677,17 @@ void store(Byte *memory, Address address, Alignment alignment, Word value) {
             memory[address + 3] = (value >> 24) & 0xFF; // first byte in string
         break;
     }
+    reservation_lock(first, last, false);
+}
+
+// virtual to physical with -U, functionally: no timing, and the walker bypasses the caches
+Address translate(Address address, int access) {
+    Address physical = address;
+    if (sim_config.mmu_en && !mmu_translate(&mmu, address, access, 0, NULL, &physical)) {
+        printf("Error: Page fault at address %08x\n", address);
+        exit(-1);
+    }
+    return physical;
 }
 
 Word load(Byte *memory, Address address, Alignment alignment) {
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include "fu.h"
+
+#define ALU_OP {FU_UNIT_ALU, FU_ALU_LATENCY, 1}
+#define MUL_OP {FU_UNIT_MUL, FU_MUL_LATENCY, FU_MUL_II}
+#define DIV_OP {FU_UNIT_DIV, FU_DIV_LATENCY, FU_DIV_II}
+
+// latency and initiation interval of every execute_alu operation
+static const fu_timing_t fu_latency_table[] = {
+  [0x0] = ALU_OP,  // add
+  [0x1] = ALU_OP,  // sub
+  [0x2] = ALU_OP,  // and
+  [0x3] = ALU_OP,  // or
+  [0x4] = ALU_OP,  // slli
+  [0x5] = DIV_OP,  // divu
+  [0x6] = ALU_OP,  // xor
+  [0x7] = ALU_OP,  // sll
+  [0x8] = ALU_OP,  // srl
+  [0x9] = ALU_OP,  // sltu
+  [0xA] = DIV_OP,  // remu
+  [0xB] = MUL_OP,  // mulh
+  [0xC] = MUL_OP,  // mul
+  [0xD] = ALU_OP,  // srli
+  [0xE] = ALU_OP,  // sra
+  [0xF] = MUL_OP,  // mulhsu
+  [0x10] = MUL_OP, // mulhu
+  [0x11] = ALU_OP, // slt
+  [0x12] = DIV_OP, // div
+  [0x13] = DIV_OP, // rem
+};
+
+uint32_t fu_alu_control(Instruction instruction) {
+  static const uint32_t base_op[8] = {0x0, 0x7, 0x11, 0x9, 0x6, 0x8, 0x3, 0x2};   // add sll slt sltu xor srl or and
+  static const uint32_t muldiv_op[8] = {0xC, 0xB, 0xF, 0x10, 0x12, 0x5, 0x13, 0xA}; // mul mulh mulhsu mulhu div divu rem remu
+
+  if (instruction.opcode == 0x33) {
+    if (instruction.rtype.funct7 == 0x01) {
+      return muldiv_op[instruction.rtype.funct3];
+    }
+    if (instruction.rtype.funct7 == 0x20) {
+      return (instruction.rtype.funct3 == 0x0) ? 0x1 : 0xE; // sub, sra
+    }
+    return base_op[instruction.rtype.funct3];
+  }
+
+  // I-type: the shift-by-immediate forms have their own controls
+  switch (instruction.itype.funct3) {
+    case 0x1:
+      return 0x4; // slli
+    case 0x5:
+      return ((instruction.itype.imm >> 5) == 0x20) ? 0xE : 0xD; // srai, srli
+    default:
+      return base_op[instruction.itype.funct3];
+  }
+}
+
+fu_timing_t fu_timing(Instruction instruction, bool multicycle) {
+  fu_timing_t single = ALU_OP;
+  if (!multicycle || instruction.opcode != 0x33) {
+    return single;
+  }
+  return fu_latency_table[fu_alu_control(instruction)];
+}
+
+const char* fu_unit_name(int unit) {
+  switch (unit) {
+    case FU_UNIT_ALU: return "ALU";
+    case FU_UNIT_MUL: return "MUL";
+    case FU_UNIT_DIV: return "DIV";
+    default: return "???";
+  }
+}
+
+bool fu_unit_free(const fu_scoreboard_t* sb, int unit, uint64_t now) {
+  return sb->unit[unit].next_issue <= now;
+}
+
+uint64_t fu_issue(fu_scoreboard_t* sb, Instruction instruction, bool multicycle, uint64_t now) {
+  fu_timing_t timing = fu_timing(instruction, multicycle);
+  uint64_t ready = now + timing.latency;
+
+  sb->unit[timing.unit].next_issue = now + timing.ii;
+  sb->unit[timing.unit].ops++;
+
+  switch (instruction.opcode) {
+    case 0x33: case 0x13: case 0x03: case 0x2F: case 0x37: case 0x6F: case 0x67:
+      if (instruction.rtype.rd != 0) {
+        sb->reg_ready[instruction.rtype.rd] = ready;
+      }
+      break;
+    default: // no register result
+      break;
+  }
+  return ready;
+}
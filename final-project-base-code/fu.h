@@ -0,0 +1,80 @@
+#ifndef __FU_H__
+#define __FU_H__
+
+#include "types.h"
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Functional unit timing (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef FU_ALU_LATENCY
+#define FU_ALU_LATENCY 1
+#endif
+#ifndef FU_MUL_LATENCY
+#define FU_MUL_LATENCY 3                // pipelined multiplier
+#endif
+#ifndef FU_MUL_II
+#define FU_MUL_II 1                     // accepts a new multiply every cycle
+#endif
+#ifndef FU_DIV_LATENCY
+#define FU_DIV_LATENCY 32               // iterative divider, one quotient bit per cycle
+#endif
+#ifndef FU_DIV_II
+#define FU_DIV_II FU_DIV_LATENCY        // not pipelined: busy until the quotient is done
+#endif
+
+enum fu_unit_enum {
+  FU_UNIT_ALU = 0,
+  FU_UNIT_MUL = 1,
+  FU_UNIT_DIV = 2,
+  FU_UNIT_COUNT = 3
+};
+
+// per-operation timing, indexed by the execute_alu control signal
+typedef struct
+{
+  int unit;
+  int latency;  // cycles from issue until dependents can use the result
+  int ii;       // initiation interval: cycles until the unit accepts the next operation
+}fu_timing_t;
+
+typedef struct
+{
+  uint64_t next_issue;        // first cycle the unit accepts a new operation
+  uint64_t ops;
+  uint64_t structural_stalls; // cycles an operation waited for this unit
+}fu_unit_t;
+
+typedef struct
+{
+  fu_unit_t unit[FU_UNIT_COUNT];
+  uint64_t reg_ready[32];     // cycle each register's pending result becomes available
+}fu_scoreboard_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * decodes the execute_alu control signal of an R-type or I-type ALU instruction
+ **/
+uint32_t fu_alu_control(Instruction instruction);
+
+/**
+ * timing of the instruction; instructions that are not mul/div use the ALU entry.
+ * With `multicycle` false every operation completes in one cycle.
+ **/
+fu_timing_t fu_timing(Instruction instruction, bool multicycle);
+
+const char* fu_unit_name(int unit);
+
+bool fu_unit_free(const fu_scoreboard_t* sb, int unit, uint64_t now);
+
+/**
+ * starts the instruction on its unit at cycle `now`, records when its destination
+ * register becomes available and returns that cycle
+ **/
+uint64_t fu_issue(fu_scoreboard_t* sb, Instruction instruction, bool multicycle, uint64_t now);
+
+#endif // __FU_H__
@@ -0,0 +1,199 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "mmu.h"
+#include "dram.h"
+
+#define MEGAPAGE_KEY (1ULL << 32)  // megapage entries are keyed apart from 4 KiB pages
+
+static void tlb_init(tlb_t *tlb, const char *name, int size) {
+  memset(tlb, 0, sizeof(*tlb));
+  tlb->name = name;
+  tlb->size = size;
+  assoc_init(&tlb->map, size);
+  tlb->entries = calloc(size, sizeof(tlb_entry_t));
+  assert(tlb->entries != NULL);
+}
+
+static tlb_entry_t *tlb_lookup(tlb_t *tlb, uint32_t va) {
+  uint32_t vpn = va >> SV32_PAGE_BITS;
+  int entry = assoc_find(&tlb->map, vpn);
+  if (entry == ASSOC_NONE) {
+    entry = assoc_find(&tlb->map, MEGAPAGE_KEY | (vpn >> SV32_VPN_BITS));
+  }
+  if (entry == ASSOC_NONE) {
+    return NULL;
+  }
+  assoc_touch(&tlb->map, entry);
+  return &tlb->entries[entry];
+}
+
+static tlb_entry_t *tlb_fill(tlb_t *tlb, uint32_t va, int level) {
+  uint32_t vpn = va >> SV32_PAGE_BITS;
+  uint64_t key = (level > 0) ? MEGAPAGE_KEY | (vpn >> SV32_VPN_BITS) : vpn;
+  int entry = assoc_free_entry(&tlb->map);
+  if (entry == ASSOC_NONE) {
+    entry = assoc_lru(&tlb->map);
+  }
+  assoc_set(&tlb->map, entry, key);
+  return &tlb->entries[entry];
+}
+
+static bool permitted(uint32_t flags, int access) {
+  switch (access) {
+    case MMU_FETCH: return flags & PTE_X;
+    case MMU_LOAD:  return flags & PTE_R;
+    default:        return (flags & PTE_W) && (flags & PTE_D);
+  }
+}
+
+static uint32_t read_pte(const mmu_t *mmu, uint32_t addr, bool *ok) {
+  uint32_t offset = addr - MMU_TABLE_BASE;
+  *ok = (addr >= MMU_TABLE_BASE && offset <= mmu->tableSize - SV32_PTE_SIZE);
+  if (!*ok) {
+    return 0;  // the walker only reads the tables it was given
+  }
+  const Byte *p = &mmu->tables[offset];
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_pte(mmu_t *mmu, uint32_t addr, uint32_t pte) {
+  Byte *p = &mmu->tables[addr - MMU_TABLE_BASE];
+  p[0] = pte & 0xFF;
+  p[1] = (pte >> 8) & 0xFF;
+  p[2] = (pte >> 16) & 0xFF;
+  p[3] = (pte >> 24) & 0xFF;
+}
+
+void mmu_init(mmu_t *mmu, int itlbEntries, int dtlbEntries) {
+  memset(mmu, 0, sizeof(*mmu));
+  tlb_init(&mmu->itlb, "ITLB", itlbEntries);
+  tlb_init(&mmu->dtlb, "DTLB", dtlbEntries);
+
+  // the root table and one leaf table per 4 MiB of program memory
+  uint32_t megapage = 1u << (SV32_PAGE_BITS + SV32_VPN_BITS);
+  mmu->tableSize = (1 + (MEMORY_SPACE + megapage - 1) / megapage) * SV32_TABLE_SIZE;
+  mmu->tables = calloc(mmu->tableSize, 1);
+  assert(mmu->tables != NULL);
+  mmu->tableUsed = SV32_TABLE_SIZE;
+  mmu->satp = SATP_MODE_SV32 | ((MMU_TABLE_BASE >> SV32_PAGE_BITS) & SATP_PPN_MASK);
+
+  for (uint32_t page = 0; page < MEMORY_SPACE; page += SV32_TABLE_SIZE) {
+    bool mapped = mmu_map(mmu, page, page, PTE_R | PTE_W | PTE_X | PTE_A | PTE_D);
+    assert(mapped);
+  }
+}
+
+bool mmu_map(mmu_t *mmu, uint32_t va, uint32_t pa, uint32_t flags) {
+  uint32_t root = (mmu->satp & SATP_PPN_MASK) << SV32_PAGE_BITS;
+  uint32_t vpn1 = va >> (SV32_PAGE_BITS + SV32_VPN_BITS);
+  uint32_t vpn0 = (va >> SV32_PAGE_BITS) & ((1u << SV32_VPN_BITS) - 1);
+  bool ok;
+
+  uint32_t pte = read_pte(mmu, root + vpn1 * SV32_PTE_SIZE, &ok);
+  if (!(pte & PTE_V)) {
+    if (mmu->tableUsed + SV32_TABLE_SIZE > mmu->tableSize) {
+      return false;
+    }
+    uint32_t leaf = MMU_TABLE_BASE + mmu->tableUsed;
+    mmu->tableUsed += SV32_TABLE_SIZE;
+    pte = ((leaf >> SV32_PAGE_BITS) << 10) | PTE_V;  // a pointer to the next level
+    write_pte(mmu, root + vpn1 * SV32_PTE_SIZE, pte);
+  }
+  uint32_t leaf = (pte >> 10) << SV32_PAGE_BITS;
+  write_pte(mmu, leaf + vpn0 * SV32_PTE_SIZE, ((pa >> SV32_PAGE_BITS) << 10) | flags | PTE_V);
+  return true;
+}
+
+/* The Sv32 walk of the privileged spec, without the A/D updates (the map sets both):
+ *     1) read the PTE of vpn[i] in the table at `a`, starting at the root with i = 1
+ *     2) an invalid PTE, or one that is writable but not readable, faults
+ *     3) a PTE with R or X set is the leaf; otherwise it points to the next table
+ *     4) a megapage leaf (i = 1) must have ppn[0] = 0
+ * Every read goes through the walker's cache, one after the other.
+ */
+static bool walk(mmu_t *mmu, uint32_t va, uint64_t *t, bool timed, uint32_t *pte_out, int *level_out) {
+  uint32_t a = (mmu->satp & SATP_PPN_MASK) << SV32_PAGE_BITS;
+  mmu->walks++;
+  for (int level = SV32_LEVELS - 1; level >= 0; level--) {
+    uint32_t vpn = (va >> (SV32_PAGE_BITS + level * SV32_VPN_BITS)) & ((1u << SV32_VPN_BITS) - 1);
+    uint32_t addr = a + vpn * SV32_PTE_SIZE;
+    bool ok;
+    uint32_t pte = read_pte(mmu, addr, &ok);
+    mmu->pte_reads++;
+    if (timed) {
+      if (mmu->cache != NULL) {
+        mmu->cache->pc = 0;
+        *t = operateCacheAt(addr, CACHE_READ, mmu->cache, *t).ready_cycle;
+      } else if (mmu->dram != NULL) {
+        *t = dram_access(mmu->dram, addr, DRAM_READ, *t);
+      } else {
+        *t += (MEM_LATENCY > 0) ? MEM_LATENCY : 1;
+      }
+    }
+
+    if (!ok || !(pte & PTE_V) || ((pte & PTE_W) && !(pte & PTE_R))) {
+      return false;
+    }
+    if (pte & (PTE_R | PTE_X)) {
+      if (level > 0 && ((pte >> 10) & ((1u << SV32_VPN_BITS) - 1)) != 0) {
+        return false;
+      }
+      *pte_out = pte;
+      *level_out = level;
+      return true;
+    }
+    a = (pte >> 10) << SV32_PAGE_BITS;
+  }
+  return false;
+}
+
+bool mmu_translate(mmu_t *mmu, uint32_t va, int access, uint64_t now, uint64_t *ready, uint32_t *pa) {
+  tlb_t *tlb = (access == MMU_FETCH) ? &mmu->itlb : &mmu->dtlb;
+  uint64_t t = now;
+  tlb_entry_t *entry = tlb_lookup(tlb, va);
+  if (ready != NULL) {
+    *ready = now;
+  }
+
+  if (entry != NULL) {
+    tlb->hits++;
+  } else {
+    tlb->misses++;
+    uint32_t pte;
+    int level;
+    bool ok = walk(mmu, va, &t, ready != NULL, &pte, &level);
+    tlb->walk_cycles += t - now;
+    if (ready != NULL) {
+      *ready = t;
+    }
+    if (!ok) {
+      mmu->faults++;
+      *pa = va;
+      return false;
+    }
+    entry = tlb_fill(tlb, va, level);
+    entry->ppn = pte >> 10;
+    entry->flags = pte & 0x3FF;
+    entry->level = level;
+  }
+
+  if (!permitted(entry->flags, access)) {
+    mmu->faults++;
+    *pa = va;
+    return false;
+  }
+  uint32_t offsetBits = SV32_PAGE_BITS + entry->level * SV32_VPN_BITS;
+  *pa = ((entry->ppn << SV32_PAGE_BITS) & ~((1u << offsetBits) - 1)) | (va & ((1u << offsetBits) - 1));
+  return true;
+}
+
+void mmu_free(mmu_t *mmu) {
+  assoc_free(&mmu->itlb.map);
+  assoc_free(&mmu->dtlb.map);
+  free(mmu->itlb.entries);
+  free(mmu->dtlb.entries);
+  free(mmu->tables);
+  mmu->tables = NULL;
+}
@@ -0,0 +1,116 @@
+#ifndef __MMU_H__
+#define __MMU_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "cache.h"
+#include "assoc.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sv32 memory management unit: an I-TLB and a D-TLB in front of a two level
+/// page table walker. The programs run bare, so the simulator builds the page
+/// table itself, an identity map of program memory in 4 KiB pages, and enables
+/// Sv32 in satp. The tables sit in their own physical memory right above the
+/// program's, and the walker reads every PTE through the cache model.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MMU_ITLB_ENTRIES
+#define MMU_ITLB_ENTRIES 16  // fully associative, LRU
+#endif
+#ifndef MMU_DTLB_ENTRIES
+#define MMU_DTLB_ENTRIES 32  // fully associative, LRU
+#endif
+#define MMU_TLB_MAX 4096
+
+#ifndef MMU_TABLE_BASE
+#define MMU_TABLE_BASE MEMORY_SPACE  // physical address of the root page table
+#endif
+
+#define SV32_PAGE_BITS 12
+#define SV32_VPN_BITS 10
+#define SV32_LEVELS 2
+#define SV32_PTE_SIZE 4
+#define SV32_TABLE_SIZE (1 << SV32_PAGE_BITS)      // one page of 1024 PTEs
+#define SATP_MODE_SV32 0x80000000u
+#define SATP_PPN_MASK 0x003fffffu
+
+// PTE bits
+#define PTE_V (1u << 0)
+#define PTE_R (1u << 1)
+#define PTE_W (1u << 2)
+#define PTE_X (1u << 3)
+#define PTE_U (1u << 4)
+#define PTE_G (1u << 5)
+#define PTE_A (1u << 6)
+#define PTE_D (1u << 7)
+
+enum mmu_access_enum {
+  MMU_FETCH = 0,
+  MMU_LOAD  = 1,
+  MMU_STORE = 2
+};
+
+typedef struct
+{
+  uint32_t ppn;    // physical page of the translation, the first one of a megapage
+  uint32_t flags;  // the leaf PTE's permission bits
+  int level;       // 0: 4 KiB page, 1: 4 MiB megapage
+}tlb_entry_t;
+
+typedef struct
+{
+  const char *name;
+  int size;
+  assoc_t map;            // virtual page number (tagged with the level) -> entry
+  tlb_entry_t *entries;
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t walk_cycles;   // cycles the walks after its misses took
+}tlb_t;
+
+typedef struct mmu
+{
+  uint32_t satp;       // MODE | PPN of the root table
+  Byte *tables;        // page table memory, physical MMU_TABLE_BASE upward
+  uint32_t tableSize;
+  uint32_t tableUsed;  // bytes handed out to tables so far
+  Cache *cache;        // the walker's PTE reads go through this cache, NULL to go to memory
+  struct dram *dram;   // that memory without the cache, NULL for the fixed MEM_LATENCY
+  tlb_t itlb;
+  tlb_t dtlb;
+
+  uint64_t walks;
+  uint64_t pte_reads;
+  uint64_t faults;
+}mmu_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * sets up TLBs of `itlbEntries` and `dtlbEntries` entries and a page table that maps
+ * program memory onto itself, and turns on Sv32 translation
+ **/
+void mmu_init(mmu_t *mmu, int itlbEntries, int dtlbEntries);
+
+/**
+ * maps the 4 KiB page at `va` to the one at `pa`, allocating its leaf table if needed
+ * output : false if the page table memory is exhausted
+ **/
+bool mmu_map(mmu_t *mmu, uint32_t va, uint32_t pa, uint32_t flags);
+
+/**
+ * translates `va` for an access (mmu_access_enum) through the I-TLB (fetches) or the
+ * D-TLB. A miss walks the page table starting at cycle `now`; *ready is set to the
+ * cycle the translation is known, `now` on a TLB hit. A NULL `ready` translates
+ * without timing, and without touching the cache.
+ * output : false on a page fault, *pa is then `va`
+ **/
+bool mmu_translate(mmu_t *mmu, uint32_t va, int access, uint64_t now, uint64_t *ready, uint32_t *pa);
+
+void mmu_free(mmu_t *mmu);
+
+#endif // __MMU_H__
@@ -0,0 +1,185 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv.h"
+#include "multicore.h"
+
+void multicore_init(multicore_t *mc, int cores, uint64_t quantum, Byte *memory, const regfile_t *boot,
+                    const Cache *cache, const Cache *icache) {
+  assert(cores <= MULTICORE_MAX_CORES);
+  memset(mc, 0, sizeof(*mc));
+  mc->count = cores;
+  mc->quantum = quantum;
+  mc->memory = memory;
+  mc->cores = calloc(cores, sizeof(core_t));
+  assert(mc->cores != NULL);
+  pthread_mutex_init(&mc->lock, NULL);
+  pthread_cond_init(&mc->advance, NULL);
+  reservations_init(cores);
+
+  for (int i = 0; i < cores; i++) {
+    core_t *core = &mc->cores[i];
+    core->id = i;
+    core->system = mc;
+    core->regfile = *boot;
+    core->regfile.R[10] = i;
+    core->regfile.R[2] = boot->R[2] - i * MULTICORE_STACK_BYTES;
+
+    // the configuration is copied, cacheSetUp gives every copy its own lines
+    snprintf(core->names[0], sizeof(core->names[0]), "L1D%d", i);
+    snprintf(core->names[1], sizeof(core->names[1]), "L1I%d", i);
+    core->cache = *cache;
+    core->icache = *icache;
+    cacheSetUp(&core->cache, core->names[0]);
+    cacheSetUp(&core->icache, core->names[1]);
+  }
+}
+
+// waits until every running core has reached the end of the quantum
+static void quantum_wait(multicore_t *mc) {
+  pthread_mutex_lock(&mc->lock);
+  uint64_t quantum = mc->quanta;
+  if (++mc->arrived == mc->running) {
+    mc->arrived = 0;
+    mc->quanta++;
+    pthread_cond_broadcast(&mc->advance);
+  } else {
+    while (mc->quanta == quantum) {
+      pthread_cond_wait(&mc->advance, &mc->lock);
+    }
+  }
+  pthread_mutex_unlock(&mc->lock);
+}
+
+// an exited core no longer holds the others back
+static void quantum_leave(multicore_t *mc) {
+  pthread_mutex_lock(&mc->lock);
+  mc->running--;
+  if (mc->running > 0 && mc->arrived == mc->running) {
+    mc->arrived = 0;
+    mc->quanta++;
+    pthread_cond_broadcast(&mc->advance);
+  }
+  pthread_mutex_unlock(&mc->lock);
+}
+
+// lockstep: waits until the core is the furthest behind of the running ones, the lowest
+// id on a tie, so that the cores take their cycles in the same order on every run
+static void lockstep_wait(multicore_t *mc, core_t *core) {
+  pthread_mutex_lock(&mc->lock);
+  for (;;) {
+    bool turn = true;
+    for (int i = 0; i < mc->count && turn; i++) {
+      const core_t *other = &mc->cores[i];
+      if (other != core && !other->exited &&
+          (other->now < core->now || (other->now == core->now && other->id < core->id))) {
+        turn = false;
+      }
+    }
+    if (turn) {
+      break;
+    }
+    pthread_cond_wait(&mc->advance, &mc->lock);
+  }
+  pthread_mutex_unlock(&mc->lock);
+}
+
+// lockstep: hands the turn on once the core has moved to cycle `now`, or has exited
+static void lockstep_done(multicore_t *mc, core_t *core, uint64_t now, bool exited) {
+  pthread_mutex_lock(&mc->lock);
+  core->now = now;
+  core->exited = exited;
+  if (exited) {
+    mc->running--;
+  }
+  pthread_cond_broadcast(&mc->advance);
+  pthread_mutex_unlock(&mc->lock);
+}
+
+// one core, on its own thread: the pipeline counters of pipeline.h are this thread's copies
+static void *core_run(void *arg) {
+  core_t *core = arg;
+  multicore_t *mc = core->system;
+  bool ecall_exit = false;
+  uint64_t quantum_end = mc->quantum;
+
+  core_id = core->id;
+  storebuf_init(&store_buffer, sim_config.storebuf_depth);
+  bootstrap(&core->pwires, &core->pregs, &core->regfile);
+  bool running = true;
+  while (running) {
+    if (mc->quantum == 0) {
+      lockstep_wait(mc, core);
+    }
+    #if defined(DEBUG_CYCLE) || defined(DEBUG_REG_TRACE)
+    flockfile(stdout); // the lines of one core's cycle stay together
+    #endif
+    cycle_pipeline(&core->regfile, mc->memory, &core->cache, &core->icache, &core->pregs, &core->pwires, &ecall_exit);
+    #if defined(DEBUG_CYCLE) || defined(DEBUG_REG_TRACE)
+    funlockfile(stdout);
+    #endif
+    running = !ecall_exit && (mc->limit == 0 || total_cycle_counter < mc->limit);
+    // drained while the core still holds the lockstep turn
+    if (!running && sim_config.storebuf_depth > 0) {
+      storebuf_flush(&store_buffer, mc->memory);
+    }
+    if (mc->quantum == 0) {
+      lockstep_done(mc, core, total_cycle_counter + mem_stall_counter, !running);
+      continue;
+    }
+    // a long memory stall can carry a core over several quanta, it waits at each
+    while (running && total_cycle_counter + mem_stall_counter >= quantum_end) {
+      quantum_wait(mc);
+      quantum_end += mc->quantum;
+    }
+  }
+  if (mc->quantum > 0) {
+    quantum_leave(mc);
+  }
+
+  core->cycles = total_cycle_counter;
+  core->mem_stalls = mem_stall_counter;
+  core->stalls = stall_counter;
+  core->hits = hit_count;
+  core->misses = miss_count;
+  core->icache_hits = icache_hit_count;
+  core->icache_misses = icache_miss_count;
+  core->fetch_stalls = fetch_stall_counter;
+  core->atomics = atomic_counter;
+  core->sc_failures = sc_fail_counter;
+  return NULL;
+}
+
+void multicore_run(multicore_t *mc, uint64_t limit) {
+  mc->limit = limit;
+  mc->running = mc->count;
+  for (int i = 0; i < mc->count; i++) {
+    int err = pthread_create(&mc->cores[i].thread, NULL, core_run, &mc->cores[i]);
+    assert(err == 0);
+  }
+  for (int i = 0; i < mc->count; i++) {
+    pthread_join(mc->cores[i].thread, NULL);
+  }
+}
+
+uint64_t multicore_cycles(const multicore_t *mc) {
+  uint64_t cycles = 0;
+  for (int i = 0; i < mc->count; i++) {
+    if (mc->cores[i].cycles > cycles) {
+      cycles = mc->cores[i].cycles;
+    }
+  }
+  return cycles;
+}
+
+void multicore_free(multicore_t *mc) {
+  for (int i = 0; i < mc->count; i++) {
+    deallocate(&mc->cores[i].cache);
+    deallocate(&mc->cores[i].icache);
+  }
+  free(mc->cores);
+  mc->cores = NULL;
+  pthread_mutex_destroy(&mc->lock);
+  pthread_cond_destroy(&mc->advance);
+}
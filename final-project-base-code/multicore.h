@@ -0,0 +1,103 @@
+#ifndef __MULTICORE_H__
+#define __MULTICORE_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "cache.h"
+#include "pipeline.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// Multi-core configuration (-N): copies of the 5-stage pipeline, each with its
+/// own register file, pipeline registers and L1s, running the same program out
+/// of the shared memory. Core i starts with a0 = i and its stack pointer
+/// MULTICORE_STACK_BYTES below core i-1's, and runs until its exit ecall or for
+/// a fixed number of cycles. Each core is simulated on its own host thread.
+/// With a quantum of 0 (the default) the cores run in lockstep: the core that is
+/// furthest behind, the lowest id on a tie, simulates the next cycle while the
+/// others wait, so the order of the directory requests, and the stats, are the
+/// same on every run. With `-N <cores>,<quantum>` they run in parallel and meet
+/// at a barrier every `quantum` cycles, so that no core runs more than a quantum
+/// ahead of the others; that is faster, but the order in which the threads
+/// reach the directory within a quantum, and with it the stats, can change from
+/// one run to the next. The L1Ds are kept coherent by the directory of
+/// coherence.h.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MULTICORE_QUANTUM
+#define MULTICORE_QUANTUM 0           // cycles between barriers, 0 is lockstep, -N <cores>,<quantum> overrides it
+#endif
+#ifndef MULTICORE_STACK_BYTES
+#define MULTICORE_STACK_BYTES 0x10000 // stack of each core
+#endif
+#define MULTICORE_MAX_CORES 16
+
+typedef struct
+{
+  int id;
+  char names[2][8];        // of its L1D and L1I
+  regfile_t regfile;
+  pipeline_regs_t pregs;
+  pipeline_wires_t pwires;
+  Cache cache;
+  Cache icache;
+  pthread_t thread;
+  struct multicore *system;
+  uint64_t now;            // its cycle, lockstep only
+  bool exited;
+
+  // its counters (see pipeline.h), copied from its thread when it exits
+  uint64_t cycles;
+  uint64_t mem_stalls;
+  uint64_t stalls;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t icache_hits;
+  uint64_t icache_misses;
+  uint64_t fetch_stalls;
+  uint64_t atomics;
+  uint64_t sc_failures;
+}core_t;
+
+typedef struct multicore
+{
+  int count;
+  uint64_t quantum;
+  uint64_t limit;    // cycles every core runs, 0 runs each until its exit ecall
+  Byte *memory;
+  core_t *cores;
+
+  // quantum barrier, and the lockstep turn
+  pthread_mutex_t lock;
+  pthread_cond_t advance;
+  int running;       // cores that have not exited
+  int arrived;       // cores waiting for the current quantum to end
+  uint64_t quanta;   // quanta completed
+}multicore_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * sets up `cores` cores that start from the registers in `boot`, with L1s configured like
+ * `cache` and `icache` (geometry, policies, write policy, MSHRs and victim cache)
+ **/
+void multicore_init(multicore_t *mc, int cores, uint64_t quantum, Byte *memory, const regfile_t *boot,
+                    const Cache *cache, const Cache *icache);
+
+/**
+ * runs every core on its own host thread until all of them have exited: after `limit`
+ * cycles, or at their exit ecall if `limit` is 0
+ **/
+void multicore_run(multicore_t *mc, uint64_t limit);
+
+/**
+ * output : cycles until the last core exited
+ **/
+uint64_t multicore_cycles(const multicore_t *mc);
+
+void multicore_free(multicore_t *mc);
+
+#endif // __MULTICORE_H__
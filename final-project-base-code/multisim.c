@@ -0,0 +1,110 @@
+#include <limits.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "multisim.h"
+
+// macros rather than functions: passing these vectors by value changes the ABI without AVX-512
+#define SPLAT(x) ((multisim_vec_t){0} + (long long)(x))
+#define BLEND(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))  // a where the mask is set, b elsewhere
+#define MASK(cmp) ((multisim_vec_t)(cmp))
+
+bool multisim_supports(int policy) {
+  return (policy == REPLACE_LRU || policy == REPLACE_LFU || policy == REPLACE_SRRIP)
+         && CACHE_WRITE_BACK && CACHE_WRITE_ALLOCATE;
+}
+
+void multisim_init(multisim_t *ms, int setBits, int blockBits, const int *ways, const int *policies, int lanes) {
+  assert(lanes >= 1 && lanes <= MULTISIM_LANES);
+  memset(ms, 0, sizeof(*ms));
+  ms->setBits = setBits;
+  ms->blockBits = blockBits;
+  ms->lanes = lanes;
+  for (int k = 0; k < lanes; k++) {
+    assert(multisim_supports(policies[k]));
+    ms->maxWays = (ways[k] > ms->maxWays) ? ways[k] : ms->maxWays;
+    ms->used[k] = -1;
+    ms->lfu[k] = (policies[k] == REPLACE_LFU) ? -1 : 0;
+    ms->rrip[k] = (policies[k] == REPLACE_SRRIP) ? -1 : 0;
+  }
+
+  size_t count = ((size_t)1 << setBits) * ms->maxWays;
+  ms->sets = aligned_alloc(sizeof(multisim_vec_t), count * sizeof(multisim_way_t));
+  assert(ms->sets != NULL);
+  for (size_t i = 0; i < count; i++) {
+    int w = i % ms->maxWays;
+    multisim_way_t *way = &ms->sets[i];
+    memset(way, 0, sizeof(*way));
+    for (int k = 0; k < MULTISIM_LANES; k++) {
+      way->tag[k] = (k < lanes && w < ways[k]) ? CACHE_TAG_INVALID : CACHE_TAG_PAD;
+    }
+  }
+}
+
+/* Every lane does what accessCache does for its own configuration, in one pass over
+ * the ways of the set:
+ *     1) a hit refreshes the stamp; LFU lanes also count it, SRRIP lanes predict a
+ *        near re-reference (0).
+ *     2) a miss fills the first empty way, or else the victim: the way with the
+ *        smallest (primary, stamp), first way on ties. The primary is the access
+ *        count for LFU, 0 for LRU and RRIP_MAX - prediction for SRRIP, whose other
+ *        ways then age by the victim's distance from RRIP_MAX, as replace_victim does.
+ *     3) evicting a dirty way counts a writeback; a write marks the way dirty.
+ */
+void multisim_access(multisim_t *ms, unsigned long long address, int type) {
+  unsigned long long set = (address >> ms->blockBits) & ((1ULL << ms->setBits) - 1);
+  multisim_vec_t tag = SPLAT(address >> (ms->blockBits + ms->setBits));
+  multisim_vec_t write = SPLAT((type == CACHE_WRITE) ? 1 : 0);
+  multisim_vec_t now = SPLAT(++ms->now);
+  multisim_vec_t ones = SPLAT(1);
+  multisim_way_t *ways = &ms->sets[set * ms->maxWays];
+
+  multisim_vec_t hit = SPLAT(0), found_free = SPLAT(0), free_way = SPLAT(0);
+  multisim_vec_t best_primary = SPLAT(LLONG_MAX), best_stamp = SPLAT(LLONG_MAX), victim = SPLAT(0);
+  for (int w = 0; w < ms->maxWays; w++) {
+    multisim_way_t *way = &ways[w];
+    multisim_vec_t eq = MASK(way->tag == tag);
+    hit |= eq;
+    way->stamp = BLEND(eq, now, way->stamp);
+    way->key = BLEND(eq, BLEND(ms->rrip, SPLAT(0), way->key + (ms->lfu & ones)), way->key);
+    way->dirty |= eq & write;
+
+    multisim_vec_t empty = MASK(way->tag == SPLAT(CACHE_TAG_INVALID)) & ~found_free;
+    free_way = BLEND(empty, SPLAT(w), free_way);
+    found_free |= empty;
+
+    multisim_vec_t active = ~MASK(way->tag == SPLAT(CACHE_TAG_PAD));
+    multisim_vec_t primary = BLEND(ms->rrip, SPLAT(RRIP_MAX) - way->key, way->key);
+    multisim_vec_t stamp = BLEND(ms->rrip, SPLAT(0), way->stamp);
+    multisim_vec_t better = active & (MASK(primary < best_primary)
+                                      | (MASK(primary == best_primary) & MASK(stamp < best_stamp)));
+    best_primary = BLEND(better, primary, best_primary);
+    best_stamp = BLEND(better, stamp, best_stamp);
+    victim = BLEND(better, SPLAT(w), victim);
+  }
+
+  multisim_vec_t miss = ms->used & ~hit;
+  multisim_vec_t evict = miss & ~found_free;
+  multisim_vec_t target = BLEND(found_free, free_way, victim);
+  multisim_vec_t age = evict & ms->rrip & best_primary;  // SRRIP ageing of the full set
+  multisim_vec_t fill_key = BLEND(ms->rrip, SPLAT(RRIP_MAX - 1), ms->lfu & ones);
+  for (int w = 0; w < ms->maxWays; w++) {
+    multisim_way_t *way = &ways[w];
+    multisim_vec_t active = ~MASK(way->tag == SPLAT(CACHE_TAG_PAD));
+    multisim_vec_t fill = miss & MASK(target == SPLAT(w));
+    way->key += active & age;
+    ms->writebacks += evict & fill & way->dirty;
+    way->tag = BLEND(fill, tag, way->tag);
+    way->stamp = BLEND(fill, now, way->stamp);
+    way->key = BLEND(fill, fill_key, way->key);
+    way->dirty = BLEND(fill, write, way->dirty);
+  }
+
+  ms->hits += hit & ones;  // PAD never matches, so unused lanes never hit
+  ms->misses += miss & ones;
+  ms->evictions += evict & ones;
+}
+
+void multisim_free(multisim_t *ms) {
+  free(ms->sets);
+  ms->sets = NULL;
+}
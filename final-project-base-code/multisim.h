@@ -0,0 +1,75 @@
+#ifndef __MULTISIM_H__
+#define __MULTISIM_H__
+
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Lane-parallel simulation of several cache configurations that share the set
+/// count and block size. Lane k of every vector belongs to configuration k, so
+/// one decoded access updates all of them with vector compares and blends.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MULTISIM_LANES           // configurations per batch: one 64-bit lane each, one register wide
+#if defined(__AVX512F__)
+#define MULTISIM_LANES 8
+#elif defined(__AVX2__)
+#define MULTISIM_LANES 4
+#else
+#define MULTISIM_LANES 2
+#endif
+#endif
+
+// signed, so the ordering compares map onto pcmpgtq; tags only use ==
+typedef long long multisim_vec_t __attribute__((vector_size(MULTISIM_LANES * sizeof(long long))));
+
+// one way of one set, for every lane
+typedef struct
+{
+  multisim_vec_t tag;    // CACHE_TAG_INVALID when empty, CACHE_TAG_PAD past the lane's associativity
+  multisim_vec_t stamp;  // time of the last access (LRU, and the LFU tie-break)
+  multisim_vec_t key;    // access count (LFU), re-reference prediction (SRRIP), 0 (LRU)
+  multisim_vec_t dirty;  // 1 if written since the fill
+}multisim_way_t;
+
+typedef struct
+{
+  int setBits;
+  int blockBits;
+  int maxWays;
+  int lanes;
+  multisim_vec_t used;   // all ones in lanes 0..lanes-1
+  multisim_vec_t lfu;    // all ones in LFU lanes
+  multisim_vec_t rrip;   // all ones in SRRIP lanes
+  multisim_way_t *sets;  // maxWays entries per set
+  unsigned long long now;
+
+  // per-lane stats
+  multisim_vec_t hits;
+  multisim_vec_t misses;
+  multisim_vec_t evictions;
+  multisim_vec_t writebacks;
+}multisim_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * output : true for the replacement policies a lane can model (LRU, LFU and SRRIP), with
+ *          the write-back, write-allocate policy of the scalar cache
+ **/
+bool multisim_supports(int policy);
+
+/**
+ * sets up `lanes` configurations: lane k has ways[k] lines per set and policies[k]
+ **/
+void multisim_init(multisim_t *ms, int setBits, int blockBits, const int *ways, const int *policies, int lanes);
+
+/**
+ * one access (CACHE_READ or CACHE_WRITE) for every lane
+ **/
+void multisim_access(multisim_t *ms, unsigned long long address, int type);
+
+void multisim_free(multisim_t *ms);
+
+#endif // __MULTISIM_H__
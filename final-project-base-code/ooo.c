@@ -0,0 +1,547 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h> // for exit()
+#include "cache.h"
+#include "riscv.h"
+#include "types.h"
+#include "utils.h"
+#include "pipeline.h"
+#include "ooo.h"
+
+static const int rs_capacity[FU_COUNT] = {OOO_RS_ALU_SIZE, OOO_RS_MULDIV_SIZE, OOO_RS_MEM_SIZE, OOO_RS_BRANCH_SIZE};
+static const int fu_count[FU_COUNT] = {OOO_NUM_ALU, OOO_NUM_MULDIV, OOO_NUM_MEM, OOO_NUM_BRANCH};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Decode helpers
+///////////////////////////////////////////////////////////////////////////////
+
+static Alignment mem_alignment(unsigned int funct3) {
+  switch (funct3 & 0x3) {
+    case 0x0:
+      return LENGTH_BYTE;
+    case 0x1:
+      return LENGTH_HALF_WORD;
+    default:
+      return LENGTH_WORD;
+  }
+}
+
+// truncates loaded or forwarded data to the load size, sign extended unless funct3 is lbu/lhu
+static uint32_t extend_load(uint32_t value, unsigned int funct3) {
+  switch (funct3) {
+    case 0x0: return sign_extend_number(value & 0xff, 8);
+    case 0x1: return sign_extend_number(value & 0xffff, 16);
+    case 0x4: return value & 0xff;
+    case 0x5: return value & 0xffff;
+    default:  return value;
+  }
+}
+
+// value of a load of `size` bytes from memory
+static uint32_t load_value(Byte* memory_p, uint32_t addr, unsigned int funct3) {
+  Alignment size = mem_alignment(funct3);
+  if (addr > MEMORY_SPACE - size) {
+    return 0; // only reachable on a wrong path, which is squashed before commit
+  }
+  return extend_load(load(memory_p, addr, size), funct3);
+}
+
+static int rob_index(const ooo_core_t* core, int offset) {
+  return (core->rob_head + offset) % OOO_ROB_SIZE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Recovery
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * squashes every ROB entry younger than `tag`, together with their reservation
+ * station entries, rebuilds the alias table from the surviving entries and
+ * redirects fetch to `next_pc`
+ **/
+static void squash_after(ooo_core_t* core, int tag, uint32_t next_pc) {
+  int keep = (tag - core->rob_head + OOO_ROB_SIZE) % OOO_ROB_SIZE + 1;
+
+  for (int i = keep; i < core->rob_count; i++) {
+    rob_entry_t* entry = &core->rob[rob_index(core, i)];
+    if (entry->is_load || entry->is_store) {
+      core->lsq_count--;
+    }
+    entry->valid = false;
+    core->squashed++;
+  }
+  core->rob_count = keep;
+
+  for (int fu = 0; fu < FU_COUNT; fu++) {
+    for (int i = 0; i < rs_capacity[fu]; i++) {
+      if (core->rs[fu][i].busy && core->rs[fu][i].seq > core->rob[tag].seq) {
+        core->rs[fu][i].busy = false;
+      }
+    }
+  }
+
+  for (int r = 0; r < 32; r++) {
+    core->rat[r] = -1;
+  }
+  for (int i = 0; i < core->rob_count; i++) {
+    int idx = rob_index(core, i);
+    if (core->rob[idx].rd != 0) {
+      core->rat[core->rob[idx].rd] = idx;
+    }
+  }
+
+  core->fq_count = 0;
+  core->fetch_pc = next_pc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Pipeline steps (called back to front each cycle)
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * retires up to `width` completed instructions from the ROB head in program order.
+ * Stores write memory here, so wrong-path stores never become visible.
+ **/
+static void ooo_commit(ooo_core_t* core, regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, bool* ecall_exit) {
+  for (int n = 0; n < core->width && core->rob_count > 0; n++) {
+    int tag = core->rob_head;
+    rob_entry_t* entry = &core->rob[tag];
+    if (!entry->done) {
+      break;
+    }
+    if ((entry->instr_bits & 0x7F) == 0x2F) {
+      // RV32A is only modelled by the in-order pipelines, it must not retire as a nop
+      fprintf(stderr, "[OOO]: atomic instruction [%08x]@[%08x] is not supported out of order\n", entry->instr_bits, entry->pc);
+      exit(-1);
+    }
+
+    if (entry->is_store) {
+      if (sim_config.storebuf_depth > 0) {
+        if (store_buffer.count == store_buffer.depth) {
+          store_buffer.full_stalls++; // commit waits for the buffer to drain
+          break;
+        }
+        storebuf_insert(&store_buffer, memory_p, cache_p, total_cycle_counter, entry->addr, entry->size, entry->store_data);
+      } else {
+        store(memory_p, entry->addr, entry->size, entry->store_data);
+        data_access_latency(entry->addr, entry->pc, CACHE_WRITE, cache_p, total_cycle_counter); // drains behind commit, only the cache state is modeled
+      }
+    }
+    if (entry->is_load || entry->is_store) {
+      core->lsq_count--;
+    }
+    if (entry->rd != 0) {
+      regfile_p->R[entry->rd] = entry->value;
+      if (core->rat[entry->rd] == tag) {
+        core->rat[entry->rd] = -1;
+      }
+    }
+    regfile_p->PC = entry->next_pc;
+
+    #ifdef DEBUG_CYCLE
+    printf("[CMT]: Instruction [%08x]@[%08x]: ", entry->instr_bits, entry->pc);
+    decode_instruction(entry->instr_bits);
+    #endif
+
+    entry->valid = false;
+    core->rob_head = (core->rob_head + 1) % OOO_ROB_SIZE;
+    core->rob_count--;
+    core->committed++;
+
+    if (entry->is_ecall && regfile_p->R[10] == 10) {
+      *(ecall_exit) = true;
+      break;
+    }
+  }
+}
+
+/**
+ * completes the instructions whose functional unit latency has elapsed, broadcasts
+ * their results to the reservation stations and recovers from the oldest mispredict
+ **/
+static void ooo_writeback(ooo_core_t* core) {
+  for (int i = 0; i < core->rob_count; i++) {
+    int tag = rob_index(core, i);
+    rob_entry_t* entry = &core->rob[tag];
+    if (!entry->executing || entry->done_cycle > total_cycle_counter) {
+      continue;
+    }
+
+    entry->executing = false;
+    entry->done = true;
+    for (int fu = 0; fu < FU_COUNT; fu++) {
+      for (int j = 0; j < rs_capacity[fu]; j++) {
+        rs_entry_t* rs = &core->rs[fu][j];
+        for (int s = 0; s < 2; s++) {
+          if (rs->busy && rs->src_tag[s] == tag) {
+            rs->src_tag[s] = -1;
+            rs->src_val[s] = entry->value;
+          }
+        }
+      }
+    }
+
+    if (entry->mispredict) {
+      core->mispredicts++;
+      squash_after(core, tag, entry->next_pc);
+      break; // everything younger is gone
+    }
+  }
+}
+
+/**
+ * true if the load in ROB entry `tag` may access memory: every older store has its
+ * address. If the youngest overlapping older store covers the load its data is
+ * forwarded through *forwarded; a partial overlap waits for the store to commit.
+ **/
+static bool load_can_issue(ooo_core_t* core, int tag, uint32_t addr, Alignment size, bool* forwarded, uint32_t* value) {
+  int age = (tag - core->rob_head + OOO_ROB_SIZE) % OOO_ROB_SIZE;
+  *forwarded = false;
+
+  for (int i = age - 1; i >= 0; i--) {
+    rob_entry_t* older = &core->rob[rob_index(core, i)];
+    if (!older->is_store) {
+      continue;
+    }
+    if (!older->addr_ready) {
+      return false;
+    }
+    bool overlap = (older->addr < addr + size) && (addr < older->addr + older->size);
+    if (overlap && !*forwarded) {
+      if (older->addr != addr || older->size < size) {
+        return false;
+      }
+      *forwarded = true;
+      *value = older->store_data;
+    }
+  }
+  return true;
+}
+
+/**
+ * starts execution of the oldest ready reservation station entries, up to the
+ * number of units of each class
+ **/
+static void ooo_issue(ooo_core_t* core, Byte* memory_p, Cache* cache_p) {
+  bool unit_blocked[FU_UNIT_COUNT] = {0}; // a ready operation waited for the busy unit this cycle
+
+  for (int fu = 0; fu < FU_COUNT; fu++) {
+    for (int started = 0; started < fu_count[fu]; started++) {
+      rs_entry_t* pick = NULL;
+      bool forwarded = false;
+      uint32_t forward_value = 0;
+
+      for (int i = 0; i < rs_capacity[fu]; i++) {
+        rs_entry_t* rs = &core->rs[fu][i];
+        if (!rs->busy || rs->src_tag[0] != -1 || rs->src_tag[1] != -1) continue;
+        if (pick != NULL && rs->seq > pick->seq) continue;
+
+        rob_entry_t* entry = &core->rob[rs->rob_tag];
+        if (fu == FU_MULDIV) {
+          Instruction candidate = { .bits = entry->instr_bits };
+          int unit = fu_timing(candidate, sim_config.fu_en).unit;
+          if (!fu_unit_free(&core->fu, unit, total_cycle_counter)) {
+            unit_blocked[unit] = true;
+            continue;
+          }
+        }
+        if (entry->is_load) {
+          // older stores hold physical addresses, so the load is translated once before it is compared
+          if (!entry->addr_ready) {
+            entry->addr_cycle = total_cycle_counter;
+            entry->addr = data_translate(execute_alu(rs->src_val[0], rs->imm, 0x0), MMU_LOAD, &entry->addr_cycle);
+            entry->addr_ready = true;
+          }
+          bool fwd;
+          uint32_t value = 0;
+          if (!load_can_issue(core, rs->rob_tag, entry->addr, entry->size, &fwd, &value)) continue;
+          forwarded = fwd;
+          forward_value = value;
+        }
+        pick = rs;
+      }
+      if (pick == NULL) {
+        break;
+      }
+
+      rob_entry_t* entry = &core->rob[pick->rob_tag];
+      Instruction instr = { .bits = entry->instr_bits };
+      int latency = 1;
+
+      switch (fu) {
+        case FU_ALU:
+        case FU_MULDIV:
+          entry->value = execute_alu(pick->src_val[0], pick->src_val[1], pick->alu_op);
+          latency = fu_issue(&core->fu, instr, sim_config.fu_en, total_cycle_counter) - total_cycle_counter;
+          break;
+        case FU_MEM: {
+          // the address is physical from here on; a D-TLB miss delays the access by the page walk
+          uint64_t start = total_cycle_counter;
+          if (entry->is_store) {
+            entry->addr = data_translate(execute_alu(pick->src_val[0], pick->imm, 0x0), MMU_STORE, &start);
+            entry->addr_ready = true;
+          } else if (entry->addr_cycle > start) {
+            start = entry->addr_cycle;
+          }
+          latency += start - total_cycle_counter;
+          if (entry->is_store) {
+            entry->store_data = pick->src_val[1];
+          } else if (forwarded) {
+            entry->value = extend_load(forward_value, instr.itype.funct3);
+            core->load_forwards++;
+          } else {
+            // committed stores still waiting in the store buffer are younger than memory
+            int sb_forward = SB_FORWARD_NONE;
+            if (sim_config.storebuf_depth > 0) {
+              sb_forward = storebuf_forward(&store_buffer, entry->addr, entry->size, &forward_value);
+              if (sb_forward == SB_FORWARD_CONFLICT) {
+                start = storebuf_drain_conflict(&store_buffer, memory_p, cache_p, start, entry->addr, entry->size);
+              }
+            }
+            if (sb_forward == SB_FORWARD_HIT) {
+              entry->value = extend_load(forward_value, instr.itype.funct3);
+            } else {
+              entry->value = load_value(memory_p, entry->addr, instr.itype.funct3);
+              latency = (start - total_cycle_counter) + data_access_latency(entry->addr, entry->pc, CACHE_READ, cache_p, start);
+            }
+          }
+          mem_stall_counter += latency - 1; // as in the MEM stage, though here the rest of the window runs on
+          break;
+        }
+        case FU_BRANCH:
+          if (instr.opcode == 0x63) {
+            bool taken = gen_branch(instr, pick->src_val[0], pick->src_val[1]);
+            entry->next_pc = taken ? entry->pc + pick->imm : entry->pc + 4;
+          } else { // jalr
+            entry->next_pc = (pick->src_val[0] + pick->imm) & ~1u;
+            entry->value = entry->pc + 4;
+          }
+          entry->mispredict = (entry->next_pc != entry->pc + 4); // fetch predicts fall-through
+          break;
+      }
+
+      entry->executing = true;
+      entry->done_cycle = total_cycle_counter + latency;
+      pick->busy = false;
+    }
+  }
+
+  for (int unit = 0; unit < FU_UNIT_COUNT; unit++) {
+    core->fu.unit[unit].structural_stalls += unit_blocked[unit];
+  }
+}
+
+// reads a source operand at rename: a captured value, or the tag of the ROB entry that will produce it
+static void rename_source(ooo_core_t* core, regfile_t* regfile_p, unsigned int reg, int* tag, uint32_t* value) {
+  int producer = core->rat[reg];
+  *tag = -1;
+  if (reg == 0 || producer == -1) {
+    *value = regfile_p->R[reg];
+  } else if (core->rob[producer].done) {
+    *value = core->rob[producer].value;
+  } else {
+    *tag = producer;
+  }
+}
+
+/**
+ * renames and dispatches up to `width` instructions from the fetch queue into the
+ * ROB, the reservation stations and the load/store queue. Dispatch stops in order
+ * at the first instruction that does not find space.
+ **/
+static void ooo_dispatch(ooo_core_t* core, regfile_t* regfile_p) {
+  for (int n = 0; n < core->width && core->fq_count > 0; n++) {
+    ooo_fetch_t* fetched = &core->fetch_queue[core->fq_head];
+    Instruction instr = { .bits = fetched->instr_bits };
+    int fu = FU_NONE;
+    bool uses_rs1 = false, uses_rs2 = false, is_mem = false;
+    uint32_t imm = 0;
+
+    switch (instr.opcode) {
+      case 0x33: // R-type
+        fu = (instr.rtype.funct7 == 0x01) ? FU_MULDIV : FU_ALU;
+        uses_rs1 = uses_rs2 = true;
+        break;
+      case 0x13: // I-type
+        fu = FU_ALU;
+        uses_rs1 = true;
+        imm = sign_extend_number(instr.itype.imm, 12);
+        if (instr.itype.funct3 == 0x1 || instr.itype.funct3 == 0x5) {
+          imm &= 0x1F; // shamt
+        }
+        break;
+      case 0x03: // loads
+        fu = FU_MEM;
+        uses_rs1 = is_mem = true;
+        imm = sign_extend_number(instr.itype.imm, 12);
+        break;
+      case 0x23: // stores
+        fu = FU_MEM;
+        uses_rs1 = uses_rs2 = is_mem = true;
+        imm = sign_extend_number(get_store_offset(instr), 12);
+        break;
+      case 0x63: // branches
+        fu = FU_BRANCH;
+        uses_rs1 = uses_rs2 = true;
+        imm = get_branch_offset(instr);
+        break;
+      case 0x67: // jalr
+        fu = FU_BRANCH;
+        uses_rs1 = true;
+        imm = sign_extend_number(instr.itype.imm, 12);
+        break;
+      default: // lui, jal, ecall and unknown opcodes complete at dispatch
+        break;
+    }
+
+    if (core->rob_count == OOO_ROB_SIZE) {
+      core->rob_full_stalls++;
+      break;
+    }
+    if (is_mem && core->lsq_count == OOO_LSQ_SIZE) {
+      core->lsq_full_stalls++;
+      break;
+    }
+    rs_entry_t* rs = NULL;
+    if (fu != FU_NONE) {
+      for (int i = 0; i < rs_capacity[fu] && rs == NULL; i++) {
+        if (!core->rs[fu][i].busy) rs = &core->rs[fu][i];
+      }
+      if (rs == NULL) {
+        core->rs_full_stalls++;
+        break;
+      }
+    }
+
+    int tag = rob_index(core, core->rob_count);
+    rob_entry_t* entry = &core->rob[tag];
+    *entry = (rob_entry_t){0};
+    entry->valid = true;
+    entry->seq = core->seq++;
+    entry->pc = fetched->pc;
+    entry->instr_bits = fetched->instr_bits;
+    entry->next_pc = fetched->pc + 4;
+    entry->is_load = (instr.opcode == 0x03);
+    entry->is_store = (instr.opcode == 0x23);
+    entry->size = mem_alignment(instr.itype.funct3);
+    entry->is_ecall = (instr.opcode == 0x73);
+
+    switch (instr.opcode) {
+      case 0x37: // lui
+        entry->value = instr.utype.imm << 12;
+        entry->done = true;
+        break;
+      case 0x6F: // jal, already followed by fetch
+        entry->value = fetched->pc + 4;
+        entry->next_pc = fetched->pc + (sWord)sign_extend_number(get_jump_offset(instr), 20);
+        entry->done = true;
+        break;
+      default:
+        entry->done = (fu == FU_NONE);
+        break;
+    }
+
+    if (rs != NULL) {
+      rs->busy = true;
+      rs->rob_tag = tag;
+      rs->seq = entry->seq;
+      rs->imm = imm;
+      rs->alu_op = (fu == FU_ALU || fu == FU_MULDIV) ? fu_alu_control(instr) : 0x0;
+      rs->src_tag[0] = rs->src_tag[1] = -1;
+      rs->src_val[0] = rs->src_val[1] = 0;
+      if (uses_rs1) rename_source(core, regfile_p, instr.rtype.rs1, &rs->src_tag[0], &rs->src_val[0]);
+      if (uses_rs2) rename_source(core, regfile_p, instr.rtype.rs2, &rs->src_tag[1], &rs->src_val[1]);
+      if (!uses_rs2 && fu == FU_ALU) rs->src_val[1] = imm; // I-type ALU operand B
+    }
+
+    // rename the destination after reading the sources
+    switch (instr.opcode) {
+      case 0x33: case 0x13: case 0x03: case 0x37: case 0x6F: case 0x67:
+        entry->rd = instr.rtype.rd;
+        break;
+      default:
+        entry->rd = 0;
+        break;
+    }
+    if (entry->rd != 0) {
+      core->rat[entry->rd] = tag;
+    }
+
+    if (is_mem) {
+      core->lsq_count++;
+    }
+    core->rob_count++;
+    core->fq_head = (core->fq_head + 1) % OOO_FETCH_QUEUE_SIZE;
+    core->fq_count--;
+  }
+}
+
+/**
+ * fetches up to `width` instructions along the predicted path: branches and jalr
+ * are predicted not taken, jal is followed immediately
+ **/
+static void ooo_fetch(ooo_core_t* core, Byte* memory_p, Cache* icache_p) {
+  for (int n = 0; n < core->width && core->fq_count < OOO_FETCH_QUEUE_SIZE; n++) {
+    uint32_t pc = core->fetch_pc, paddr;
+    if (fetch_stalled(pc, &paddr, icache_p, total_cycle_counter)) {
+      break;
+    }
+    uint32_t instruction_bits = 0;
+    if (paddr < MEMORY_SPACE - 3) {
+      instruction_bits = load(memory_p, paddr, LENGTH_WORD);
+    }
+    if (instruction_bits == 0) {
+      instruction_bits = 0x00000013; // NOP instruction
+    }
+
+    int tail = (core->fq_head + core->fq_count) % OOO_FETCH_QUEUE_SIZE;
+    core->fetch_queue[tail].pc = pc;
+    core->fetch_queue[tail].instr_bits = instruction_bits;
+    core->fq_count++;
+
+    Instruction instr = { .bits = instruction_bits };
+    if (instr.opcode == 0x6F) {
+      core->fetch_pc = pc + (sWord)sign_extend_number(get_jump_offset(instr), 20);
+      break; // a taken jump ends the fetch group
+    }
+    core->fetch_pc = pc + 4;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ooo_init(ooo_core_t* core, regfile_t* regfile_p, int width) {
+  *core = (ooo_core_t){0};
+  core->width = (width > OOO_MAX_WIDTH) ? OOO_MAX_WIDTH : width;
+  core->fetch_pc = regfile_p->PC;
+  for (int r = 0; r < 32; r++) {
+    core->rat[r] = -1;
+  }
+}
+
+/**
+ * excite the out-of-order core with one clock cycle
+ **/
+void ooo_cycle(ooo_core_t* core, regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, bool* ecall_exit) {
+  #ifdef DEBUG_CYCLE
+  printf("v==============");
+  printf("Cycle Counter = %5ld", total_cycle_counter);
+  printf("==============v\n\n");
+  #endif
+
+  if (sim_config.storebuf_depth > 0) {
+    storebuf_tick(&store_buffer, memory_p, cache_p, total_cycle_counter);
+  }
+  ooo_commit(core, regfile_p, memory_p, cache_p, ecall_exit);
+  ooo_writeback(core);
+  ooo_issue(core, memory_p, cache_p);
+  ooo_dispatch(core, regfile_p);
+  ooo_fetch(core, memory_p, icache_p);
+
+  // increment the cycle
+  total_cycle_counter++;
+
+  #ifdef DEBUG_REG_TRACE
+  print_register_trace(regfile_p);
+  #endif
+}
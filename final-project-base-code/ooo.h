@@ -0,0 +1,158 @@
+#ifndef __OOO_H__
+#define __OOO_H__
+
+#include "config.h"
+#include "types.h"
+#include "riscv.h"
+#include "cache.h"
+#include "fu.h"
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Out-of-order core parameters (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOO_ROB_SIZE
+#define OOO_ROB_SIZE 64       // reorder buffer entries
+#endif
+#ifndef OOO_WIDTH
+#define OOO_WIDTH 2           // default fetch/dispatch/commit width, -w overrides it
+#endif
+#ifndef OOO_RS_ALU_SIZE
+#define OOO_RS_ALU_SIZE 16    // reservation station entries per functional unit class
+#endif
+#ifndef OOO_RS_MULDIV_SIZE
+#define OOO_RS_MULDIV_SIZE 8
+#endif
+#ifndef OOO_RS_MEM_SIZE
+#define OOO_RS_MEM_SIZE 16
+#endif
+#ifndef OOO_RS_BRANCH_SIZE
+#define OOO_RS_BRANCH_SIZE 8
+#endif
+#ifndef OOO_LSQ_SIZE
+#define OOO_LSQ_SIZE 16       // loads and stores in flight
+#endif
+#ifndef OOO_NUM_ALU
+#define OOO_NUM_ALU 2         // units per class that can start an operation each cycle
+#endif
+#ifndef OOO_NUM_MULDIV
+#define OOO_NUM_MULDIV 1
+#endif
+#ifndef OOO_NUM_MEM
+#define OOO_NUM_MEM 1
+#endif
+#ifndef OOO_NUM_BRANCH
+#define OOO_NUM_BRANCH 1
+#endif
+
+#define OOO_MAX_WIDTH 8
+#define OOO_RS_MAX 32
+#define OOO_FETCH_QUEUE_SIZE (2*OOO_MAX_WIDTH)
+
+_Static_assert(OOO_RS_ALU_SIZE <= OOO_RS_MAX && OOO_RS_MULDIV_SIZE <= OOO_RS_MAX &&
+               OOO_RS_MEM_SIZE <= OOO_RS_MAX && OOO_RS_BRANCH_SIZE <= OOO_RS_MAX,
+               "a reservation station holds at most OOO_RS_MAX entries");
+_Static_assert(OOO_WIDTH <= OOO_MAX_WIDTH, "OOO_WIDTH is larger than OOO_MAX_WIDTH");
+
+enum fu_class_enum {
+  FU_ALU = 0,
+  FU_MULDIV = 1,
+  FU_MEM = 2,
+  FU_BRANCH = 3,
+  FU_COUNT = 4,
+  FU_NONE = -1  // completes at dispatch (lui, jal, ecall)
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Out-of-order core state
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+  bool valid;
+  bool done;        // result available, entry may commit
+  bool executing;   // issued to a functional unit, completes at done_cycle
+  uint64_t done_cycle;
+  uint64_t seq;     // program order, used to squash younger reservation station entries
+
+  uint32_t pc;
+  uint32_t instr_bits;
+  unsigned int rd;  // 0 if the instruction has no register result
+  uint32_t value;
+
+  bool is_load;
+  bool is_store;
+  bool addr_ready;
+  uint32_t addr;        // physical
+  uint64_t addr_cycle;  // a load's address is translated before it issues, a D-TLB walk ends here
+  Alignment size;
+  uint32_t store_data;
+
+  bool is_ecall;
+  bool mispredict;  // resolved control transfer disagrees with the fetched path
+  uint32_t next_pc;
+}rob_entry_t;
+
+typedef struct
+{
+  bool busy;
+  int rob_tag;
+  uint64_t seq;
+  uint32_t alu_op;
+  int src_tag[2];       // ROB entry producing the operand, -1 once the value is captured
+  uint32_t src_val[2];
+  uint32_t imm;
+}rs_entry_t;
+
+typedef struct
+{
+  uint32_t pc;
+  uint32_t instr_bits;
+}ooo_fetch_t;
+
+typedef struct
+{
+  int width;
+
+  rob_entry_t rob[OOO_ROB_SIZE];
+  int rob_head;
+  int rob_count;
+  uint64_t seq;
+
+  rs_entry_t rs[FU_COUNT][OOO_RS_MAX];
+  int lsq_count;
+  fu_scoreboard_t fu;   // multiplier/divider occupancy
+  int rat[32];          // register alias table: ROB entry of the newest in-flight writer, -1 for the register file
+
+  ooo_fetch_t fetch_queue[OOO_FETCH_QUEUE_SIZE];
+  int fq_head;
+  int fq_count;
+  uint32_t fetch_pc;
+
+  // stats
+  uint64_t committed;
+  uint64_t mispredicts;
+  uint64_t squashed;
+  uint64_t rob_full_stalls;
+  uint64_t rs_full_stalls;
+  uint64_t lsq_full_stalls;
+  uint64_t load_forwards;
+}ooo_core_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * resets the core; fetch starts at regfile_p->PC
+ **/
+void ooo_init(ooo_core_t* core, regfile_t* regfile_p, int width);
+
+/**
+ * excite the out-of-order core with one clock cycle.
+ * regfile_p holds the committed architectural state.
+ **/
+void ooo_cycle(ooo_core_t* core, regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, bool* ecall_exit);
+
+#endif // __OOO_H__
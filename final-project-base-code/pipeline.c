@@ -6,18 +6,141 @@
 #include "pipeline.h"
 #include "stage_helpers.h"
 
-uint64_t total_cycle_counter = 0;
-uint64_t miss_count = 0;
-uint64_t hit_count = 0;
-uint64_t stall_counter = 0;
-uint64_t branch_counter = 0;
-uint64_t fwd_exex_counter = 0;
-uint64_t fwd_exmem_counter = 0;
+CORE_LOCAL uint64_t total_cycle_counter = 0;
+CORE_LOCAL uint64_t miss_count = 0;
+CORE_LOCAL uint64_t hit_count = 0;
+CORE_LOCAL uint64_t icache_miss_count = 0;
+CORE_LOCAL uint64_t icache_hit_count = 0;
+CORE_LOCAL uint64_t fetch_stall_counter = 0;
+static CORE_LOCAL uint64_t fetch_ready_cycle = 0; // an instruction cache miss holds fetch until this cycle
+CORE_LOCAL uint64_t stall_counter = 0;
+CORE_LOCAL uint64_t branch_counter = 0;
+CORE_LOCAL uint64_t fwd_exex_counter = 0;
+CORE_LOCAL uint64_t fwd_exmem_counter = 0;
+CORE_LOCAL uint64_t stall_fu_counter = 0;
+CORE_LOCAL uint64_t stall_loaduse_counter = 0;
+CORE_LOCAL uint64_t stall_branch_counter = 0;
+CORE_LOCAL uint64_t mem_access_counter = 0;
+CORE_LOCAL uint64_t mem_stall_counter = 0;
+CORE_LOCAL store_buffer_t store_buffer = {0};
+belady_trace_t opt_trace = {0};
+CORE_LOCAL fu_scoreboard_t fu_scoreboard = {0};
+mmu_t mmu = {0};
+dram_t dram = {0};
+CORE_LOCAL uint64_t instr_retired_counter = 0;
+CORE_LOCAL uint64_t issue_split_mem_counter = 0;
+CORE_LOCAL uint64_t issue_split_raw_counter = 0;
+CORE_LOCAL uint64_t issue_split_ctrl_counter = 0;
+CORE_LOCAL uint64_t atomic_counter = 0;
+CORE_LOCAL uint64_t sc_fail_counter = 0;
+CORE_LOCAL int core_id = 0;
+coherence_t coherence = {0};
 
 simulator_config_t sim_config = {0};
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * performs the L1 lookup of one data access (CACHE_READ or CACHE_WRITE) issued at cycle
+ * `now` by the instruction at `pc` (0 if unknown) and returns its latency in cycles. Without the cache every
+ * access goes to memory.
+ **/
+int data_access_latency(uint32_t addr, uint32_t pc, int type, Cache* cache_p, uint64_t now) {
+  if (!sim_config.cache_en) {
+    mem_access_counter++;
+    if (sim_config.dram_en) {
+      uint64_t done = dram_access(&dram, addr, (type == CACHE_WRITE) ? DRAM_WRITE : DRAM_READ, now);
+      return (done > now) ? done - now : 1;
+    }
+    return (MEM_LATENCY > 0) ? MEM_LATENCY : 1;
+  }
+
+  if (sim_config.opt_en) {
+    belady_record(&opt_trace, addr, type);
+  }
+  // with -N the directory is asked first, and its reply delays the L1 access
+  int coherence_latency = 0;
+  if (sim_config.cores > 1) {
+    coherence_latency = coherence_access(&coherence, core_id, cache_p, addr, type);
+  }
+  cache_p->pc = pc;
+  result r = operateCacheAt(addr, type, cache_p, now + coherence_latency);
+  if (r.status == CACHE_HIT) {
+    hit_count++;
+    #ifdef PRINT_CACHE_TRACES
+    printf(CACHE_HIT_FORMAT, (unsigned long long)addr);
+    #endif
+  } else {
+    miss_count++;
+    #ifdef PRINT_CACHE_TRACES
+    printf((r.status == CACHE_EVICT) ? CACHE_EVICTION_FORMAT : CACHE_MISS_FORMAT, (unsigned long long)addr);
+    #endif
+  }
+  return r.ready_cycle - now;
+}
+
+/**
+ * translates the data address through the D-TLB. Hits overlap the L1 lookup (the L1 is
+ * indexed with the page offset bits); a miss walks the page table first. Without the
+ * MMU addresses are physical.
+ **/
+uint32_t data_translate(uint32_t addr, int access, uint64_t* now) {
+  if (!sim_config.mmu_en) {
+    return addr;
+  }
+  uint32_t paddr;
+  mmu_translate(&mmu, addr, access, *now, now, &paddr); // a fault has no trap to take, the access goes on untranslated
+  return paddr;
+}
+
+/**
+ * performs the I-TLB and I-cache lookups of the fetch at `pc`. Hits are pipelined with IF;
+ * a miss holds fetch until the page walk ends or the block arrives, and the fetch is then
+ * replayed (and hits).
+ **/
+bool fetch_stalled(uint32_t pc, uint32_t* paddr, Cache* icache_p, uint64_t now) {
+  *paddr = pc;
+  if (!sim_config.icache_en && !sim_config.mmu_en) {
+    return false;
+  }
+  if (now < fetch_ready_cycle) {
+    fetch_stall_counter++;
+    return true;
+  }
+
+  if (sim_config.mmu_en) {
+    uint64_t ready;
+    if (mmu_translate(&mmu, pc, MMU_FETCH, now, &ready, paddr) && ready > now) {
+      fetch_ready_cycle = ready;
+      fetch_stall_counter++;
+      return true;
+    }
+  }
+  if (!sim_config.icache_en) {
+    return false;
+  }
+
+  result r = operateCacheAt(*paddr, CACHE_READ, icache_p, now);
+  if (r.status == CACHE_HIT) {
+    icache_hit_count++;
+    #ifdef PRINT_CACHE_TRACES
+    printf(ICACHE_HIT_FORMAT, (unsigned long long)pc);
+    #endif
+  } else {
+    icache_miss_count++;
+    #ifdef PRINT_CACHE_TRACES
+    printf((r.status == CACHE_EVICT) ? ICACHE_EVICTION_FORMAT : ICACHE_MISS_FORMAT, (unsigned long long)pc);
+    #endif
+  }
+
+  if (r.ready_cycle > now + icache_p->hitLatency) {
+    fetch_ready_cycle = r.ready_cycle - icache_p->hitLatency;
+    fetch_stall_counter++;
+    return true;
+  }
+  return false;
+}
+
 void bootstrap(pipeline_wires_t* pwires_p, pipeline_regs_t* pregs_p, regfile_t* regfile_p) {
   // PC src must get the same value as the default PC value
   pwires_p->pc_src0 = regfile_p->PC;
@@ -32,9 +155,9 @@ void bootstrap(pipeline_wires_t* pwires_p, pipeline_regs_t* pregs_p, regfile_t*
  * output : ifid_reg_t
  **/ 
 // Lex
-ifid_reg_t stage_fetch(pipeline_wires_t* pwires_p, regfile_t* regfile_p, Byte* memory_p) {
+ifid_reg_t stage_fetch(pipeline_wires_t* pwires_p, regfile_t* regfile_p, Byte* memory_p, Cache* icache_p) {
   ifid_reg_t ifid_reg = {0};
-  uint32_t instruction_bits;
+  uint32_t instruction_bits = 0; // past the end of memory fetches a nop
   
   // need to find the address (this is the multiplexer before instruction memory)
   if (pwires_p->pcsrc == 0) {
@@ -49,11 +172,24 @@ ifid_reg_t stage_fetch(pipeline_wires_t* pwires_p, regfile_t* regfile_p, Byte* m
   // getting the address for getting instruction from memory
   ifid_reg.instr_addr = ifid_reg.pc; 
 
-  if (ifid_reg.pc < MEMORY_SPACE - 3) {
-    instruction_bits = (memory_p[ifid_reg.pc + 3] << 24) |
-                      (memory_p[ifid_reg.pc + 2] << 16) |
-                      (memory_p[ifid_reg.pc+ 1] << 8) |
-                      (memory_p[ifid_reg.pc]);
+  // instruction cache or I-TLB miss: send a nop down and fetch the same PC again next cycle
+  uint32_t paddr;
+  pwires_p->stall_if = fetch_stalled(ifid_reg.pc, &paddr, icache_p, total_cycle_counter + mem_stall_counter);
+  if (pwires_p->stall_if) {
+    pwires_p->pc_src0 = ifid_reg.pc;
+    ifid_reg.instr_bits = 0x00000013;
+    ifid_reg.instr = parse_instruction(ifid_reg.instr_bits);
+    #ifdef DEBUG_CYCLE
+    printf("[IF ]: I-cache stall @[%08x]\n", ifid_reg.pc);
+    #endif
+    return ifid_reg;
+  }
+
+  if (paddr < MEMORY_SPACE - 3) {
+    instruction_bits = (memory_p[paddr + 3] << 24) |
+                      (memory_p[paddr + 2] << 16) |
+                      (memory_p[paddr + 1] << 8) |
+                      (memory_p[paddr]);
   }
 
   if (instruction_bits == 0) {
@@ -84,14 +220,14 @@ idex_reg_t stage_decode(ifid_reg_t ifid_reg, pipeline_wires_t* pwires_p, regfile
   idex_reg_t idex_reg = {0};
 
   idex_reg = gen_control(ifid_reg.instr); // set control values
-  idex_reg.read_rs1 = regfile_p->R[ifid_reg.write_rs1]; // pull rs1 from regfile
-  idex_reg.read_rs2 = regfile_p->R[ifid_reg.write_rs2]; // pull rs2 from regfile
+  idex_reg.read_rs1 = regfile_p->R[ifid_reg.instr.rtype.rs1]; // pull rs1 from regfile
+  idex_reg.read_rs2 = regfile_p->R[ifid_reg.instr.rtype.rs2]; // pull rs2 from regfile
   idex_reg.read_imm = gen_imm(ifid_reg.instr); // generate an imm value
   idex_reg.instr_bits = ifid_reg.instr_bits; // transfer instruction bits to next stage for debug cycle
   idex_reg.pc = ifid_reg.pc; // set PC to PC from fetch stage
 
   // if we are writing back to reg file we need to save this value for the writeback stage
-  idex_reg.write_rd = ifid_reg.instr.itype.rd;
+  idex_reg.write_rd = ifid_reg.instr.rtype.rd;
 
   #ifdef DEBUG_CYCLE
   printf("[ID ]: Instruction [%08x]@[%08x]: ", ifid_reg.instr_bits, ifid_reg.pc);
@@ -108,75 +244,40 @@ idex_reg_t stage_decode(ifid_reg_t ifid_reg, pipeline_wires_t* pwires_p, regfile
 exmem_reg_t stage_execute(idex_reg_t idex_reg, pipeline_wires_t* pwires_p) {
   exmem_reg_t exmem_reg = {0};
 
+  exmem_reg.instr = idex_reg.instr;
   exmem_reg.instr_bits = idex_reg.instr_bits;
 
-
   idex_reg.alu_op = gen_alu_control(idex_reg);
-  if (idex_reg.read_opcode == 0x63) {
-    gen_branch
-  }
-  exmem_reg.result = (alu_src) ? execute_alu(idex_reg.read_rs1, idex_reg.read_imm, idex_reg.alu_op) : execute_alu(idex_reg.read_rs1, idex_reg.read_rs2, idex_reg.alu_op);
-  
-  switch (idex_reg.read_opcode) {
-    case 0x33: // Rtype
-      idex_reg.reg_write = 1; // should cascade down
-      // intentional fall through
-    case 0x13: // I type ALU
-    case 0x37: // LUI
-    case 0x6F: // jal
-    case 0x67: //JALR
-      idex_reg.mem_to_reg = 0;
-      break;
-    case 0x03: // I type load
-      idex_reg.mem_to_reg = 1;
-      idex_reg.mem_read = 1;
-      idex_reg.reg_write = 1;
-      break;
-    case 0x23: //S type
-      idex_reg.mem_write = 1;
-      break;
-    default: // idk what to put for error code
-      break;
-  }
-
+  uint32_t alu_inp2 = (idex_reg.alu_src) ? idex_reg.read_imm : idex_reg.read_rs2;
+  exmem_reg.result = execute_alu(idex_reg.read_rs1, alu_inp2, idex_reg.alu_op);
 
-
-
-  idex_reg.alu_op = gen_alu_control(idex_reg);
-  if (idex_reg.read_opcode == 0x63) {
-    gen_branch
-  }
-  exmem_reg.result = (alu_src) ? execute_alu(idex_reg.read_rs1, idex_reg.read_imm, idex_reg.alu_op) : execute_alu(idex_reg.read_rs1, idex_reg.read_rs2, idex_reg.alu_op);
-  
   switch (idex_reg.read_opcode) {
-    case 0x33: // Rtype
-      idex_reg.reg_write = 1; // should cascade down
-      // intentional fall through
-    case 0x13: // I type ALU
-    case 0x37: // LUI
-    case 0x6F: // jal
-    case 0x67: //JALR
-      idex_reg.mem_to_reg = 0;
+    case 0x37: // lui
+      exmem_reg.result = idex_reg.read_imm;
       break;
-    case 0x03: // I type load
-      idex_reg.mem_to_reg = 1;
-      idex_reg.mem_read = 1;
-      idex_reg.reg_write = 1;
+    case 0x63: // branch, decided in MEM
+      exmem_reg.branch_target = idex_reg.pc + idex_reg.read_imm;
       break;
-    case 0x23: //S type
-      idex_reg.mem_write = 1;
+    case 0x6F: // jal, rd gets the return address
+      exmem_reg.branch_target = idex_reg.pc + idex_reg.read_imm;
+      exmem_reg.result = idex_reg.pc + 4;
       break;
-    default: // idk what to put for error code
+    case 0x67: // jalr
+      exmem_reg.branch_target = exmem_reg.result & ~1;
+      exmem_reg.result = idex_reg.pc + 4;
+      break;
+    default:
       break;
   }
 
-
-
   exmem_reg.pc = idex_reg.pc;
   exmem_reg.mem_read = idex_reg.mem_read;
   exmem_reg.mem_to_reg = idex_reg.mem_to_reg;
   exmem_reg.mem_write = idex_reg.mem_write;
+  exmem_reg.reg_write = idex_reg.reg_write;
+  exmem_reg.write_rd = idex_reg.write_rd;
 
+  exmem_reg.read_rs1 = idex_reg.read_rs1;
   exmem_reg.read_rs2 = idex_reg.read_rs2;
 
   #ifdef DEBUG_CYCLE
@@ -196,47 +297,45 @@ memwb_reg_t stage_mem(exmem_reg_t exmem_reg, pipeline_wires_t* pwires_p, Byte* m
   memwb_reg_t memwb_reg = {0}; // establishing new memwb_reg
 
   // for the debug cycle
+  memwb_reg.instr = exmem_reg.instr;
   memwb_reg.instr_bits = exmem_reg.instr_bits;
   memwb_reg.pc = exmem_reg.pc;
 
   // transfer data from last cycle:
-  memwb_reg.instr_addr = exmem_reg.instr_addr;
-  memwb_reg.alu_result = exmem_reg.alu_result;
+  memwb_reg.alu_result = exmem_reg.result;
   memwb_reg.write_rd = exmem_reg.write_rd;
   memwb_reg.read_rs2 = exmem_reg.read_rs2;
 
   // transfer control signals from last cycle
   memwb_reg.reg_write = exmem_reg.reg_write;
   memwb_reg.mem_to_reg = exmem_reg.mem_to_reg;
-  
-<<<<<<< HEAD
-  // get the alignment for word value in memory
-  Alignment alignment;
-  
-  switch (exmem_reg.instr.itype.funct3) {
-    case 0x0:
-      alignment = LENGTH_BYTE; // 0:7
+
+  // branches and jumps are taken here, fetch follows them next cycle. With -b the
+  // conditional branches were already taken in ID.
+  bool taken = false;
+  switch (exmem_reg.instr.opcode) {
+    case 0x63:
+      taken = !sim_config.early_branch && gen_branch(exmem_reg.instr, exmem_reg.read_rs1, exmem_reg.read_rs2);
       break;
-    case 0x1:
-      alignment = LENGTH_HALF_WORD; // 0:15
+    case 0x6F: // jal
+    case 0x67: // jalr
+      taken = true;
       break;
-    case 0x2:
-      alignment = LENGTH_WORD; // 0:31
+    default:
       break;
-    default: 
-      break; 
   }
+  pwires_p->pcsrc = taken;
+  pwires_p->pc_src1 = exmem_reg.branch_target;
 
-  pwires_p->branch = gen_branch(exmem_reg.instr, exmem_reg.pc); // set branch value in pipeline wires
-  memwb_reg.mem_read = load(memory_p, exmem_reg.instr_addr, alignment); // read the result from memory and write it to mem_read
+  if (exmem_reg.mem_read || exmem_reg.mem_write) {
+    memwb_reg.mem_read = gen_mem_access(exmem_reg.instr, exmem_reg.pc, exmem_reg.result, exmem_reg.read_rs2, memory_p, cache_p); // load through the store buffer and cache, or queue the store
+  }
   
   #ifdef DEBUG_CYCLE
-  printf("[MEM ]: Instruction [%08x]@[%08x]: ", memwb_reg.instr_bits, memwb_reg.pc);
+  printf("[MEM]: Instruction [%08x]@[%08x]: ", memwb_reg.instr_bits, memwb_reg.pc);
   decode_instruction(memwb_reg.instr_bits);
   #endif
-  memwb_reg.read_rd
 
-  // Missing forward to rd and shit and what not
   return memwb_reg;
 }
 
@@ -247,7 +346,9 @@ memwb_reg_t stage_mem(exmem_reg_t exmem_reg, pipeline_wires_t* pwires_p, Byte* m
 // Kirstin
 void stage_writeback(memwb_reg_t memwb_reg, pipeline_wires_t* pwires_p, regfile_t* regfile_p) {
 
-  if (memwb_reg.mem_to_reg) {regfile_p->R[memwb_reg.write_rd] = memwb_reg.alu_result;} else {regfile_p->R[memwb_reg.write_rd] = memwb_reg.instr_addr;}
+  if (memwb_reg.reg_write && memwb_reg.write_rd != 0) {
+    regfile_p->R[memwb_reg.write_rd] = (memwb_reg.mem_to_reg) ? memwb_reg.mem_read : memwb_reg.alu_result;
+  }
   
   #ifdef DEBUG_CYCLE
   printf("[WB ]: Instruction [%08x]@[%08x]: ", memwb_reg.instr_bits, memwb_reg.pc);
@@ -258,37 +359,110 @@ void stage_writeback(memwb_reg_t memwb_reg, pipeline_wires_t* pwires_p, regfile_
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * returns the value forwarded to an operand of the EX stage, or `reg_value` when the
+ * forwarding unit selected the register file
+ **/
+static uint32_t forward_value(pipeline_regs_t* pregs_p, int forward, uint32_t reg_value) {
+  if (forward == 2) { // never a load, the load-use interlock holds its consumer in ID until the load is in WB
+    return pregs_p->exmem_preg.out.result;
+  }
+  if (forward == 1) {
+    memwb_reg_t* memwb = &pregs_p->memwb_preg.out;
+    return (memwb->mem_to_reg) ? memwb->mem_read : memwb->alu_result;
+  }
+  return reg_value;
+}
+
 /** 
  * excite the pipeline with one clock cycle
  **/
-void cycle_pipeline(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, pipeline_regs_t* pregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit) {
+void cycle_pipeline(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, pipeline_regs_t* pregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit) {
   #ifdef DEBUG_CYCLE
   printf("v==============");
+  if (sim_config.cores > 1) {
+    printf("Core %d ", core_id); // the cores' cycles interleave under -N
+  }
   printf("Cycle Counter = %5ld", total_cycle_counter);
   printf("==============v\n\n");
   #endif
 
+  // stores retire from the store buffer in the background
+  if (sim_config.storebuf_depth > 0) {
+    storebuf_tick(&store_buffer, memory_p, cache_p, total_cycle_counter + mem_stall_counter);
+  }
+
   // process each stage
 
   /* Output               |    Stage      |       Inputs  */
-  pregs_p->ifid_preg.inp  = stage_fetch     (pwires_p, regfile_p, memory_p);
+  pregs_p->ifid_preg.inp  = stage_fetch     (pwires_p, regfile_p, memory_p, icache_p);
   
   pregs_p->idex_preg.inp  = stage_decode    (pregs_p->ifid_preg.out, pwires_p, regfile_p);
 
   detect_hazard(pregs_p, pwires_p, regfile_p);
 
-  pregs_p->exmem_preg.inp = stage_execute   (pregs_p->idex_preg.out, pwires_p);
+  // EX takes its operands from the forwarding unit
+  idex_reg_t idex_reg = pregs_p->idex_preg.out;
+  idex_reg.read_rs1 = forward_value(pregs_p, pwires_p->forwardA, idex_reg.read_rs1);
+  idex_reg.read_rs2 = forward_value(pregs_p, pwires_p->forwardB, idex_reg.read_rs2);
+
+  if (pwires_p->stall_ex) {
+    pregs_p->exmem_preg.inp = (exmem_reg_t){0}; // bubble while EX waits for its unit
+  } else {
+  pregs_p->exmem_preg.inp = stage_execute   (idex_reg, pwires_p);
+  }
   
   pregs_p->memwb_preg.inp = stage_mem       (pregs_p->exmem_preg.out, pwires_p, memory_p, cache_p);
+  if (!pwires_p->stall_id && !pwires_p->stall_ex) {
+    detect_pending_load(pregs_p, pwires_p);
+  }
 
                             stage_writeback (pregs_p->memwb_preg.out, pwires_p, regfile_p);
 
+  // the register file is written in the first half of the cycle, so ID reads what WB wrote
+  pregs_p->idex_preg.inp.read_rs1 = regfile_p->R[pregs_p->idex_preg.inp.instr.rtype.rs1];
+  pregs_p->idex_preg.inp.read_rs2 = regfile_p->R[pregs_p->idex_preg.inp.instr.rtype.rs2];
+
+  bool redirect = pwires_p->pcsrc; // taken in MEM
+  if (redirect) {
+    branch_counter++;
+  } else if (sim_config.early_branch) {
+    // branches were resolved in ID, the next fetch follows that decision
+    pwires_p->pcsrc = pwires_p->id_branch_taken;
+    pwires_p->pc_src1 = pwires_p->id_branch_target;
+    if (pwires_p->id_branch_taken) {
+      branch_counter++;
+    }
+  }
+
   // update all the output registers for the next cycle from the input registers in the current cycle
-  pregs_p->ifid_preg.out  = pregs_p->ifid_preg.inp;
-  pregs_p->idex_preg.out  = pregs_p->idex_preg.inp;
+  if (pwires_p->stall_id || pwires_p->stall_ex) {
+    // the instruction in ID is held, so refetch the one fetched this cycle
+    pwires_p->pc_src0 = pregs_p->ifid_preg.inp.pc;
+  } else if (pwires_p->id_branch_taken && !redirect) {
+    pregs_p->ifid_preg.out  = (ifid_reg_t){0}; // squash the fall-through instruction fetched behind the branch
+  } else {
+    pregs_p->ifid_preg.out  = pregs_p->ifid_preg.inp;
+  }
+  if (pwires_p->stall_id) {
+    pregs_p->idex_preg.out  = (idex_reg_t){0};
+  } else if (!pwires_p->stall_ex) {
+    pregs_p->idex_preg.out  = pregs_p->idex_preg.inp;
+  }
   pregs_p->exmem_preg.out = pregs_p->exmem_preg.inp;
   pregs_p->memwb_preg.out = pregs_p->memwb_preg.inp;
 
+  // with forwarding the hazard unit also flushes the three instructions fetched behind
+  // a branch or jump taken in MEM; they leave as nops
+  if (redirect && sim_config.fwd_en) {
+    pregs_p->ifid_preg.out  = (ifid_reg_t){ .instr = parse_instruction(0x00000013), .instr_bits = 0x00000013, .pc = pregs_p->ifid_preg.inp.pc };
+    pregs_p->idex_preg.out  = (idex_reg_t){ .instr = parse_instruction(0x00000013), .instr_bits = 0x00000013, .pc = pregs_p->idex_preg.inp.pc };
+    pregs_p->exmem_preg.out = (exmem_reg_t){ .instr = parse_instruction(0x00000013), .instr_bits = 0x00000013, .pc = pregs_p->exmem_preg.inp.pc };
+    #ifdef DEBUG_CYCLE
+    printf("[CPL]: Pipeline Flushed\n");
+    #endif
+  }
+
   /////////////////// NO CHANGES BELOW THIS ARE REQUIRED //////////////////////
 
   // increment the cycle
@@ -322,3 +496,183 @@ void cycle_pipeline(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, pipeli
   }
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * returns the value forwarded to an operand of the EX stage in superscalar mode,
+ * or `reg_value` when the forwarding unit selected the register file
+ **/
+static uint32_t forward_value_superscalar(superscalar_regs_t* sregs_p, int forward, int src_lane, uint32_t reg_value) {
+  if (forward == 2) { // never a load, the issue stage holds its consumer until the load is in WB
+    return sregs_p->lane[src_lane].exmem_preg.out.result;
+  }
+  if (forward == 1) {
+    memwb_reg_t* memwb = &sregs_p->lane[src_lane].memwb_preg.out;
+    return (memwb->mem_to_reg) ? memwb->mem_read : memwb->alu_result;
+  }
+  return reg_value;
+}
+
+/** 
+ * excite the N-wide in-order pipeline with one clock cycle
+ *
+ * Fetch fills a decoupled fetch queue with up to `issue_width` instructions per cycle.
+ * The issue stage takes instructions from the head of the queue, in order, until the
+ * group is full or check_issue_pair() splits it; unused lanes carry bubbles. Stages
+ * run back to front so writeback lands in the register file before decode reads it.
+ **/
+void cycle_pipeline_superscalar(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, superscalar_regs_t* sregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit) {
+  int width = sim_config.issue_width;
+  pipeline_wires_t lane_wires[MAX_ISSUE_WIDTH] = {0};
+  bool idex_valid_inp[MAX_ISSUE_WIDTH] = {0};
+  bool exmem_valid_inp[MAX_ISSUE_WIDTH] = {0};
+  bool memwb_valid_inp[MAX_ISSUE_WIDTH] = {0};
+  bool ecall_retired = false;
+  bool redirect = false;
+
+  #ifdef DEBUG_CYCLE
+  printf("v==============");
+  printf("Cycle Counter = %5ld", total_cycle_counter);
+  printf("==============v\n\n");
+  #endif
+
+  if (sim_config.storebuf_depth > 0) {
+    storebuf_tick(&store_buffer, memory_p, cache_p, total_cycle_counter + mem_stall_counter);
+  }
+
+  // WB: lane order, so the youngest write to a register wins
+  for (int lane = 0; lane < width; lane++) {
+    if (!sregs_p->memwb_valid[lane]) continue;
+    stage_writeback(sregs_p->lane[lane].memwb_preg.out, &lane_wires[lane], regfile_p);
+    instr_retired_counter++;
+    if (sregs_p->lane[lane].memwb_preg.out.instr_bits == 0x00000073) {
+      ecall_retired = true;
+    }
+  }
+
+  // MEM: the pairing rules allow one memory instruction per group, so the lanes never contend for the cache
+  for (int lane = 0; lane < width; lane++) {
+    if (!sregs_p->exmem_valid[lane]) continue;
+    sregs_p->lane[lane].memwb_preg.inp = stage_mem(sregs_p->lane[lane].exmem_preg.out, &lane_wires[lane], memory_p, cache_p);
+    memwb_valid_inp[lane] = true;
+
+    // a control transfer closes its issue group, so no younger lane of this group can be in flight
+    if (lane_wires[lane].pcsrc && !redirect) {
+      redirect = true;
+      pwires_p->pcsrc = 1;
+      pwires_p->pc_src1 = lane_wires[lane].pc_src1;
+      branch_counter++;
+    }
+  }
+
+  // EX: operands come from the forwarding network spanning all lanes
+  for (int lane = 0; lane < width; lane++) {
+    if (!sregs_p->idex_valid[lane] || redirect) continue;
+    gen_forward_superscalar(sregs_p, lane, &lane_wires[lane]);
+
+    idex_reg_t idex_reg = sregs_p->lane[lane].idex_preg.out;
+    idex_reg.read_rs1 = forward_value_superscalar(sregs_p, lane_wires[lane].forwardA, lane_wires[lane].forwardA_lane, idex_reg.read_rs1);
+    idex_reg.read_rs2 = forward_value_superscalar(sregs_p, lane_wires[lane].forwardB, lane_wires[lane].forwardB_lane, idex_reg.read_rs2);
+
+    sregs_p->lane[lane].exmem_preg.inp = stage_execute(idex_reg, &lane_wires[lane]);
+    exmem_valid_inp[lane] = true;
+  }
+
+  // ID: form the issue group from the head of the fetch queue
+  Instruction group[MAX_ISSUE_WIDTH];
+  int issued = 0;
+  while (!redirect && issued < width && sregs_p->fq_count > 0) {
+    ifid_reg_t* head = &sregs_p->fetch_queue[sregs_p->fq_head];
+
+    int split = check_issue_pair(group, issued, head->instr);
+    if (split != ISSUE_OK) {
+      if (split == ISSUE_SPLIT_MEM) issue_split_mem_counter++;
+      if (split == ISSUE_SPLIT_RAW) issue_split_raw_counter++;
+      if (split == ISSUE_SPLIT_CTRL) issue_split_ctrl_counter++;
+      break;
+    }
+
+    // functional unit interlocks, checked for the cycle the group enters EX. Every
+    // lane has an ALU, the multiplier and divider are shared.
+    uint64_t ex_cycle = total_cycle_counter + mem_stall_counter + 1;
+    fu_timing_t timing = fu_timing(head->instr, sim_config.fu_en);
+    if (timing.unit != FU_UNIT_ALU && !fu_unit_free(&fu_scoreboard, timing.unit, ex_cycle)) {
+      fu_scoreboard.unit[timing.unit].structural_stalls++;
+      stall_counter++;
+      break;
+    }
+    bool src_pending = false;
+    for (unsigned int reg = 1; reg < 32; reg++) {
+      if (instr_reads_reg(head->instr, reg) && fu_scoreboard.reg_ready[reg] > ex_cycle) {
+        src_pending = true;
+      }
+    }
+    if (src_pending) {
+      stall_fu_counter++;
+      stall_counter++;
+      break;
+    }
+
+    // load-use: a load now in EX has its data only after MEM
+    bool load_use = false;
+    for (int lane = 0; lane < width; lane++) {
+      Instruction ex_instr = { .bits = sregs_p->lane[lane].idex_preg.out.instr_bits };
+      if (sregs_p->idex_valid[lane] && instr_reads_memory(ex_instr) && instr_reads_reg(head->instr, instr_dest_reg(ex_instr))) {
+        load_use = true;
+      }
+    }
+    if (load_use) {
+      stall_loaduse_counter++;
+      stall_counter++;
+      fwd_exex_counter++; // the EX hazard the stall resolves, as in detect_load_use
+      break;
+    }
+    fu_issue(&fu_scoreboard, head->instr, sim_config.fu_en, ex_cycle);
+
+    sregs_p->lane[issued].ifid_preg.out = *head;
+    sregs_p->lane[issued].idex_preg.inp = stage_decode(*head, &lane_wires[issued], regfile_p);
+    idex_valid_inp[issued] = true;
+    group[issued] = head->instr;
+    issued++;
+
+    sregs_p->fq_head = (sregs_p->fq_head + 1) % FETCH_QUEUE_SIZE;
+    sregs_p->fq_count--;
+  }
+
+  // IF: a taken branch squashes everything fetched after it
+  if (redirect) {
+    sregs_p->fq_count = 0;
+  }
+  for (int i = 0; i < width && sregs_p->fq_count < FETCH_QUEUE_SIZE; i++) {
+    int tail = (sregs_p->fq_head + sregs_p->fq_count) % FETCH_QUEUE_SIZE;
+    sregs_p->fetch_queue[tail] = stage_fetch(pwires_p, regfile_p, memory_p, icache_p);
+    pwires_p->pcsrc = 0; // only the first fetch of the cycle follows the redirect
+    if (pwires_p->stall_if) {
+      break; // the bubble is not queued, the same PC is fetched again next cycle
+    }
+    sregs_p->fq_count++;
+  }
+
+  // update all the output registers for the next cycle from the input registers in the current cycle
+  for (int lane = 0; lane < width; lane++) {
+    sregs_p->lane[lane].idex_preg.out  = sregs_p->lane[lane].idex_preg.inp;
+    sregs_p->lane[lane].exmem_preg.out = sregs_p->lane[lane].exmem_preg.inp;
+    sregs_p->lane[lane].memwb_preg.out = sregs_p->lane[lane].memwb_preg.inp;
+    sregs_p->idex_valid[lane]  = idex_valid_inp[lane];
+    sregs_p->exmem_valid[lane] = exmem_valid_inp[lane];
+    sregs_p->memwb_valid[lane] = memwb_valid_inp[lane];
+  }
+
+  // increment the cycle
+  total_cycle_counter++;
+
+  #ifdef DEBUG_REG_TRACE
+  print_register_trace(regfile_p);
+  #endif
+
+  // same ecall condition as cycle_pipeline, checked on every lane that retired this cycle
+  if (ecall_retired && (regfile_p->R[10] == 10)) {
+    *(ecall_exit) = true;
+  }
+}
@@ -4,20 +4,51 @@
 #include "config.h"
 #include "types.h"
 #include "cache.h"
+#include "fu.h"
+#include "storebuf.h"
+#include "belady.h"
+#include "mmu.h"
+#include "dram.h"
+#include "coherence.h"
 #include <stdbool.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 /// Functionality
 ///////////////////////////////////////////////////////////////////////////////
 
+// state of one simulated core: with -N every core runs on its own host thread, which
+// has its own copy (see multicore.h)
+#define CORE_LOCAL __thread
+
 extern simulator_config_t sim_config;
-extern uint64_t miss_count;
-extern uint64_t hit_count;
-extern uint64_t total_cycle_counter;
-extern uint64_t stall_counter;
-extern uint64_t branch_counter;
-extern uint64_t fwd_exex_counter;
-extern uint64_t fwd_exmem_counter;
+extern CORE_LOCAL uint64_t miss_count;
+extern CORE_LOCAL uint64_t hit_count;
+extern CORE_LOCAL uint64_t icache_miss_count;
+extern CORE_LOCAL uint64_t icache_hit_count;
+extern CORE_LOCAL uint64_t fetch_stall_counter;  // cycles fetch waited for the instruction cache
+extern CORE_LOCAL uint64_t total_cycle_counter;
+extern CORE_LOCAL uint64_t stall_counter;
+extern CORE_LOCAL uint64_t branch_counter;
+extern CORE_LOCAL uint64_t fwd_exex_counter;
+extern CORE_LOCAL uint64_t fwd_exmem_counter;
+extern CORE_LOCAL uint64_t stall_fu_counter;      // ID waiting on a multi-cycle result, or with -M on a load miss
+extern CORE_LOCAL uint64_t stall_loaduse_counter;
+extern CORE_LOCAL uint64_t stall_branch_counter;
+extern CORE_LOCAL uint64_t mem_access_counter;
+extern CORE_LOCAL uint64_t mem_stall_counter;   // memory latency beyond one cycle, accumulated per access
+extern CORE_LOCAL store_buffer_t store_buffer;
+extern belady_trace_t opt_trace;     // L1D accesses, recorded when sim_config.opt_en is set
+extern CORE_LOCAL fu_scoreboard_t fu_scoreboard;
+extern mmu_t mmu;                   // Sv32 translation, used when sim_config.mmu_en is set
+extern dram_t dram;                 // memory timing, used when sim_config.dram_en is set
+extern CORE_LOCAL uint64_t instr_retired_counter;
+extern CORE_LOCAL uint64_t issue_split_mem_counter;
+extern CORE_LOCAL uint64_t issue_split_raw_counter;
+extern CORE_LOCAL uint64_t issue_split_ctrl_counter;
+extern CORE_LOCAL uint64_t atomic_counter;        // RV32A instructions through MEM
+extern CORE_LOCAL uint64_t sc_fail_counter;       // sc.w that lost their reservation
+extern CORE_LOCAL int core_id;                    // the core running on this thread, 0 without -N
+extern coherence_t coherence;       // MESI directory of the L1Ds, used when sim_config.cores > 1
 
 ///////////////////////////////////////////////////////////////////////////////
 /// RISC-V Pipeline Register Types (encapsulates the data passed between two successive pipeline stages)
@@ -52,8 +83,6 @@ typedef struct
   unsigned int pc;
   
   // next stage:
-  bool alu_op;
-
   uint8_t alu_op;
   bool alu_src;
 
@@ -61,7 +90,6 @@ typedef struct
   bool mem_to_reg;
   bool mem_read;
   bool reg_write;
-  bool mem_read;
 
 }idex_reg_t;
 
@@ -79,7 +107,11 @@ typedef struct
   bool mem_read;
   bool mem_to_reg;
   bool mem_write;
-  uint32_t read_rs2;
+  bool reg_write;
+  uint32_t read_rs1;      // operands of a branch, compared in MEM
+  uint32_t read_rs2;      // and the data of a store
+  uint32_t branch_target; // of a branch or jump, taken from MEM
+  unsigned int write_rd;
   
 }exmem_reg_t;
 
@@ -94,7 +126,10 @@ typedef struct
   unsigned int mem_read; //rename
   unsigned int pc;
 
-  unsigned int read_rd; // Since this stage is the last stage, it needs to write back the result if need be
+  unsigned int write_rd; // Since this stage is the last stage, it needs to write back the result if need be
+  uint32_t read_rs2;
+  bool reg_write;
+  bool mem_to_reg;
 }memwb_reg_t;
 
 
@@ -146,11 +181,45 @@ typedef struct
 
   int forwardA;
   int forwardB;
+  int forwardA_lane; // superscalar mode: lane whose EXMEM/MEMWB register is the forwarding source
+  int forwardB_lane;
+
+  bool stall_id; // hold IF and ID, insert a bubble into EX
+  bool stall_ex; // hold IF, ID and EX, insert a bubble into MEM
+  bool stall_if; // instruction cache miss: IF delivered a bubble and holds the PC
+
+  // early branch mode: decision made in ID, replaces the one from MEM
+  bool id_branch_taken;
+  uint32_t id_branch_target;
 
 
 }pipeline_wires_t;
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// Superscalar (N-wide in-order) pipeline
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MAX_ISSUE_WIDTH
+#define MAX_ISSUE_WIDTH 4  // upper bound for the issue width selected with -w
+#endif
+#define FETCH_QUEUE_SIZE (2*MAX_ISSUE_WIDTH) // decoupled fetch buffer feeding the issue stage
+
+typedef struct
+{
+  pipeline_regs_t lane[MAX_ISSUE_WIDTH]; // one set of pipeline registers per issue lane, lane 0 is the oldest
+
+  // fetched instructions waiting to be issued, in program order
+  ifid_reg_t fetch_queue[FETCH_QUEUE_SIZE];
+  int fq_head;
+  int fq_count;
+
+  // whether each lane's register `out` holds a real instruction (true) or a bubble (false)
+  bool idex_valid[MAX_ISSUE_WIDTH];
+  bool exmem_valid[MAX_ISSUE_WIDTH];
+  bool memwb_valid[MAX_ISSUE_WIDTH];
+}superscalar_regs_t;
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Function definitions for different stages
 ///////////////////////////////////////////////////////////////////////////////
@@ -158,7 +227,7 @@ typedef struct
 /**
  * output : ifid_reg_t
  **/ 
-ifid_reg_t stage_fetch(pipeline_wires_t* pwires_p, regfile_t* regfile_p, Byte* memory_p);
+ifid_reg_t stage_fetch(pipeline_wires_t* pwires_p, regfile_t* regfile_p, Byte* memory_p, Cache* icache_p);
 
 /**
  * output : idex_reg_t
@@ -180,8 +249,39 @@ memwb_reg_t stage_mem(exmem_reg_t exmem_reg, pipeline_wires_t* pwires_p, Byte* m
  **/ 
 void stage_writeback(memwb_reg_t memwb_reg, pipeline_wires_t* pwires_p, regfile_t* regfile_p);
 
-void cycle_pipeline(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, pipeline_regs_t* pregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit);
+void cycle_pipeline(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, pipeline_regs_t* pregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit);
 
 void bootstrap(pipeline_wires_t* pwires_p, pipeline_regs_t* pregs_p, regfile_t* regfile_p);
 
+/**
+ * output : latency of one data access issued at cycle `now` by the instruction at `pc`
+ *          through the L1 (or memory without the cache)
+ **/
+int data_access_latency(uint32_t addr, uint32_t pc, int type, Cache* cache_p, uint64_t now);
+
+/**
+ * output : the physical address of the data access (MMU_LOAD or MMU_STORE) to `addr`
+ *          issued at cycle *now, which a D-TLB miss moves to the end of the page walk
+ **/
+uint32_t data_translate(uint32_t addr, int access, uint64_t* now);
+
+/**
+ * output : true if fetch of `pc` at cycle `now` must wait for the I-TLB or the instruction
+ *          cache, always false without -U and -I; *paddr is the physical address of `pc`
+ **/
+bool fetch_stalled(uint32_t pc, uint32_t* paddr, Cache* icache_p, uint64_t now);
+
+///////////////////////////////////////////////////////////////////////////////
+/// Stage helpers shared with the other timing models (defined in stage_helpers.h)
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t execute_alu(uint32_t alu_inp1, uint32_t alu_inp2, uint32_t alu_control);
+bool gen_branch(Instruction instruction, uint32_t read_rs1, uint32_t read_rs2);
+void print_register_trace(regfile_t* regfile_p);
+
+/**
+ * excite the N-wide in-order pipeline (sim_config.issue_width lanes) with one clock cycle
+ **/
+void cycle_pipeline_superscalar(regfile_t* regfile_p, Byte* memory_p, Cache* cache_p, Cache* icache_p, superscalar_regs_t* sregs_p, pipeline_wires_t* pwires_p, bool* ecall_exit);
+
 #endif  // __PIPELINE_H__
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include "cache.h"
+#include "prefetch.h"
+
+void prefetch_init(prefetcher_t* pf, int kind, bool to_buffer) {
+  memset(pf, 0, sizeof(*pf));
+  pf->kind = kind;
+  pf->to_buffer = to_buffer;
+  pf->degree = PREFETCH_DEGREE;
+}
+
+int prefetch_kind(const char* name) {
+  if (strcmp(name, "next") == 0) return PREFETCH_NEXT_LINE;
+  if (strcmp(name, "stride") == 0) return PREFETCH_STRIDE;
+  if (strcmp(name, "stream") == 0) return PREFETCH_STREAM;
+  return -1;
+}
+
+const char* prefetch_name(int kind) {
+  switch (kind) {
+    case PREFETCH_NEXT_LINE: return "next-line";
+    case PREFETCH_STRIDE:    return "stride";
+    case PREFETCH_STREAM:    return "stream";
+    default:                 return "none";
+  }
+}
+
+bool prefetch_buffer_take(prefetcher_t* pf, unsigned long long block, unsigned long long* ready_cycle) {
+  for (int i = 0; i < PREFETCH_BUFFER_SIZE; i++) {
+    if (pf->buffer[i].valid && pf->buffer[i].block_addr == block) {
+      pf->buffer[i].valid = false;
+      *ready_cycle = pf->buffer[i].ready_cycle;
+      return true;
+    }
+  }
+  return false;
+}
+
+void prefetch_demand_miss(prefetcher_t* pf, unsigned long long block) {
+  pf->misses++;
+  for (int i = 0; i < PREFETCH_FILTER_SIZE; i++) {
+    if (pf->filter[i] == block + 1) {  // stored off by one so that 0 marks a free slot
+      pf->filter[i] = 0;
+      pf->pollution++;
+      return;
+    }
+  }
+}
+
+// fills `block` into the prefetch buffer, replacing the oldest entry
+static void fill_buffer(prefetcher_t* pf, unsigned long long block, unsigned long long ready) {
+  for (int i = 0; i < PREFETCH_BUFFER_SIZE; i++) {
+    if (pf->buffer[i].valid && pf->buffer[i].block_addr == block) {
+      return;
+    }
+  }
+  prefetch_buffer_entry_t* entry = &pf->buffer[pf->buffer_next];
+  pf->buffer_next = (pf->buffer_next + 1) % PREFETCH_BUFFER_SIZE;
+  if (entry->valid) {
+    pf->unused++;
+  }
+  entry->valid = true;
+  entry->block_addr = block;
+  entry->ready_cycle = ready;
+  pf->issued++;
+}
+
+// fills `block` into the cache, remembering a demand block it evicts for the pollution count
+static void fill_cache(prefetcher_t* pf, Cache* cache, unsigned long long block, unsigned long long ready) {
+  if (!insert_cacheline(block, cache)) {
+    unsigned long long victim = victim_cacheline(block, cache);
+    Line* victim_line = find_cacheline(victim, cache);
+    bool victim_dirty = victim_line->dirty;
+    if (victim_line->prefetched) {
+      pf->unused++;
+    } else {
+      pf->filter[pf->filter_next] = victim + 1;
+      pf->filter_next = (pf->filter_next + 1) % PREFETCH_FILTER_SIZE;
+    }
+    replace_cacheline(victim, block, cache);
+    cache_evicted(cache, victim, victim_dirty); // the writeback is off the demand path
+  }
+  Line* line = find_cacheline(block, cache);
+  line->prefetched = true;
+  line->prefetch_ready = ready;
+  pf->issued++;
+}
+
+// requests `block` at cache->now unless it is already on chip
+static void prefetch_issue(prefetcher_t* pf, Cache* cache, unsigned long long block) {
+  if (probe_cache(block, cache) || cache_victim_find(block, cache) >= 0) {
+    return;
+  }
+  cache->prefetching = true;
+  unsigned long long ready = cache->now + cache_miss_latency(block, cache);
+  cache->prefetching = false;
+  if (pf->to_buffer) {
+    fill_buffer(pf, block, ready);
+  } else {
+    fill_cache(pf, cache, block, ready);
+  }
+}
+
+// issues `degree` blocks ahead of `block`, `step` bytes apart
+static void prefetch_ahead(prefetcher_t* pf, Cache* cache, unsigned long long block, long long step) {
+  for (int k = 1; k <= pf->degree; k++) {
+    prefetch_issue(pf, cache, block + k * step);
+  }
+}
+
+static void train_stride(prefetcher_t* pf, Cache* cache, unsigned long long address) {
+  if (cache->pc == 0) {
+    return; // store buffer drains carry no PC
+  }
+
+  stride_entry_t* entry = &pf->stride[(cache->pc >> 2) % PREFETCH_STRIDE_ENTRIES];
+  if (!entry->valid || entry->pc != cache->pc) {
+    memset(entry, 0, sizeof(*entry));
+    entry->valid = true;
+    entry->pc = cache->pc;
+    entry->last_addr = address;
+    return;
+  }
+
+  long long stride = (long long)(address - entry->last_addr);
+  if (stride != 0 && stride == entry->stride) {
+    if (entry->confidence < 3) entry->confidence++;
+  } else if (entry->confidence > 0) {
+    entry->confidence--;
+  } else {
+    entry->stride = stride;
+  }
+  entry->last_addr = address;
+
+  if (entry->confidence >= 2) {
+    // strides smaller than a block still prefetch whole blocks ahead
+    long long block_size = 1LL << cache->blockBits;
+    long long step = (entry->stride > 0) ? entry->stride : -entry->stride;
+    step = (step < block_size) ? block_size : step;
+    prefetch_ahead(pf, cache, address_to_block(address, cache), (entry->stride > 0) ? step : -step);
+  }
+}
+
+static void train_stream(prefetcher_t* pf, Cache* cache, unsigned long long address) {
+  unsigned long long block = address >> cache->blockBits;
+  pf->stream_clock++;
+
+  for (int i = 0; i < PREFETCH_STREAMS; i++) {
+    stream_entry_t* stream = &pf->streams[i];
+    if (!stream->valid) {
+      continue;
+    }
+    long long distance = (long long)(block - stream->last_block);
+    int direction = (distance > 0) ? 1 : -1;
+    if (distance != 0 && distance * direction <= PREFETCH_STREAM_WINDOW
+        && (stream->direction == 0 || stream->direction == direction)) {
+      stream->direction = direction;
+      stream->last_block = block;
+      stream->last_use = pf->stream_clock;
+      prefetch_ahead(pf, cache, block << cache->blockBits, (long long)direction << cache->blockBits);
+      return;
+    }
+  }
+
+  // no stream continues here: start training a new one in a free or the LRU slot
+  stream_entry_t* victim = &pf->streams[0];
+  for (int i = 0; i < PREFETCH_STREAMS && victim->valid; i++) {
+    if (!pf->streams[i].valid || pf->streams[i].last_use < victim->last_use) {
+      victim = &pf->streams[i];
+    }
+  }
+  victim->valid = true;
+  victim->last_block = block;
+  victim->direction = 0;
+  victim->last_use = pf->stream_clock;
+}
+
+void prefetch_train(prefetcher_t* pf, Cache* cache, unsigned long long address, bool trigger) {
+  switch (pf->kind) {
+    case PREFETCH_NEXT_LINE:
+      if (trigger) {
+        prefetch_ahead(pf, cache, address_to_block(address, cache), 1LL << cache->blockBits);
+      }
+      break;
+    case PREFETCH_STRIDE:
+      train_stride(pf, cache, address);
+      break;
+    case PREFETCH_STREAM:
+      if (trigger) {
+        train_stream(pf, cache, address);
+      }
+      break;
+  }
+}
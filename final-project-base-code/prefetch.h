@@ -0,0 +1,115 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include "cache.h"
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Prefetcher parameters (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PREFETCH_DEGREE
+#define PREFETCH_DEGREE 2           // blocks requested per trigger
+#endif
+#ifndef PREFETCH_STRIDE_ENTRIES
+#define PREFETCH_STRIDE_ENTRIES 64  // reference prediction table entries, indexed by PC
+#endif
+#ifndef PREFETCH_STREAMS
+#define PREFETCH_STREAMS 4          // streams tracked at the same time
+#endif
+#ifndef PREFETCH_STREAM_WINDOW
+#define PREFETCH_STREAM_WINDOW 4    // blocks around a stream's last miss that continue it
+#endif
+#ifndef PREFETCH_BUFFER_SIZE
+#define PREFETCH_BUFFER_SIZE 16     // blocks in the separate prefetch buffer (FIFO)
+#endif
+#define PREFETCH_FILTER_SIZE 64     // demand blocks recently evicted by a prefetch
+
+enum prefetch_kind_enum {
+  PREFETCH_NONE = 0,
+  PREFETCH_NEXT_LINE = 1,  // the blocks after a miss or a first hit on a prefetched block
+  PREFETCH_STRIDE = 2,     // per-PC constant stride, issued once the stride is confirmed
+  PREFETCH_STREAM = 3      // ascending or descending miss streams, confirmed by two misses
+};
+
+typedef struct
+{
+  bool valid;
+  unsigned long long pc;
+  unsigned long long last_addr;
+  long long stride;
+  int confidence;  // saturating, prefetches are issued at 2 and above
+}stride_entry_t;
+
+typedef struct
+{
+  bool valid;
+  unsigned long long last_block;
+  int direction;   // +1/-1 once confirmed, 0 while training
+  unsigned long long last_use;
+}stream_entry_t;
+
+typedef struct
+{
+  bool valid;
+  unsigned long long block_addr;
+  unsigned long long ready_cycle;
+}prefetch_buffer_entry_t;
+
+typedef struct prefetcher
+{
+  int kind;
+  bool to_buffer;  // fill the prefetch buffer instead of the cache
+  int degree;
+
+  stride_entry_t stride[PREFETCH_STRIDE_ENTRIES];
+  stream_entry_t streams[PREFETCH_STREAMS];
+  unsigned long long stream_clock;
+  prefetch_buffer_entry_t buffer[PREFETCH_BUFFER_SIZE];
+  int buffer_next;
+  unsigned long long filter[PREFETCH_FILTER_SIZE];
+  int filter_next;
+
+  // stats
+  unsigned long long issued;
+  unsigned long long useful;     // prefetched blocks hit by a demand access
+  unsigned long long late;       // useful, but the demand arrived before the fill completed
+  unsigned long long unused;     // prefetched blocks evicted before any demand access
+  unsigned long long pollution;  // demand misses on blocks a prefetch evicted
+  unsigned long long misses;     // demand misses the prefetcher did not cover
+}prefetcher_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * resets the prefetcher state and stats
+ **/
+void prefetch_init(prefetcher_t* pf, int kind, bool to_buffer);
+
+/**
+ * output : prefetch_kind_enum for "next", "stride" or "stream", -1 otherwise
+ **/
+int prefetch_kind(const char* name);
+const char* prefetch_name(int kind);
+
+/**
+ * removes `block` from the prefetch buffer on a cache miss.
+ * output : true if it was buffered; *ready_cycle holds the cycle its fill completes
+ **/
+bool prefetch_buffer_take(prefetcher_t* pf, unsigned long long block, unsigned long long* ready_cycle);
+
+/**
+ * records a demand miss that was not covered by a prefetch; counts pollution when a
+ * prefetch evicted the block
+ **/
+void prefetch_demand_miss(prefetcher_t* pf, unsigned long long block);
+
+/**
+ * trains the prefetcher on a demand access and issues its prefetches at cache->now.
+ * `trigger` is true for a miss or the first hit on a prefetched block.
+ **/
+void prefetch_train(prefetcher_t* pf, Cache* cache, unsigned long long address, bool trigger);
+
+#endif // __PREFETCH_H__
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "profile.h"
+
+// bucket of a reuse distance: 0, 1, 2-3, 4-7, ...
+static int reuse_bucket(uint64_t distance) {
+  int bucket = (distance == 0) ? 0 : 64 - __builtin_clzll(distance);
+  return (bucket < PROFILE_REUSE_BUCKETS) ? bucket : PROFILE_REUSE_BUCKETS - 1;
+}
+
+void profile_init(cache_profile_t *profile, int setBits, int linesPerSet, int blockBits) {
+  memset(profile, 0, sizeof(*profile));
+  stackdist_init(&profile->shadow, blockBits, 0);
+  profile->lines = (uint64_t)linesPerSet << setBits;
+  profile->sets = 1 << setBits;
+  profile->set = calloc(profile->sets, sizeof(profile_set_t));
+  assert(profile->set != NULL);
+}
+
+/* Classifies a miss by what the shadow cache would have done with the same access:
+ *     1) no earlier access to the block: compulsory.
+ *     2) at least `lines` distinct blocks since the last one, so a fully associative
+ *        LRU cache of the same size misses too: capacity.
+ *     3) otherwise: conflict, the miss is due to the set mapping (or the policy).
+ * Hits are not classified, even those the shadow cache would miss.
+ */
+void profile_access(cache_profile_t *profile, uint64_t set, uint64_t address, int status) {
+  uint64_t distance = stackdist_access(&profile->shadow, address);
+  bool miss = (status != CACHE_HIT);
+  profile_set_t *row = &profile->set[set];
+  row->accesses++;
+
+  if (distance == STACKDIST_COLD) {
+    profile->first++;
+    profile->first_misses += miss;
+  } else {
+    int bucket = reuse_bucket(distance);
+    profile->reuse[bucket]++;
+    profile->reuse_misses[bucket] += miss;
+  }
+  if (!miss) {
+    return;
+  }
+
+  int class = MISS_CONFLICT;
+  if (distance == STACKDIST_COLD) {
+    class = MISS_COMPULSORY;
+  } else if (distance >= profile->lines) {
+    class = MISS_CAPACITY;
+  }
+  profile->misses[class]++;
+  row->misses++;
+  row->conflicts += (class == MISS_CONFLICT);
+  row->evictions += (status == CACHE_EVICT);
+}
+
+void profile_print(const cache_profile_t *profile, const char *name) {
+  printf("#%-3s compulsory    = %5llu\n", name, (unsigned long long)profile->misses[MISS_COMPULSORY]);
+  printf("#%-3s capacity      = %5llu\n", name, (unsigned long long)profile->misses[MISS_CAPACITY]);
+  printf("#%-3s conflict      = %5llu\n", name, (unsigned long long)profile->misses[MISS_CONFLICT]);
+
+  printf("#REUSE     distance     accesses       misses\n");
+  for (int b = 0; b < PROFILE_REUSE_BUCKETS; b++) {
+    if (profile->reuse[b] == 0) {
+      continue;
+    }
+    char range[32];
+    unsigned long long lo = (b == 0) ? 0 : 1ULL << (b - 1);
+    if (b == PROFILE_REUSE_BUCKETS - 1) {
+      snprintf(range, sizeof(range), "%llu+", lo);
+    } else if (b <= 1) {
+      snprintf(range, sizeof(range), "%llu", lo);
+    } else {
+      snprintf(range, sizeof(range), "%llu-%llu", lo, 2 * lo - 1);
+    }
+    printf("#REUSE %12s %12llu %12llu\n", range, (unsigned long long)profile->reuse[b],
+           (unsigned long long)profile->reuse_misses[b]);
+  }
+  printf("#REUSE %12s %12llu %12llu\n", "first", (unsigned long long)profile->first,
+         (unsigned long long)profile->first_misses);
+
+  uint64_t most = 0;
+  for (int s = 0; s < profile->sets; s++) {
+    most = (profile->set[s].misses > most) ? profile->set[s].misses : most;
+  }
+  printf("#HEAT   set     accesses       misses    conflicts    evictions  misses\n");
+  for (int s = 0; s < profile->sets; s++) {
+    const profile_set_t *row = &profile->set[s];
+    int width = most ? (int)((row->misses * PROFILE_HEAT_WIDTH + most - 1) / most) : 0;
+    printf("#HEAT %5d %12llu %12llu %12llu %12llu  ", s, (unsigned long long)row->accesses,
+           (unsigned long long)row->misses, (unsigned long long)row->conflicts,
+           (unsigned long long)row->evictions);
+    for (int i = 0; i < width; i++) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+}
+
+void profile_free(cache_profile_t *profile) {
+  stackdist_free(&profile->shadow);
+  free(profile->set);
+  profile->set = NULL;
+}
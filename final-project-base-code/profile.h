@@ -0,0 +1,71 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdint.h>
+#include "stackdist.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// Cache profile parameters (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROFILE_REUSE_BUCKETS
+#define PROFILE_REUSE_BUCKETS 24  // reuse distances 0, 1, 2-3, 4-7, ...; the last bucket holds the rest
+#endif
+#ifndef PROFILE_HEAT_WIDTH
+#define PROFILE_HEAT_WIDTH 40     // characters of the bar of the set with the most misses
+#endif
+
+enum miss_class_enum {
+  MISS_COMPULSORY = 0,  // first access to the block
+  MISS_CAPACITY = 1,    // would also miss in a fully associative LRU cache of the same size
+  MISS_CONFLICT = 2,    // would hit in that cache: the set mapping or the policy lost it
+  MISS_CLASSES = 3
+};
+
+// heatmap row of one set
+typedef struct
+{
+  uint64_t accesses;
+  uint64_t misses;
+  uint64_t conflicts;
+  uint64_t evictions;
+}profile_set_t;
+
+typedef struct cache_profile
+{
+  // the shadow cache: a block was seen iff it has a stack distance, and hits a fully
+  // associative LRU cache of `lines` lines iff that distance is below `lines`
+  stackdist_t shadow;
+  uint64_t lines;
+  int sets;
+
+  uint64_t misses[MISS_CLASSES];
+  uint64_t reuse[PROFILE_REUSE_BUCKETS];         // accesses per reuse distance bucket
+  uint64_t reuse_misses[PROFILE_REUSE_BUCKETS];  // misses per reuse distance bucket
+  uint64_t first;                                // first accesses, which have no reuse distance
+  uint64_t first_misses;
+  profile_set_t *set;
+}cache_profile_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * starts a profile of a cache of 2^setBits sets of `linesPerSet` lines of 2^blockBits bytes
+ **/
+void profile_init(cache_profile_t *profile, int setBits, int linesPerSet, int blockBits);
+
+/**
+ * adds one access to set `set` and its status_enum outcome in the profiled cache
+ **/
+void profile_access(cache_profile_t *profile, uint64_t set, uint64_t address, int status);
+
+/**
+ * prints the 3C counts, the reuse distance histograms and the per-set heatmap
+ **/
+void profile_print(const cache_profile_t *profile, const char *name);
+
+void profile_free(cache_profile_t *profile);
+
+#endif // __PROFILE_H__
@@ -0,0 +1,215 @@
+#include <string.h>
+#include "cache.h"
+#include "replace.h"
+
+#define PSEL_MAX ((1 << DUEL_PSEL_BITS) - 1)
+
+enum duel_role_enum {
+  DUEL_FOLLOWER = 0,
+  DUEL_SRRIP_LEADER = 1,
+  DUEL_BRRIP_LEADER = 2
+};
+
+// xorshift32, so that runs are reproducible
+static unsigned int replace_rand(Cache *cache) {
+  unsigned int x = cache->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  cache->rng = x;
+  return x;
+}
+
+static unsigned long long way_mask(int ways) {
+  return (ways >= 64) ? ~0ULL : ((1ULL << ways) - 1);
+}
+
+// leaves of the PLRU tree: the associativity rounded up to a power of two
+static int plru_leaves(int ways) {
+  int leaves = 1;
+  while (leaves < ways) {
+    leaves <<= 1;
+  }
+  return leaves;
+}
+
+// points every node on the path to `way` away from it
+static void plru_touch(replace_set_t *set, int ways, int way) {
+  int node = 0, lo = 0;
+  for (int size = plru_leaves(ways); size > 1; size >>= 1) {
+    int half = size >> 1;
+    if (way < lo + half) {
+      set->plru |= (1ULL << node);
+      node = 2 * node + 1;
+    } else {
+      set->plru &= ~(1ULL << node);
+      lo += half;
+      node = 2 * node + 2;
+    }
+  }
+}
+
+// follows the node bits to a leaf, skipping subtrees past the last way
+static int plru_victim(const replace_set_t *set, int ways) {
+  int node = 0, lo = 0;
+  for (int size = plru_leaves(ways); size > 1; size >>= 1) {
+    int half = size >> 1;
+    bool right = (set->plru >> node) & 1;
+    if (right && lo + half < ways) {
+      lo += half;
+      node = 2 * node + 2;
+    } else {
+      node = 2 * node + 1;
+    }
+  }
+  return lo;
+}
+
+static void rrip_set(replace_set_t *set, int way, int rrpv) {
+  for (int v = 0; v <= RRIP_MAX; v++) {
+    set->rrpv[v] &= ~(1ULL << way);
+  }
+  set->rrpv[rrpv] |= (1ULL << way);
+}
+
+// ages every way of the set until at least one is predicted distant (RRIP_MAX)
+static void rrip_age(replace_set_t *set) {
+  int top = RRIP_MAX;
+  while (top > 0 && set->rrpv[top] == 0) {
+    top--;
+  }
+  int delta = RRIP_MAX - top;
+  if (delta == 0) {
+    return;
+  }
+  for (int v = RRIP_MAX; v >= 0; v--) {
+    set->rrpv[v] = (v - delta >= 0) ? set->rrpv[v - delta] : 0;
+  }
+}
+
+// every (sets / DUEL_LEADER_SETS)-th set leads for SRRIP and the one after it for BRRIP
+static int duel_role(const Cache *cache, unsigned long long set_index) {
+  int sets = 1 << cache->setBits;
+  int stride = sets / DUEL_LEADER_SETS;
+  if (stride < 4) {
+    stride = 4;  // keep at least half of a small cache following
+  }
+  switch (set_index % stride) {
+    case 0:  return DUEL_SRRIP_LEADER;
+    case 1:  return DUEL_BRRIP_LEADER;
+    default: return DUEL_FOLLOWER;
+  }
+}
+
+// true if a fill into `set_index` uses the bimodal insertion
+static bool rrip_bimodal(Cache *cache, unsigned long long set_index) {
+  if (cache->policy == REPLACE_BRRIP) {
+    return true;
+  }
+  if (cache->policy != REPLACE_DRRIP) {
+    return false;
+  }
+
+  // a miss in a leader set counts against its policy
+  switch (duel_role(cache, set_index)) {
+    case DUEL_SRRIP_LEADER:
+      if (cache->psel < PSEL_MAX) cache->psel++;
+      return false;
+    case DUEL_BRRIP_LEADER:
+      if (cache->psel > 0) cache->psel--;
+      return true;
+    default:
+      return cache->psel > PSEL_MAX / 2;
+  }
+}
+
+void replace_init(Cache *cache) {
+  assert(cache->policy <= REPLACE_LFU || cache->linesPerSet <= REPLACE_MAX_WAYS);
+  cache->rng = 0x9e3779b9u;
+  cache->psel = PSEL_MAX / 2;
+  cache->next_use = 0;
+  for (int s = 0; s < (1 << cache->setBits); s++) {
+    replace_set_t *set = &cache->sets[s].repl;
+    memset(set, 0, sizeof(*set));
+    set->rrpv[RRIP_MAX] = way_mask(cache->linesPerSet);
+    set->random_way = replace_rand(cache) % cache->linesPerSet;
+  }
+}
+
+void replace_update(Cache *cache, unsigned long long set_index, int way, bool fill) {
+  replace_set_t *set = &cache->sets[set_index].repl;
+  switch (cache->policy) {
+    case REPLACE_PLRU:
+      plru_touch(set, cache->linesPerSet, way);
+      break;
+    case REPLACE_SRRIP:
+    case REPLACE_BRRIP:
+    case REPLACE_DRRIP:
+      if (!fill) {
+        rrip_set(set, way, 0);
+      } else if (rrip_bimodal(cache, set_index) && replace_rand(cache) % BRRIP_LONG_ODDS != 0) {
+        rrip_set(set, way, RRIP_MAX);
+      } else {
+        rrip_set(set, way, RRIP_MAX - 1);
+      }
+      break;
+    case REPLACE_RANDOM:
+      if (fill) {
+        set->random_way = replace_rand(cache) % cache->linesPerSet;
+      }
+      break;
+    case REPLACE_OPT:
+      cache->sets[set_index].lines[way].next_use = cache->next_use;
+      break;
+  }
+}
+
+int replace_victim(const Cache *cache, unsigned long long set_index) {
+  replace_set_t *set = &cache->sets[set_index].repl;
+  switch (cache->policy) {
+    case REPLACE_PLRU:
+      return plru_victim(set, cache->linesPerSet);
+    case REPLACE_SRRIP:
+    case REPLACE_BRRIP:
+    case REPLACE_DRRIP:
+      rrip_age(set);
+      return __builtin_ctzll(set->rrpv[RRIP_MAX]);
+    case REPLACE_RANDOM:
+      return set->random_way;
+    case REPLACE_OPT: {
+      Line *lines = cache->sets[set_index].lines;
+      int victim = 0;
+      for (int i = 1; i < cache->linesPerSet; i++) {
+        if (lines[i].next_use > lines[victim].next_use) {
+          victim = i;
+        }
+      }
+      return victim;
+    }
+    default:
+      return 0;
+  }
+}
+
+int replace_policy(const char *name) {
+  for (int p = REPLACE_LRU; p <= REPLACE_RANDOM; p++) {
+    if (strcmp(name, replace_name(p)) == 0) {
+      return p;
+    }
+  }
+  return -1;
+}
+
+const char *replace_name(int policy) {
+  switch (policy) {
+    case REPLACE_LRU:    return "lru";
+    case REPLACE_LFU:    return "lfu";
+    case REPLACE_PLRU:   return "plru";
+    case REPLACE_SRRIP:  return "srrip";
+    case REPLACE_BRRIP:  return "brrip";
+    case REPLACE_DRRIP:  return "drrip";
+    case REPLACE_RANDOM: return "random";
+    case REPLACE_OPT:    return "opt";
+    default:             return "none";
+  }
+}
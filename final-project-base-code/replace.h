@@ -0,0 +1,73 @@
+#ifndef __REPLACE_H__
+#define __REPLACE_H__
+
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Replacement policy parameters (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RRIP_MAX
+#define RRIP_MAX 3                // largest re-reference prediction value (2-bit RRPVs)
+#endif
+#ifndef BRRIP_LONG_ODDS
+#define BRRIP_LONG_ODDS 32        // BRRIP inserts at RRIP_MAX-1 once in this many fills
+#endif
+#ifndef DUEL_LEADER_SETS
+#define DUEL_LEADER_SETS 32       // leader sets per policy under set dueling
+#endif
+#ifndef DUEL_PSEL_BITS
+#define DUEL_PSEL_BITS 10         // width of the saturating policy selector
+#endif
+#define REPLACE_MAX_WAYS 64       // tree-PLRU and RRIP keep one bit per way in a word
+
+enum replace_policy_enum {
+  REPLACE_LRU = 0,     // least recently used (linear scan of lru_clock)
+  REPLACE_LFU = 1,     // least frequently used, LRU among ties (linear scan of access_counter)
+  REPLACE_PLRU = 2,    // tree pseudo-LRU, one bit per internal node
+  REPLACE_SRRIP = 3,   // static re-reference interval prediction, hit priority
+  REPLACE_BRRIP = 4,   // bimodal RRIP: most fills are predicted distant
+  REPLACE_DRRIP = 5,   // SRRIP or BRRIP, chosen by set dueling
+  REPLACE_RANDOM = 6,
+  REPLACE_OPT = 7      // Belady's MIN, only for the offline replay (see belady.h)
+};
+
+// per-set state of the policies that do not use the lines' lru_clock/access_counter
+typedef struct
+{
+  unsigned long long plru;              // tree node n has children 2n+1 and 2n+2, a set bit points right
+  unsigned long long rrpv[RRIP_MAX+1];  // ways holding each re-reference prediction value
+  int random_way;                       // victim of the next random replacement
+}replace_set_t;
+
+struct cache_s;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * resets the policy state of every set; called by cacheSetUp once the sets exist
+ **/
+void replace_init(struct cache_s *cache);
+
+/**
+ * records an access to `way` of set `set_index`: a hit, or a fill (miss) when `fill` is true
+ **/
+void replace_update(struct cache_s *cache, unsigned long long set_index, int way, bool fill);
+
+/**
+ * output : way to evict from the full set `set_index`, in O(log ways) for tree-PLRU and
+ *          O(1) for RRIP and random; OPT scans for the farthest next use. Selecting the
+ *          same victim twice is allowed.
+ **/
+int replace_victim(const struct cache_s *cache, unsigned long long set_index);
+
+/**
+ * output : replace_policy_enum for "lru", "lfu", "plru", "srrip", "brrip", "drrip" or
+ *          "random", -1 otherwise
+ **/
+int replace_policy(const char *name);
+const char *replace_name(int policy);
+
+#endif // __REPLACE_H__
@@ -11,6 +11,17 @@
 #include <unistd.h>
 #include "cache.h"
 #include "pipeline.h"
+#include "ooo.h"
+#include "prefetch.h"
+#include "replace.h"
+#include "trace.h"
+#include "stackdist.h"
+#include "profile.h"
+#include "mmu.h"
+#include "dram.h"
+#include "bus.h"
+#include "coherence.h"
+#include "multicore.h"
 
 /* WARNING: DO NOT CHANGE THIS FILE.
  YOU PROBABLY DON'T EVEN NEED TO LOOK AT IT... */
@@ -21,7 +32,7 @@ Byte *memory;
 
 void execute_emu(regfile_t *regfile, int prompt, int print) {
   /* fetch an instruction */
-  uint32_t instruction_bits = load(memory, regfile->PC, LENGTH_WORD);
+  uint32_t instruction_bits = load(memory, translate(regfile->PC, MMU_FETCH), LENGTH_WORD);
 
   /* interactive-mode prompt */
   if (prompt) {
@@ -56,6 +67,230 @@ void execute_emu(regfile_t *regfile, int prompt, int print) {
   }
 }
 
+// advance the cycle accurate simulator by one cycle on the scalar or superscalar pipeline
+void cycle_sim(regfile_t *regfile, Cache *cache, Cache *icache, pipeline_regs_t *pipeline_regs,
+               superscalar_regs_t *superscalar_regs, pipeline_wires_t *pipeline_wires,
+               bool *ecall_exit) {
+  if (sim_config.issue_width > 1) {
+    cycle_pipeline_superscalar(regfile, memory, cache, icache, superscalar_regs, pipeline_wires, ecall_exit);
+  } else {
+    cycle_pipeline(regfile, memory, cache, icache, pipeline_regs, pipeline_wires, ecall_exit);
+  }
+}
+
+// per-level hit rates below the L1 and the average memory access time of the data side
+void print_hierarchy_stats(const Cache *l1) {
+  for (const Cache *level = l1->next; level != NULL; level = level->next) {
+    unsigned long long accesses = level->hit_count + level->miss_count;
+    printf("#%-3s hits          = %5d\n", level->name, level->hit_count);
+    printf("#%-3s misses        = %5d\n", level->name, level->miss_count);
+    printf("#%-3s hit rate      = %5.3f\n", level->name, accesses ? (double)level->hit_count / accesses : 0.0);
+    printf("#%-3s back-invals   = %5lld\n", level->name, level->back_invalidations);
+    printf("#%-3s writebacks    = %5lld\n", level->name, level->writebacks);
+  }
+  printf("#AMAT              = %5.3f\n", cache_amat(l1));
+}
+
+// data cache misses split by access type, and the write traffic sent below the L1
+void print_write_stats(const Cache *cache) {
+  printf("#Write policy      = %s, %s\n", cache->writeBack ? "write-back" : "write-through",
+         cache->writeAllocate ? "write-allocate" : "no-write-allocate");
+  printf("#Read misses       = %5lld\n", cache->read_misses);
+  printf("#Write misses      = %5lld\n", cache->write_misses);
+  printf("#Writebacks        = %5lld\n", cache->writebacks);
+  printf("#Write-throughs    = %5lld\n", cache->write_throughs);
+}
+
+// replacement policy of each data level; PSEL shows which side set dueling favours
+void print_replace_stats(const Cache *l1) {
+  for (const Cache *level = l1; level != NULL; level = level->next) {
+    printf("#%-3s replacement   = %s\n", level->name, replace_name(level->policy));
+    if (level->policy == REPLACE_DRRIP) {
+      printf("#%-3s PSEL          = %5d\n", level->name, level->psel);
+    }
+  }
+}
+
+// misses of the recorded L1D stream replayed under the configured policy and under
+// Belady's MIN; the reduction is the share of the policy's misses OPT avoids
+void print_opt_stats(const Cache *cache) {
+  unsigned long long policy_misses = belady_replay(&opt_trace, cache, false);
+  unsigned long long opt_misses = belady_replay(&opt_trace, cache, true);
+  printf("#OPT accesses      = %5zu\n", opt_trace.count);
+  printf("#%-7s misses    = %5lld\n", replace_name(cache->policy), policy_misses);
+  printf("#OPT misses        = %5lld\n", opt_misses);
+  printf("#OPT reduction     = %5.3f\n",
+         policy_misses ? (double)(policy_misses - opt_misses) / policy_misses : 0.0);
+}
+
+// LRU miss-ratio curve of the recorded L1D accesses, for every geometry with the L1D's block size
+void print_stackdist(const Cache *cache) {
+  stackdist_t sd;
+  stackdist_init(&sd, cache->blockBits, STACKDIST_MAX_SET_BITS);
+  for (size_t i = 0; i < opt_trace.count; i++) {
+    stackdist_access(&sd, opt_trace.addrs[i]);
+  }
+  stackdist_print(&sd);
+  stackdist_free(&sd);
+}
+
+// writes the recorded L1D accesses as a binary trace for cachesim
+int write_access_trace(const char *path) {
+  FILE *out = fopen(path, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return -1;
+  }
+  trace_write_header(out);
+  for (size_t i = 0; i < opt_trace.count; i++) {
+    trace_write_record(out, opt_trace.addrs[i], 0, (opt_trace.types[i] == CACHE_WRITE) ? TRACE_STORE : TRACE_LOAD);
+  }
+  fclose(out);
+  return 0;
+}
+
+// non-blocking cache stats; MLP is the average number of fills in flight while any is
+void print_mshr_stats(const Cache *cache) {
+  printf("#MSHRs             = %5d\n", cache->mshrCount);
+  printf("#MSHR misses       = %5lld\n", cache->mshr_primary);
+  printf("#MSHR merges       = %5lld\n", cache->mshr_secondary);
+  printf("#MSHR full stalls  = %5lld\n", cache->mshr_full_stalls);
+  printf("#MLP               = %5.3f\n", cache_mlp(cache));
+}
+
+// hit rate: set misses the victim cache turned into hits, over the set misses it was probed for
+void print_victim_stats(const Cache *cache) {
+  printf("#Victim entries    = %5d\n", cache->victimCount);
+  printf("#Victim probes     = %5lld\n", cache->victim_probes);
+  printf("#Victim hits       = %5lld\n", cache->victim_hits);
+  printf("#Victim hit rate   = %5.3f\n",
+         cache->victim_probes ? (double)cache->victim_hits / cache->victim_probes : 0.0);
+  printf("#Victim evictions  = %5lld\n", cache->victim_evictions);
+}
+
+// walk cycles: latency the page walks added after the misses of each TLB
+void print_mmu_stats(const mmu_t *mmu) {
+  const tlb_t *tlbs[] = {&mmu->itlb, &mmu->dtlb};
+  for (int i = 0; i < 2; i++) {
+    printf("#%s entries      = %5d\n", tlbs[i]->name, tlbs[i]->size);
+    printf("#%s hits         = %5ld\n", tlbs[i]->name, tlbs[i]->hits);
+    printf("#%s misses       = %5ld\n", tlbs[i]->name, tlbs[i]->misses);
+    printf("#%s walk cycles  = %5ld\n", tlbs[i]->name, tlbs[i]->walk_cycles);
+  }
+  printf("#Page walks        = %5ld\n", mmu->walks);
+  printf("#PTE reads         = %5ld\n", mmu->pte_reads);
+  printf("#Page faults       = %5ld\n", mmu->faults);
+}
+
+// the queued writes are served first, so the row buffer counts cover every access;
+// the latencies are those of the reads, from the request to the data
+void print_dram_stats(dram_t *dram) {
+  dram_flush(dram);
+  printf("#DRAM reads        = %5ld\n", dram->reads);
+  printf("#DRAM writes       = %5ld\n", dram->writes);
+  printf("#Row hits          = %5ld\n", dram->row_hits);
+  printf("#Row empty         = %5ld\n", dram->row_empty);
+  printf("#Row conflicts     = %5ld\n", dram->row_conflicts);
+  printf("#Row hit rate      = %5.3f\n", dram_row_hit_rate(dram));
+  printf("#DRAM avg latency  = %5.1f\n", dram_read_latency(dram));
+  printf("#DRAM max latency  = %5ld\n", dram->max_latency);
+  printf("#DRAM queue stalls = %5ld\n", dram->queue_full_stalls);
+  printf("#LATENCY       cycles        reads\n");
+  for (int b = 0; b < DRAM_LATENCY_BUCKETS; b++) {
+    if (dram->latency[b] == 0) {
+      continue;
+    }
+    char range[32];
+    if (b == DRAM_LATENCY_BUCKETS - 1) {
+      snprintf(range, sizeof(range), "%d+", b * DRAM_LATENCY_BUCKET);
+    } else {
+      snprintf(range, sizeof(range), "%d-%d", b * DRAM_LATENCY_BUCKET, (b + 1) * DRAM_LATENCY_BUCKET - 1);
+    }
+    printf("#LATENCY %12s %12ld\n", range, dram->latency[b]);
+  }
+}
+
+// bandwidth and utilization are over all `cycles`; the waits are the cycles a transfer
+// queued behind others, on average per kind; the timeline has one line per window
+void print_bus_stats(const bus_t *bus, uint64_t cycles) {
+  uint64_t bytes = bus->bytes[BUS_FILL] + bus->bytes[BUS_WRITEBACK] + bus->bytes[BUS_PREFETCH];
+  uint64_t transfers = bus->transfers[BUS_FILL] + bus->transfers[BUS_WRITEBACK] + bus->transfers[BUS_PREFETCH];
+  printf("#Bus bytes/cycle   = %5d\n", bus->bytesPerCycle);
+  printf("#Bus fills         = %5ld\n", bus->transfers[BUS_FILL]);
+  printf("#Bus writebacks    = %5ld\n", bus->transfers[BUS_WRITEBACK]);
+  printf("#Bus prefetches    = %5ld\n", bus->transfers[BUS_PREFETCH]);
+  printf("#Bus bytes         = %5ld\n", bytes);
+  printf("#Bus bandwidth     = %5.3f\n", cycles ? (double)bytes / cycles : 0.0);
+  printf("#Bus utilization   = %5.3f\n", cycles ? (double)bus->busy / cycles : 0.0);
+  printf("#Bus fill wait     = %5.1f\n",
+         bus->transfers[BUS_FILL] ? (double)bus->wait[BUS_FILL] / bus->transfers[BUS_FILL] : 0.0);
+  printf("#Bus wb wait       = %5.1f\n",
+         bus->transfers[BUS_WRITEBACK] ? (double)bus->wait[BUS_WRITEBACK] / bus->transfers[BUS_WRITEBACK] : 0.0);
+  printf("#Bus pf wait       = %5.1f\n",
+         bus->transfers[BUS_PREFETCH] ? (double)bus->wait[BUS_PREFETCH] / bus->transfers[BUS_PREFETCH] : 0.0);
+  printf("#Bus avg occupancy = %5.2f\n", transfers ? (double)bus->occupancy / transfers : 0.0);
+  printf("#Bus max occupancy = %5d\n", bus->max_occupancy);
+
+  printf("#BW          cycle  bytes/cycle   util    fills writebacks prefetches\n");
+  for (int w = 0; w < bus->sampleCount; w++) {
+    const bus_window_t *sample = &bus->samples[w];
+    uint64_t start = w * bus->window;
+    uint64_t width = (cycles > start && cycles - start < bus->window) ? cycles - start : bus->window;
+    double util = (double)sample->busy / width;
+    printf("#BW   %12lu %12.3f %6.3f %8lu %10lu %10lu  ", start, (double)sample->bytes / width, util,
+           sample->transfers[BUS_FILL], sample->transfers[BUS_WRITEBACK], sample->transfers[BUS_PREFETCH]);
+    for (int i = 0; i < (int)(util * BUS_BAR_WIDTH + 0.5) && i < BUS_BAR_WIDTH; i++) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+}
+
+// per-core counters, then the requests the directory handled; the cycles are those of the
+// last core to exit
+void print_multicore_stats(const multicore_t *mc, const coherence_t *coh) {
+  printf("#Cycles            = %5ld\n", multicore_cycles(mc));
+  printf("#Cores             = %5d\n", mc->count);
+  printf("#Quantum           = %5ld\n", mc->quantum); // 0 is lockstep
+  if (mc->quantum > 0) {
+    printf("#Quanta            = %5ld\n", mc->quanta);
+  }
+  for (int i = 0; i < mc->count; i++) {
+    const core_t *core = &mc->cores[i];
+    const char *labels[] = {"cycles", "MEM stalls", "stalls", "L1D hits", "L1D misses", "inval miss",
+                            "L1I misses", "fetch stall", "atomics", "SC failures"};
+    uint64_t values[] = {core->cycles, core->mem_stalls, core->stalls, core->hits, core->misses,
+                         coh->invalidation_misses[i], core->icache_misses, core->fetch_stalls,
+                         core->atomics, core->sc_failures};
+    for (int k = 0; k < (int)(sizeof(values) / sizeof(values[0])); k++) {
+      printf("#Core%-2d %-11s= %5ld\n", i, labels[k], values[k]);
+    }
+  }
+  printf("#GetS              = %5ld\n", coh->gets);
+  printf("#GetM              = %5ld\n", coh->getm);
+  printf("#Upgrades          = %5ld\n", coh->upgrades);
+  printf("#Invalidations     = %5ld\n", coh->invalidations);
+  printf("#Forwards          = %5ld\n", coh->forwards);
+  printf("#Owner writebacks  = %5ld\n", coh->owner_writebacks);
+  printf("#Dir evictions     = %5ld\n", coh->evictions);
+  printf("#Inval misses      = %5ld\n", coherence_invalidation_misses(coh));
+}
+
+// accuracy: useful/issued, coverage: useful/(useful + uncovered misses),
+// timeliness: useful prefetches that completed before the demand access
+void print_prefetch_stats(const prefetcher_t *pf) {
+  unsigned long long wanted = pf->useful + pf->misses;
+  printf("#Prefetcher        = %s%s\n", prefetch_name(pf->kind), pf->to_buffer ? " (buffer)" : "");
+  printf("#Prefetches        = %5lld\n", pf->issued);
+  printf("#Prefetches useful = %5lld\n", pf->useful);
+  printf("#Prefetches late   = %5lld\n", pf->late);
+  printf("#Prefetches unused = %5lld\n", pf->unused);
+  printf("#Pollution misses  = %5lld\n", pf->pollution);
+  printf("#PF accuracy       = %5.3f\n", pf->issued ? (double)pf->useful / pf->issued : 0.0);
+  printf("#PF coverage       = %5.3f\n", wanted ? (double)pf->useful / wanted : 0.0);
+  printf("#PF timeliness     = %5.3f\n", pf->useful ? (double)(pf->useful - pf->late) / pf->useful : 0.0);
+}
+
 int load_program(uint8_t *mem, size_t memsize, int startaddr,
                  const char *filename, int disasm) {
   FILE *file = fopen(filename, "r");
@@ -93,8 +328,40 @@ int main(int argc, char **argv) {
       opt_init_reg = 0,
       opt_cache = 0,
       opt_forwarding = 0,
+      opt_issue_width = 1,
+      opt_issue_width_given = 0,
+      opt_ooo = 0,
+      opt_multicycle = 0,
+      opt_early_branch = 0,
+      opt_storebuf_depth = 0,
+      opt_mshr_count = CACHE_MSHR_COUNT,
+      opt_victim_count = CACHE_VICTIM_ENTRIES,
+      opt_victim_latency = CACHE_VICTIM_LATENCY,
+      opt_mmu = 0,
+      opt_itlb_entries = MMU_ITLB_ENTRIES,
+      opt_dtlb_entries = MMU_DTLB_ENTRIES,
+      opt_dram = 0,
+      opt_dram_policy = DRAM_OPEN_PAGE,
+      opt_dram_geometry[3] = {DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS},
+      opt_bus_bytes = 0,
+      opt_bus_window = BUS_WINDOW,
+      opt_cores = 1,
+      opt_quantum = MULTICORE_QUANTUM,
+      opt_prefetch = PREFETCH_NONE,
+      opt_prefetch_buffer = 0,
+      opt_icache = 0,
+      opt_levels = 1,
+      opt_inclusion = CACHE_NON_INCLUSIVE,
+      opt_write_back = CACHE_WRITE_BACK,
+      opt_write_allocate = CACHE_WRITE_ALLOCATE,
+      opt_belady = 0,
+      opt_stackdist = 0,
+      opt_profile = 0,
       opt_printmem = 0;
 
+  #ifdef PRINT_CACHE_STATS
+  int opt_write_policy = 0, opt_replace = 0; // -W and -R were given, their stats are printed
+  #endif
   uint32_t print_mem_startaddr = 0, print_mem_stopaddr = 0;
 
 
@@ -102,8 +369,10 @@ int main(int argc, char **argv) {
   regfile_t regfile;
 
   /* parse the command-line args */
+  const char *opt_trace_path = NULL;
+  int opt_policy[3] = {CACHE_POLICY, L2_POLICY, LLC_POLICY}; // L1D, L2, LLC
   int c;
-  while ((c = getopt(argc, argv, "dvritesmpcf")) != -1) {
+  while ((c = getopt(argc, argv, "dvritesmpcfoubIBDHw:S:M:P:L:W:R:T:V:U:A:Y:N:")) != -1) {
     switch (c) {
     case 'd':
       opt_disasm = 1; break;
@@ -125,6 +394,179 @@ int main(int argc, char **argv) {
       opt_cache = 1; break;
     case 'f':
       opt_forwarding = 1; break;
+    case 'o':
+      opt_ooo = 1; break;
+    case 'u':
+      opt_multicycle = 1; break;
+    case 'b':
+      opt_early_branch = 1; break;
+    case 'I':
+      opt_icache = 1; break;
+    case 'B':
+      opt_belady = 1; break;
+    case 'D':
+      opt_stackdist = 1; break;
+    case 'H':
+      opt_profile = 1; break;
+    case 'T':
+      opt_trace_path = optarg; break;
+    case 'w':
+      opt_issue_width = atoi(optarg);
+      opt_issue_width_given = 1;
+      break;
+    case 'S':
+      opt_storebuf_depth = atoi(optarg);
+      if (opt_storebuf_depth < 1 || opt_storebuf_depth > STORE_BUFFER_MAX) {
+        fprintf(stderr, "Store buffer depth must be between 1 and %d\n", STORE_BUFFER_MAX);
+        return -1;
+      }
+      break;
+    case 'M':
+      opt_mshr_count = atoi(optarg);
+      if (opt_mshr_count < 0 || opt_mshr_count > CACHE_MSHR_MAX) {
+        fprintf(stderr, "MSHR count must be between 0 and %d\n", CACHE_MSHR_MAX);
+        return -1;
+      }
+      break;
+    case 'V': {
+      // -V <entries>[,latency]
+      char *latency = strchr(optarg, ',');
+      if (latency != NULL) {
+        *latency++ = '\0';
+        opt_victim_latency = atoi(latency);
+      }
+      opt_victim_count = atoi(optarg);
+      if (opt_victim_count < 0 || opt_victim_count > CACHE_VICTIM_MAX || opt_victim_latency < 0) {
+        fprintf(stderr, "Victim cache entries must be between 0 and %d, optionally followed by ,latency\n", CACHE_VICTIM_MAX);
+        return -1;
+      }
+      break;
+    }
+    case 'U': {
+      // -U <itlb entries>[,dtlb entries]
+      char *dtlb = strchr(optarg, ',');
+      if (dtlb != NULL) {
+        *dtlb++ = '\0';
+        opt_dtlb_entries = atoi(dtlb);
+      }
+      opt_mmu = 1;
+      opt_itlb_entries = atoi(optarg);
+      if (opt_itlb_entries < 1 || opt_itlb_entries > MMU_TLB_MAX || opt_dtlb_entries < 1 || opt_dtlb_entries > MMU_TLB_MAX) {
+        fprintf(stderr, "TLB entries must be between 1 and %d, as <itlb>[,dtlb]\n", MMU_TLB_MAX);
+        return -1;
+      }
+      break;
+    }
+    case 'A': {
+      // -A <open|closed>[,channels[,ranks[,banks]]]
+      char *field = strtok(optarg, ",");
+      opt_dram = 1;
+      opt_dram_policy = (field != NULL) ? dram_page_policy(field) : -1;
+      for (int i = 0; opt_dram_policy >= 0 && (field = strtok(NULL, ",")) != NULL; i++) {
+        if (i == 3) {
+          opt_dram_policy = -1;
+          break;
+        }
+        opt_dram_geometry[i] = atoi(field);
+      }
+      if (opt_dram_policy < 0) {
+        fprintf(stderr, "DRAM page policy must be open or closed, optionally followed by ,channels,ranks,banks\n");
+        return -1;
+      }
+      break;
+    }
+    case 'Y': {
+      // -Y <bytes per cycle>[,window]
+      char *window = strchr(optarg, ',');
+      if (window != NULL) {
+        *window++ = '\0';
+        opt_bus_window = atoi(window);
+      }
+      opt_bus_bytes = atoi(optarg);
+      if (opt_bus_bytes < 1 || opt_bus_window < 1) {
+        fprintf(stderr, "Bus width must be a positive number of bytes per cycle, optionally followed by ,window cycles\n");
+        return -1;
+      }
+      break;
+    }
+    case 'N': {
+      // -N <cores>[,quantum]
+      char *quantum = strchr(optarg, ',');
+      if (quantum != NULL) {
+        *quantum++ = '\0';
+        opt_quantum = atoi(quantum);
+      }
+      opt_cores = atoi(optarg);
+      if (opt_cores < 1 || opt_cores > MULTICORE_MAX_CORES || opt_quantum < 0) {
+        fprintf(stderr, "Cores must be between 1 and %d, optionally followed by ,quantum cycles (0 runs them in lockstep)\n", MULTICORE_MAX_CORES);
+        return -1;
+      }
+      break;
+    }
+    case 'P': {
+      // -P <next|stride|stream>[,buffer]
+      char *target = strchr(optarg, ',');
+      if (target != NULL) {
+        *target++ = '\0';
+        opt_prefetch_buffer = (strcmp(target, "buffer") == 0);
+      }
+      opt_prefetch = prefetch_kind(optarg);
+      if (opt_prefetch < 0 || (target != NULL && !opt_prefetch_buffer)) {
+        fprintf(stderr, "Prefetcher must be next, stride or stream, optionally followed by ,buffer\n");
+        return -1;
+      }
+      break;
+    }
+    case 'L': {
+      // -L <2|3>[,inclusive|exclusive|nine]
+      char *policy = strchr(optarg, ',');
+      if (policy != NULL) {
+        *policy++ = '\0';
+        if (strcmp(policy, "inclusive") == 0) opt_inclusion = CACHE_INCLUSIVE;
+        else if (strcmp(policy, "exclusive") == 0) opt_inclusion = CACHE_EXCLUSIVE;
+        else if (strcmp(policy, "nine") == 0) opt_inclusion = CACHE_NON_INCLUSIVE;
+        else policy = "";
+      }
+      opt_levels = atoi(optarg);
+      if (opt_levels < 1 || opt_levels > 3 || (policy != NULL && *policy == '\0')) {
+        fprintf(stderr, "Cache levels must be 1 to 3, optionally followed by ,inclusive ,exclusive or ,nine\n");
+        return -1;
+      }
+      break;
+    }
+    case 'W': {
+      // -W <wb|wt>[,wa|nwa]
+      char *allocate = strchr(optarg, ',');
+      if (allocate != NULL) {
+        *allocate++ = '\0';
+      }
+      #ifdef PRINT_CACHE_STATS
+      opt_write_policy = 1;
+      #endif
+      opt_write_back = (strcmp(optarg, "wb") == 0);
+      opt_write_allocate = (allocate == NULL) ? CACHE_WRITE_ALLOCATE : (strcmp(allocate, "wa") == 0);
+      if ((!opt_write_back && strcmp(optarg, "wt") != 0) ||
+          (allocate != NULL && !opt_write_allocate && strcmp(allocate, "nwa") != 0)) {
+        fprintf(stderr, "Write policy must be wb or wt, optionally followed by ,wa or ,nwa\n");
+        return -1;
+      }
+      break;
+    }
+    case 'R': {
+      // -R <policy>[,<policy>[,<policy>]] for the L1D, L2 and LLC
+      char *name = strtok(optarg, ",");
+      #ifdef PRINT_CACHE_STATS
+      opt_replace = 1;
+      #endif
+      for (int level = 0; name != NULL; level++) {
+        if (level >= 3 || (opt_policy[level] = replace_policy(name)) < 0) {
+          fprintf(stderr, "Replacement policy must be lru, lfu, plru, srrip, brrip, drrip or random, for up to 3 levels\n");
+          return -1;
+        }
+        name = strtok(NULL, ",");
+      }
+      break;
+    }
     case 'p':
       opt_printmem = 1;
       if (optind < argc - 1) { // Ensure there are two more arguments
@@ -141,6 +583,27 @@ int main(int argc, char **argv) {
     }
   }
 
+  // the out-of-order core has its own width limit
+  int max_issue_width = opt_ooo ? OOO_MAX_WIDTH : MAX_ISSUE_WIDTH;
+  if (opt_issue_width < 1 || opt_issue_width > max_issue_width) {
+    fprintf(stderr, "Issue width must be between 1 and %d\n", max_issue_width);
+    return -1;
+  }
+
+  // the cores of -N are scalar pipelines with private L1s straight over memory
+  if (opt_cores > 1 && (opt_mulator || opt_ooo || opt_issue_width > 1 || opt_levels > 1 || opt_mmu || opt_dram ||
+                        opt_bus_bytes > 0 || opt_prefetch != PREFETCH_NONE || opt_belady || opt_stackdist ||
+                        opt_trace_path != NULL || opt_profile)) {
+    fprintf(stderr, "-N does not combine with -m, -o, -w, -L, -U, -A, -Y, -P, -B, -D, -T or -H\n");
+    return -1;
+  }
+
+  // only the ID stage of the scalar pipeline resolves branches early
+  if (opt_early_branch && opt_issue_width > 1) {
+    fprintf(stderr, "-b does not combine with -w\n");
+    return -1;
+  }
+
   /* make sure we got an executable filename on the command line */
   if (argc <= optind) {
     fprintf(stderr, "Give me an executable file to run!\n");
@@ -148,7 +611,64 @@ int main(int argc, char **argv) {
   }
   
   Cache cache;
+  cache_config(&cache, CACHE_SET_BITS, CACHE_LINES_PER_SET, CACHE_BLOCK_BITS, opt_policy[0], CACHE_HIT_LATENCY);
+  cache.mshrCount = opt_mshr_count;
+  cache.victimCount = opt_victim_count;
+  cache.victimLatency = opt_victim_latency;
+  cache.writeBack = opt_write_back;
+  cache.writeAllocate = opt_write_allocate;
+  static prefetcher_t prefetcher;
+  if (opt_prefetch != PREFETCH_NONE) {
+    prefetch_init(&prefetcher, opt_prefetch, opt_prefetch_buffer);
+    cache.prefetcher = &prefetcher;
+  }
+  static cache_profile_t profile;
+  if (opt_profile) {
+    profile_init(&profile, CACHE_SET_BITS, CACHE_LINES_PER_SET, CACHE_BLOCK_BITS);
+    cache.profile = &profile;
+  }
   cacheSetUp(&cache, "L1");
+
+  Cache icache;
+  cache_config(&icache, ICACHE_SET_BITS, ICACHE_LINES_PER_SET, ICACHE_BLOCK_BITS, ICACHE_POLICY, CACHE_HIT_LATENCY);
+  cacheSetUp(&icache, "L1I");
+
+  // unified lower levels shared by both L1s
+  Cache l2, llc;
+  cache_config(&l2, L2_SET_BITS, L2_LINES_PER_SET, L2_BLOCK_BITS, opt_policy[1], L2_HIT_LATENCY);
+  cache_config(&llc, LLC_SET_BITS, LLC_LINES_PER_SET, LLC_BLOCK_BITS, opt_policy[2], LLC_HIT_LATENCY);
+  l2.inclusion = llc.inclusion = opt_inclusion;
+  cacheSetUp(&l2, "L2");
+  cacheSetUp(&llc, "LLC");
+  if (opt_levels >= 2) {
+    cache_connect(&cache, &l2);
+    cache_connect(&icache, &l2);
+  }
+  if (opt_levels >= 3) {
+    cache_connect(&l2, &llc);
+  }
+  // DRAM below the lowest cache level, and below the walker and the pipeline without the cache
+  if (opt_dram) {
+    if (!dram_init(&dram, opt_dram_geometry[0], opt_dram_geometry[1], opt_dram_geometry[2], opt_dram_policy)) {
+      fprintf(stderr, "DRAM channels, ranks and banks must be powers of two, at most %d banks in all\n", DRAM_MAX_BANKS);
+      return -1;
+    }
+    cache.dram = icache.dram = l2.dram = llc.dram = &dram;
+    mmu.dram = &dram;
+    sim_config.dram_en = true;
+  }
+  // finite bandwidth between the lowest cache level and memory
+  static bus_t bus;
+  if (opt_bus_bytes > 0) {
+    bus_init(&bus, opt_bus_bytes, opt_bus_window);
+    cache.bus = icache.bus = l2.bus = llc.bus = &bus;
+  }
+  // Sv32 translation for all three models; the page walks read through the L1D when it is simulated
+  if (opt_mmu) {
+    mmu_init(&mmu, opt_itlb_entries, opt_dtlb_entries);
+    mmu.cache = opt_cache ? &cache : NULL;
+    sim_config.mmu_en = true;
+  }
   /* load the executable into memory */
   assert(memory == NULL);
   memory = calloc(MEMORY_SPACE, sizeof(uint8_t)); // allocate zeroed memory
@@ -185,6 +705,7 @@ int main(int argc, char **argv) {
 
   pipeline_regs_t pipeline_regs = {0};
   pipeline_wires_t pipeline_wires = {0};
+  static superscalar_regs_t superscalar_regs;
   total_cycle_counter = 0;
   //mem_access_counter = 0; commenting this because its not working
 
@@ -207,22 +728,150 @@ int main(int argc, char **argv) {
     }
   }
 
+  // OUT-OF-ORDER TIMING MODEL
+  if(opt_sim && opt_ooo)
+  {
+    static ooo_core_t ooo_core;
+    if(opt_cache) sim_config.cache_en = true;
+    if(opt_icache) sim_config.icache_en = true;
+    if(opt_belady || opt_stackdist || opt_trace_path != NULL) sim_config.opt_en = true;
+    if(opt_multicycle) sim_config.fu_en = true;
+    sim_config.storebuf_depth = opt_storebuf_depth;
+    storebuf_init(&store_buffer, opt_storebuf_depth);
+    bool ecall_exit = false;
+    ooo_init(&ooo_core, &regfile, opt_issue_width_given ? opt_issue_width : OOO_WIDTH);
+    if (opt_exit) {
+      /* simulate forever! */
+      while (!ecall_exit) {
+        ooo_cycle(&ooo_core, &regfile, memory, &cache, &icache, &ecall_exit);
+      }
+    } else {
+      /* Either simulate until the program instructions have committed */
+      while (ooo_core.committed < prog_numins) {
+        ooo_cycle(&ooo_core, &regfile, memory, &cache, &icache, &ecall_exit);
+      }
+    }
+
+    #ifdef PRINT_STATS
+    printf("#Cycles            = %5ld\n", total_cycle_counter);
+    printf("#Instructions      = %5ld\n", ooo_core.committed);
+    printf("#IPC               = %5.3f\n", (double)ooo_core.committed / total_cycle_counter);
+    printf("#Mispredicts       = %5ld\n", ooo_core.mispredicts);
+    printf("#Squashed          = %5ld\n", ooo_core.squashed);
+    printf("#Load forwards     = %5ld\n", ooo_core.load_forwards);
+    printf("#ROB full stalls   = %5ld\n", ooo_core.rob_full_stalls);
+    printf("#RS full stalls    = %5ld\n", ooo_core.rs_full_stalls);
+    printf("#LSQ full stalls   = %5ld\n", ooo_core.lsq_full_stalls);
+    if (sim_config.storebuf_depth > 0) {
+      printf("#SB stores         = %5ld\n", store_buffer.inserted);
+      printf("#SB forwards       = %5ld\n", store_buffer.forward_hits);
+      printf("#SB conflicts      = %5ld\n", store_buffer.forward_conflicts);
+      printf("#SB full stalls    = %5ld\n", store_buffer.full_stalls);
+    }
+    if (sim_config.fu_en) {
+      for (int u = FU_UNIT_MUL; u < FU_UNIT_COUNT; u++) {
+        printf("#%s ops           = %5ld\n", fu_unit_name(u), ooo_core.fu.unit[u].ops);
+        printf("#%s busy stalls   = %5ld\n", fu_unit_name(u), ooo_core.fu.unit[u].structural_stalls);
+      }
+    }
+    if (sim_config.mmu_en) {
+      print_mmu_stats(&mmu);
+    }
+    #endif
+    #ifdef PRINT_CACHE_STATS
+      printf("#MEM   stalls      = %5ld\n", mem_stall_counter);
+      printf("#Cache accesses    = %5ld\n", hit_count+miss_count);
+      printf("#Cache hits        = %5ld\n", hit_count);
+      printf("#Cache misses      = %5ld\n", miss_count);
+      if (cache.mshrCount > 0) {
+        print_mshr_stats(&cache);
+      }
+      if (cache.victimCount > 0) {
+        print_victim_stats(&cache);
+      }
+      if (cache.prefetcher != NULL) {
+        print_prefetch_stats(cache.prefetcher);
+      }
+      if (cache.next != NULL) {
+        print_hierarchy_stats(&cache);
+      }
+      if (opt_write_policy) {
+        print_write_stats(&cache);
+      }
+      if (opt_replace) {
+        print_replace_stats(&cache);
+      }
+      if (opt_belady) {
+        print_opt_stats(&cache);
+      }
+      if (opt_stackdist) {
+        print_stackdist(&cache);
+      }
+      if (cache.profile != NULL) {
+        profile_print(cache.profile, cache.name);
+      }
+      if (sim_config.icache_en) {
+        printf("#I-cache accesses  = %5ld\n", icache_hit_count+icache_miss_count);
+        printf("#I-cache hits      = %5ld\n", icache_hit_count);
+        printf("#I-cache misses    = %5ld\n", icache_miss_count);
+        printf("#Fetch stalls      = %5ld\n", fetch_stall_counter);
+      }
+      if (sim_config.dram_en) {
+        print_dram_stats(&dram);
+      }
+      if (cache.bus != NULL) {
+        print_bus_stats(cache.bus, total_cycle_counter);
+      }
+    #endif
+  }
+
+  // MULTI-CORE CYCLE ACCURATE SIMULATOR, without -e every core runs as many cycles as the
+  // single-core pipeline does before its flush
+  if(opt_sim && opt_cores > 1)
+  {
+    static multicore_t multicore;
+    if(opt_cache) sim_config.cache_en = true;
+    if(opt_icache) sim_config.icache_en = true;
+    if(opt_forwarding) sim_config.fwd_en = true;
+    if(opt_multicycle) sim_config.fu_en = true;
+    if(opt_early_branch) sim_config.early_branch = true;
+    sim_config.issue_width = 1;
+    sim_config.storebuf_depth = opt_storebuf_depth;
+    sim_config.cores = opt_cores;
+    coherence_init(&coherence, opt_cores, cache.blockBits);
+    multicore_init(&multicore, opt_cores, opt_quantum, memory, &regfile, &cache, &icache);
+    multicore_run(&multicore, opt_exit ? 0 : prog_numins);
+
+    #ifdef PRINT_STATS
+    print_multicore_stats(&multicore, &coherence);
+    #endif
+    multicore_free(&multicore);
+    coherence_free(&coherence);
+  }
+
   // CYCLE ACCURATE SIMULATOR
-  if(opt_sim)
+  if(opt_sim && !opt_ooo && opt_cores == 1)
   {
     if(opt_cache) sim_config.cache_en = true;
+    if(opt_icache) sim_config.icache_en = true;
+    if(opt_belady || opt_stackdist || opt_trace_path != NULL) sim_config.opt_en = true;
     if(opt_forwarding) sim_config.fwd_en = true;
+    if(opt_multicycle) sim_config.fu_en = true;
+    if(opt_early_branch) sim_config.early_branch = true;
+    sim_config.issue_width = opt_issue_width;
+    sim_config.storebuf_depth = opt_storebuf_depth;
+    storebuf_init(&store_buffer, opt_storebuf_depth);
     bool ecall_exit = false;
     if (opt_exit) {
       /* simulate forever! */
       while (1) {
-        cycle_pipeline(&regfile, memory, &cache, &pipeline_regs, &pipeline_wires, &ecall_exit);
+        cycle_sim(&regfile, &cache, &icache, &pipeline_regs, &superscalar_regs, &pipeline_wires, &ecall_exit);
         if(ecall_exit) break;
       }
     } else {
       /* Either simulate for program instructions */
       while (simins < prog_numins) {
-        cycle_pipeline(&regfile, memory, &cache, &pipeline_regs, &pipeline_wires, &ecall_exit);
+        cycle_sim(&regfile, &cache, &icache, &pipeline_regs, &superscalar_regs, &pipeline_wires, &ecall_exit);
         simins++;
       }
     }
@@ -231,7 +880,7 @@ int main(int argc, char **argv) {
     prog_numins = load_program(memory, MEMORY_SPACE, pipeline_wires.pc_src0, "./code/input/FLUSH.input",
                             opt_disasm);
     while (simins < prog_numins) {
-      cycle_pipeline(&regfile, memory, &cache, &pipeline_regs, &pipeline_wires, &ecall_exit);
+      cycle_sim(&regfile, &cache, &icache, &pipeline_regs, &superscalar_regs, &pipeline_wires, &ecall_exit);
       simins++;
     }
 
@@ -241,20 +890,96 @@ int main(int argc, char **argv) {
     printf("#Forwards (EX-MEM) = %5ld\n", fwd_exmem_counter);
     printf("#Branches taken    = %5ld\n", branch_counter);
     printf("#Stalls            = %5ld\n", stall_counter);
+    if (sim_config.issue_width > 1) {
+      printf("#Issue width       = %5d\n", sim_config.issue_width);
+      printf("#Instructions      = %5ld\n", instr_retired_counter);
+      printf("#IPC               = %5.3f\n", (double)instr_retired_counter / total_cycle_counter);
+      printf("#Splits (MEM)      = %5ld\n", issue_split_mem_counter);
+      printf("#Splits (RAW)      = %5ld\n", issue_split_raw_counter);
+      printf("#Splits (CTRL)     = %5ld\n", issue_split_ctrl_counter);
+    }
+    #ifdef PRINT_STALL_STATS
+    printf("#Stalls (load-use) = %5ld\n", stall_loaduse_counter);
+    printf("#Stalls (branch)   = %5ld\n", stall_branch_counter);
+    printf("#Stalls (FU data)  = %5ld\n", stall_fu_counter);
+    printf("#Stalls (FU busy)  = %5ld\n", fu_scoreboard.unit[FU_UNIT_MUL].structural_stalls + fu_scoreboard.unit[FU_UNIT_DIV].structural_stalls);
+    if (sim_config.mmu_en) {
+      printf("#Stalls (TLB)      = %5ld\n", mmu.itlb.walk_cycles + mmu.dtlb.walk_cycles);
+    }
+    #endif
+    if (sim_config.fu_en) {
+      for (int u = FU_UNIT_MUL; u < FU_UNIT_COUNT; u++) {
+        printf("#%s ops           = %5ld\n", fu_unit_name(u), fu_scoreboard.unit[u].ops);
+        printf("#%s busy stalls   = %5ld\n", fu_unit_name(u), fu_scoreboard.unit[u].structural_stalls);
+      }
+    }
+    if (sim_config.storebuf_depth > 0) {
+      printf("#SB stores         = %5ld\n", store_buffer.inserted);
+      printf("#SB forwards       = %5ld\n", store_buffer.forward_hits);
+      printf("#SB conflicts      = %5ld\n", store_buffer.forward_conflicts);
+      printf("#SB full stalls    = %5ld\n", store_buffer.full_stalls);
+    }
+    if (atomic_counter > 0) {
+      printf("#Atomics           = %5ld\n", atomic_counter);
+      printf("#SC failures       = %5ld\n", sc_fail_counter);
+    }
+    if (sim_config.mmu_en) {
+      print_mmu_stats(&mmu);
+    }
     #endif
     #ifdef PRINT_CACHE_STATS
-      #if defined(CACHE_ENABLE)
-      printf("#MEM   stalls      = %5ld\n", ((miss_count*MEM_LATENCY) + ((hit_count+miss_count) * (CACHE_HIT_LATENCY-1))));
-      #else
-      printf("#MEM   stalls      = %5ld\n", (mem_access_counter*(MEM_LATENCY-1)));
-      #endif
+      printf("#MEM   stalls      = %5ld\n", mem_stall_counter); // timed, with writebacks and any overlap
       printf("#Cache accesses    = %5ld\n", hit_count+miss_count);
       printf("#Cache hits        = %5ld\n", hit_count);
       printf("#Cache misses      = %5ld\n", miss_count);
+      if (cache.mshrCount > 0) {
+        print_mshr_stats(&cache);
+      }
+      if (cache.victimCount > 0) {
+        print_victim_stats(&cache);
+      }
+      if (cache.prefetcher != NULL) {
+        print_prefetch_stats(cache.prefetcher);
+      }
+      if (cache.next != NULL) {
+        print_hierarchy_stats(&cache);
+      }
+      if (opt_write_policy) {
+        print_write_stats(&cache);
+      }
+      if (opt_replace) {
+        print_replace_stats(&cache);
+      }
+      if (opt_belady) {
+        print_opt_stats(&cache);
+      }
+      if (opt_stackdist) {
+        print_stackdist(&cache);
+      }
+      if (cache.profile != NULL) {
+        profile_print(cache.profile, cache.name);
+      }
+      if (sim_config.icache_en) {
+        printf("#I-cache accesses  = %5ld\n", icache_hit_count+icache_miss_count);
+        printf("#I-cache hits      = %5ld\n", icache_hit_count);
+        printf("#I-cache misses    = %5ld\n", icache_miss_count);
+        printf("#Fetch stalls      = %5ld\n", fetch_stall_counter);
+      }
+      if (sim_config.dram_en) {
+        print_dram_stats(&dram);
+      }
+      if (cache.bus != NULL) {
+        print_bus_stats(cache.bus, total_cycle_counter);
+      }
     #endif
 
   }
 
+  // stores still in the store buffer reach memory before it is inspected
+  if (sim_config.storebuf_depth > 0) {
+    storebuf_flush(&store_buffer, memory);
+  }
+
   // print mem
   if(opt_printmem)
   {
@@ -277,5 +1002,24 @@ int main(int argc, char **argv) {
 
   // Deallocate the cache after all operations
   deallocate(&cache);
+  deallocate(&icache);
+  deallocate(&l2);
+  deallocate(&llc);
+  if (opt_trace_path != NULL) {
+    write_access_trace(opt_trace_path);
+  }
+  belady_free(&opt_trace);
+  if (cache.profile != NULL) {
+    profile_free(cache.profile);
+  }
+  if (sim_config.mmu_en) {
+    mmu_free(&mmu);
+  }
+  if (sim_config.dram_en) {
+    dram_free(&dram);
+  }
+  if (cache.bus != NULL) {
+    bus_free(cache.bus);
+  }
   return 0;
 }
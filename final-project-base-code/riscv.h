@@ -11,12 +11,30 @@ void decode_instruction(uint32_t instruction_bits);
 void execute_instruction(uint32_t instruction_bits, regfile_t* regfile, Byte *memory);
 void store(Byte *memory, Address address, Alignment alignment, Word value);
 Word load(Byte *memory, Address address, Alignment alignment);
+Address translate(Address address, int access);
+
+/* RV32A, see emulator.c. The word is read and written with one host atomic, so the
+   cores of -N stay atomic on their host threads. A misaligned address is fatal. An lr.w
+   reservation is lost when another hart writes its word, even with the same value. */
+void reservations_init(int harts); // harts that share memory, before the first access
+bool atomic_rmw(Byte *memory, Address address, unsigned int funct5, Word operand, Word *old); // false for an unknown funct5
+Word load_reserved(Byte *memory, Address address);
+bool store_conditional(Byte *memory, Address address, Word value); // true if stored
 
 // Settings for cycle accurate simulator
 typedef struct
 {
     bool cache_en;
     bool fwd_en;
+    bool fu_en;        // multi-cycle functional units from the fu.c latency table
+    bool early_branch; // resolve branches in ID instead of MEM
+    int issue_width; // instructions issued per cycle, >1 selects the superscalar pipeline
+    int storebuf_depth; // store buffer entries, 0 writes stores straight through the L1
+    bool icache_en;     // fetch through the instruction cache
+    bool opt_en;        // record the L1D accesses, for the Belady OPT replay (-B), the stack distances (-D) or a trace file (-T)
+    bool mmu_en;        // translate fetches, loads and stores through the Sv32 MMU (-U)
+    bool dram_en;       // memory is the DRAM model (-A) instead of the fixed MEM_LATENCY
+    int cores;          // pipelines sharing memory (-N), each on its own host thread; 0 or 1 is one core
 }simulator_config_t;
 
 #endif
@@ -0,0 +1,132 @@
+#include <math.h>
+#include <stdlib.h>
+#include "sample.h"
+
+typedef struct
+{
+  uint64_t hash;
+  int32_t set;
+}sample_rank_t;
+
+static int by_hash(const void *a, const void *b) {
+  const sample_rank_t *x = a, *y = b;
+  return (x->hash > y->hash) - (x->hash < y->hash);
+}
+
+static uint64_t hash_set(uint64_t set) {
+  uint64_t h = (set ^ SAMPLE_SEED) * 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 29);
+}
+
+bool sample_init(sample_t *sample, int setBits, int linesPerSet, int blockBits, int policy, int ratio, int kind) {
+  int sets = 1 << setBits;
+  if (ratio < 1 || ratio > sets || (ratio & (ratio - 1)) != 0) {
+    return false;
+  }
+  memset(sample, 0, sizeof(*sample));
+  sample->setBits = setBits;
+  sample->blockBits = blockBits;
+  sample->ratio = ratio;
+  sample->kind = kind;
+  int sampled = sets / ratio;
+
+  sample->compact = malloc(sets * sizeof(int32_t));
+  sample->set_misses = calloc(sampled, sizeof(uint64_t));
+  assert(sample->compact != NULL && sample->set_misses != NULL);
+  for (int s = 0; s < sets; s++) {
+    sample->compact[s] = (kind == SAMPLE_STRIDE && s % ratio == 0) ? s / ratio : -1;
+  }
+  if (kind == SAMPLE_HASH) {
+    sample_rank_t *rank = malloc(sets * sizeof(sample_rank_t));
+    assert(rank != NULL);
+    for (int s = 0; s < sets; s++) {
+      rank[s].hash = hash_set(s);
+      rank[s].set = s;
+    }
+    qsort(rank, sets, sizeof(sample_rank_t), by_hash);
+    for (int i = 0; i < sampled; i++) {
+      sample->compact[rank[i].set] = i;
+    }
+    free(rank);
+  }
+
+  cache_config(&sample->cache, setBits - __builtin_ctz(ratio), linesPerSet, blockBits, policy, CACHE_HIT_LATENCY);
+  cacheSetUp(&sample->cache, "L1");
+  return true;
+}
+
+// the address keeps its tag and offset, and its set index becomes the sampled set's
+void sample_access(sample_t *sample, unsigned long long address, int type) {
+  unsigned long long set = (address >> sample->blockBits) & ((1ULL << sample->setBits) - 1);
+  sample->accesses++;
+  int32_t compact = sample->compact[set];
+  if (compact < 0) {
+    return;
+  }
+  int blockBits = sample->blockBits, sampledBits = sample->cache.setBits;
+  unsigned long long tag = address >> (blockBits + sample->setBits);
+  unsigned long long remapped = (tag << (blockBits + sampledBits)) | ((unsigned long long)compact << blockBits)
+                                | (address & ((1ULL << blockBits) - 1));
+  sample->sampled_accesses++;
+  if (accessCache(remapped, type, &sample->cache).status != CACHE_HIT) {
+    sample->set_misses[compact]++;
+  }
+}
+
+/* Expansion estimate: ratio times the sampled misses. Its standard error follows from
+ * the variance s^2 of the misses between the n sampled sets of N:
+ *     N * sqrt((1 - n/N) * s^2 / n)
+ * It is 0 when every set is simulated, and unknown (-1) with a single sampled set.
+ */
+double sample_misses(const sample_t *sample, double *error) {
+  int n = 1 << sample->cache.setBits, sets = 1 << sample->setBits;
+  double total = 0.0, squares = 0.0;
+  for (int i = 0; i < n; i++) {
+    total += sample->set_misses[i];
+  }
+  double mean = total / n;
+  for (int i = 0; i < n; i++) {
+    squares += (sample->set_misses[i] - mean) * (sample->set_misses[i] - mean);
+  }
+  if (n == sets) {
+    *error = 0.0;
+  } else if (n < 2) {
+    *error = -1.0;
+  } else {
+    *error = sets * sqrt((1.0 - (double)n / sets) * squares / (n - 1) / n);
+  }
+  return total * sample->ratio;
+}
+
+void sample_print(const sample_t *sample, const Cache *full) {
+  const Cache *cache = &sample->cache;
+  double error;
+  double misses = sample_misses(sample, &error);
+  printf("%s hits: %llu, misses: %.0f, evictions: %llu (estimated from 1/%d of the sets, %s)\n", cache->name,
+         (unsigned long long)cache->hit_count * sample->ratio, misses,
+         (unsigned long long)cache->eviction_count * sample->ratio, sample->ratio,
+         (sample->kind == SAMPLE_HASH) ? "hash" : "stride");
+  printf("%s sampled accesses: %llu of %llu, sampled miss ratio: %.6f\n", cache->name,
+         (unsigned long long)sample->sampled_accesses, (unsigned long long)sample->accesses,
+         sample->sampled_accesses ? (double)cache->miss_count / sample->sampled_accesses : 0.0);
+  if (error >= 0.0) {
+    printf("%s estimated misses: %.0f +- %.0f (95%%, standard error %.1f)\n", cache->name, misses, 1.96 * error, error);
+  } else {
+    printf("%s estimated misses: %.0f, no error estimate from a single set\n", cache->name, misses);
+  }
+  if (full != NULL) {
+    double actual = full->miss_count;
+    printf("%s full run misses: %d, estimate error: %+.3f%%", full->name, full->miss_count,
+           actual ? 100.0 * (misses - actual) / actual : 0.0);
+    if (error > 0.0) {
+      printf(" (%.2f standard errors)", (misses - actual) / error);
+    }
+    printf("\n");
+  }
+}
+
+void sample_free(sample_t *sample) {
+  deallocate(&sample->cache);
+  free(sample->compact);
+  free(sample->set_misses);
+}
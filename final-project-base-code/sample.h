@@ -0,0 +1,66 @@
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+#include <stdint.h>
+#include "cache.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// Set sampling: only one in `ratio` sets of a cache is simulated. Accesses to
+/// the chosen sets are remapped onto a cache with just those sets, so both the
+/// per-set state and the per-access work shrink by the ratio; the counts of the
+/// full cache are estimated from them.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLE_SEED
+#define SAMPLE_SEED 0x5eed  // hash selection seed
+#endif
+
+enum sample_kind_enum {
+  SAMPLE_STRIDE = 0,  // sets 0, ratio, 2*ratio, ...
+  SAMPLE_HASH = 1     // the sets whose hash ranks lowest, spread over the index bits
+};
+
+typedef struct
+{
+  int setBits;
+  int blockBits;
+  int ratio;          // power of two, at most the number of sets
+  int kind;           // sample_kind_enum
+  int32_t *compact;   // set -> sampled set, -1 if it is not simulated
+  Cache cache;        // the sampled sets, 2^setBits / ratio of them
+
+  uint64_t accesses;          // all accesses, simulated or not
+  uint64_t sampled_accesses;
+  uint64_t *set_misses;       // misses of every sampled set, for the error estimate
+}sample_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * samples one in `ratio` sets of a cache of 2^setBits sets of `linesPerSet` lines
+ * output : false if the ratio is not a power of two between 1 and the number of sets
+ **/
+bool sample_init(sample_t *sample, int setBits, int linesPerSet, int blockBits, int policy, int ratio, int kind);
+
+/**
+ * one access (CACHE_READ or CACHE_WRITE); only the sampled sets are simulated
+ **/
+void sample_access(sample_t *sample, unsigned long long address, int type);
+
+/**
+ * output : estimated misses of the full cache, and in *error the standard error of the
+ *          estimate, from the spread of the misses between the sampled sets
+ **/
+double sample_misses(const sample_t *sample, double *error);
+
+/**
+ * prints the estimated counts; with `full` (a full run over the same accesses) also the
+ * actual error of the estimate
+ **/
+void sample_print(const sample_t *sample, const Cache *full);
+
+void sample_free(sample_t *sample);
+
+#endif // __SAMPLE_H__
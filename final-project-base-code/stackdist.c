@@ -0,0 +1,162 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stackdist.h"
+
+#define STACKDIST_FREE_SLOT (~0ULL)
+#define STACKDIST_FIRST_SIZE 64
+
+static void fenwick_add(stackdist_set_t *set, uint32_t i, int delta) {
+  for (; i <= set->size; i += i & -i) {
+    set->tree[i] += delta;
+  }
+}
+
+static uint32_t fenwick_prefix(const stackdist_set_t *set, uint32_t i) {
+  uint32_t sum = 0;
+  for (; i > 0; i -= i & -i) {
+    sum += set->tree[i];
+  }
+  return sum;
+}
+
+/* Doubles the tree. Node i of a Fenwick tree sums (i - lowbit(i), i]; above the old
+ * size n those ranges hold no marks yet, except node 2n which covers everything.
+ */
+static void fenwick_grow(stackdist_set_t *set) {
+  uint32_t old = set->size;
+  uint32_t total = fenwick_prefix(set, old);
+  set->size = old ? 2 * old : STACKDIST_FIRST_SIZE;
+  set->tree = realloc(set->tree, (set->size + 1) * sizeof(*set->tree));
+  assert(set->tree != NULL);
+  memset(&set->tree[old + 1], 0, (set->size - old) * sizeof(*set->tree));
+  set->tree[set->size] = total;
+}
+
+static uint64_t hash_block(uint64_t block) {
+  return block * 0x9e3779b97f4a7c15ULL;
+}
+
+// slot of `block` in the map, inserting it (with no accesses yet) if needed
+static uint64_t map_slot(stackdist_t *sd, uint64_t block);
+
+static void map_grow(stackdist_t *sd) {
+  uint64_t old_slots = sd->slots;
+  uint64_t *old_blocks = sd->blocks;
+  uint32_t *old_last = sd->last;
+  int stride = sd->maxSetBits + 1;
+
+  sd->slots = old_slots ? 2 * old_slots : 4096;
+  sd->used = 0;
+  sd->blocks = malloc(sd->slots * sizeof(*sd->blocks));
+  sd->last = calloc(sd->slots * stride, sizeof(*sd->last));
+  assert(sd->blocks != NULL && sd->last != NULL);
+  for (uint64_t s = 0; s < sd->slots; s++) {
+    sd->blocks[s] = STACKDIST_FREE_SLOT;
+  }
+  for (uint64_t s = 0; s < old_slots; s++) {
+    if (old_blocks[s] != STACKDIST_FREE_SLOT) {
+      uint64_t slot = map_slot(sd, old_blocks[s]);
+      memcpy(&sd->last[slot * stride], &old_last[s * stride], stride * sizeof(*sd->last));
+    }
+  }
+  free(old_blocks);
+  free(old_last);
+}
+
+static uint64_t map_slot(stackdist_t *sd, uint64_t block) {
+  if (2 * (sd->used + 1) > sd->slots) {
+    map_grow(sd);
+  }
+  uint64_t slot = (hash_block(block) >> 20) & (sd->slots - 1);
+  while (sd->blocks[slot] != block) {
+    if (sd->blocks[slot] == STACKDIST_FREE_SLOT) {
+      sd->blocks[slot] = block;
+      sd->used++;
+      break;
+    }
+    slot = (slot + 1) & (sd->slots - 1);
+  }
+  return slot;
+}
+
+void stackdist_init(stackdist_t *sd, int blockBits, int maxSetBits) {
+  assert(maxSetBits >= 0 && maxSetBits <= STACKDIST_MAX_SET_BITS);
+  memset(sd, 0, sizeof(*sd));
+  sd->blockBits = blockBits;
+  sd->maxSetBits = maxSetBits;
+  for (int s = 0; s <= maxSetBits; s++) {
+    sd->sets[s] = calloc(1 << s, sizeof(stackdist_set_t));
+    sd->histogram[s] = calloc(STACKDIST_MAX_DISTANCE + 1, sizeof(uint64_t));
+    assert(sd->sets[s] != NULL && sd->histogram[s] != NULL);
+  }
+  map_grow(sd);
+}
+
+/* Bennett-Kruskal: the LRU stack distance of an access is the number of distinct blocks
+ * of its set touched since the previous access to the same block, i.e. the marks after
+ * that access's local time. The mark then moves to the current time.
+ */
+uint64_t stackdist_access(stackdist_t *sd, uint64_t address) {
+  uint64_t block = address >> sd->blockBits;
+  uint64_t slot = map_slot(sd, block);  // may grow the map, and move sd->last, so it comes first
+  uint32_t *last = &sd->last[slot * (sd->maxSetBits + 1)];
+  uint64_t fully_associative = STACKDIST_COLD;
+  sd->accesses++;
+
+  for (int s = 0; s <= sd->maxSetBits; s++) {
+    stackdist_set_t *set = &sd->sets[s][block & ((1ULL << s) - 1)];
+    uint32_t now = ++set->now;
+    if (now > set->size) {
+      fenwick_grow(set);
+    }
+
+    if (last[s] == 0) {
+      sd->cold[s]++;
+    } else {
+      uint32_t distance = fenwick_prefix(set, now - 1) - fenwick_prefix(set, last[s]);
+      sd->histogram[s][(distance < STACKDIST_MAX_DISTANCE) ? distance : STACKDIST_MAX_DISTANCE]++;
+      fenwick_add(set, last[s], -1);
+      if (s == 0) {
+        fully_associative = distance;
+      }
+    }
+    fenwick_add(set, now, 1);
+    last[s] = now;
+  }
+  return fully_associative;
+}
+
+uint64_t stackdist_misses(const stackdist_t *sd, int setBits, int ways) {
+  assert(setBits >= 0 && setBits <= sd->maxSetBits);
+  uint64_t misses = sd->cold[setBits];
+  for (int d = (ways < STACKDIST_MAX_DISTANCE) ? ways : STACKDIST_MAX_DISTANCE; d <= STACKDIST_MAX_DISTANCE; d++) {
+    misses += sd->histogram[setBits][d];
+  }
+  return misses;
+}
+
+void stackdist_print(const stackdist_t *sd) {
+  printf("#MRC  sets  ways        bytes       misses  miss ratio\n");
+  for (int s = 0; s <= sd->maxSetBits; s++) {
+    for (int ways = 1; ((uint64_t)ways << s) <= STACKDIST_MAX_DISTANCE; ways <<= 1) {
+      uint64_t misses = stackdist_misses(sd, s, ways);
+      printf("#MRC %5d %5d %12llu %12llu  %10.6f\n", 1 << s, ways,
+             (unsigned long long)ways << (s + sd->blockBits), (unsigned long long)misses,
+             sd->accesses ? (double)misses / sd->accesses : 0.0);
+    }
+  }
+}
+
+void stackdist_free(stackdist_t *sd) {
+  for (int s = 0; s <= sd->maxSetBits; s++) {
+    for (int i = 0; i < (1 << s); i++) {
+      free(sd->sets[s][i].tree);
+    }
+    free(sd->sets[s]);
+    free(sd->histogram[s]);
+  }
+  free(sd->blocks);
+  free(sd->last);
+}
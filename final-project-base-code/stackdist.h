@@ -0,0 +1,71 @@
+#ifndef __STACKDIST_H__
+#define __STACKDIST_H__
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// LRU stack distance analysis parameters (override with -D at build time)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef STACKDIST_MAX_SET_BITS
+#define STACKDIST_MAX_SET_BITS 10       // set counts analysed: 2^0 (fully associative) to 2^this
+#endif
+#ifndef STACKDIST_MAX_DISTANCE
+#define STACKDIST_MAX_DISTANCE (1 << 16) // distances from here on are counted together, as misses
+#endif
+
+#define STACKDIST_COLD UINT64_MAX       // distance returned for the first access to a block
+
+// Bennett-Kruskal counter of one set: a mark at the local time of every block's latest access
+typedef struct
+{
+  uint32_t *tree;   // Fenwick tree over local time, 1-based
+  uint32_t size;    // power of two
+  uint32_t now;     // local time of the latest access to the set
+}stackdist_set_t;
+
+typedef struct
+{
+  int blockBits;
+  int maxSetBits;
+  uint64_t accesses;
+
+  // block -> latest local time in its set for every set count (0: never accessed)
+  uint64_t *blocks;
+  uint32_t *last;   // (maxSetBits+1) entries per map slot
+  uint64_t slots;
+  uint64_t used;
+
+  stackdist_set_t *sets[STACKDIST_MAX_SET_BITS+1];
+  uint64_t *histogram[STACKDIST_MAX_SET_BITS+1];  // accesses per distance, STACKDIST_MAX_DISTANCE and above in the last
+  uint64_t cold[STACKDIST_MAX_SET_BITS+1];        // first accesses to a block
+}stackdist_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * starts an analysis of blocks of 2^blockBits bytes, for 2^0 to 2^maxSetBits sets
+ **/
+void stackdist_init(stackdist_t *sd, int blockBits, int maxSetBits);
+
+/**
+ * adds one access; O(log n) per analysed set count
+ * output : its exact fully associative (2^0 sets) stack distance, STACKDIST_COLD on a first access
+ **/
+uint64_t stackdist_access(stackdist_t *sd, uint64_t address);
+
+/**
+ * output : misses of an LRU cache with 2^setBits sets of `ways` lines on the stream so far
+ **/
+uint64_t stackdist_misses(const stackdist_t *sd, int setBits, int ways);
+
+/**
+ * prints the miss-ratio curve: every power-of-two geometry up to STACKDIST_MAX_DISTANCE lines
+ **/
+void stackdist_print(const stackdist_t *sd);
+
+void stackdist_free(stackdist_t *sd);
+
+#endif // __STACKDIST_H__
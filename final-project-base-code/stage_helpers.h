@@ -13,205 +13,15 @@
  * Lex
  **/
 uint32_t gen_alu_control(idex_reg_t idex_reg) {
-  uint32_t alu_control = 0;
-  // Lex
   switch (idex_reg.read_opcode) {
     case 0x33: // R-type
-      switch (idex_reg.read_funct3) {
-        case 0x0:
-          switch (idex_reg.read_funct7) {
-            case 0x00:
-              alu_control = 0x0; // add
-              idex_reg.alu_src = 0;
-              break;
-            case 0x20:
-              alu_control = 0x1; // sub
-              idex_reg.alu_src = 0;
-              break;
-            case 0x01:
-              alu_control = 0xC; // mul
-              idex_reg.alu_src = 0;
-              break;
-          }
-        case 0x1:
-          switch (idex_reg.read_funct7) {
-            case 0x00: // sll
-              alu_control = 0x07;
-              idex_reg.alu_src = 0;
-              break;
-            case 0x01: //mulh 
-              alu_control = 0xB; // mulh, S * S
-              idex_reg.alu_src = 0;
-              break;
-            default:
-              //default: // undefined
-              alu_control = 0xBADCAFFE;
-              break;
-          }
-        case 0x2:
-          switch (idex_reg.read_funct7) {
-            case 0x00: // slt
-            alu_control = 0x11;
-            idex_reg.alu_src = 0;
-            break;
-          case 0x01: // mulsu
-            alu_control = 0xF;
-            idex_reg.alu_src = 0;
-            break;
-          default:
-            alu_control = 0XBACAFFE;
-            break;
-        } 
-        case 0x3:
-          switch (idex_reg.read_funct7) {
-            case 0x0: // unsigned slt
-            alu_control = 0x9;
-            idex_reg.alu_src = 0;
-            break;
-          case 0x1: //mulu
-            alu_control = 0x10;
-            idex_reg.alu_src = 0;
-            break;
-
-          default:
-            alu_control = 0XBADCAFFE;
-            break;
-          }
-        case 0x4:
-          switch (idex_reg.read_funct7) {
-            case 0x12: //div
-              alu_control = 0x12;
-              idex_reg.alu_src = 0;
-              break;
-            case 0x00: // ^
-              alu_control = 0x6;
-              idex_reg.alu_src = 0;
-              break;
-            default:
-              alu_control = 0XBADCAFFE;
-              break;
-          }
-        case 0x5:
-          switch (idex_reg.read_funct7) {
-            case 0x0: //srl
-              alu_control = 0x8;
-              idex_reg.alu_src = 0;
-              break;
-            case 0x20: // sra
-              alu_control = 0xE;
-              break;
-            case  0x01: //div unsigned
-              alu_control = 0x5;
-              idex_reg.alu_src = 0;
-              break;
-            default:
-              alu_control = 0XBADCAFFE;
-              break;
-          }
-        case 0x6:
-          switch (idex_reg.read_funct7) {
-            case 0x0: //or
-              alu_control = 0x3;
-              idex_reg.alu_src = 0;
-              break;
-            case 0x13: // rem
-              alu_control = 0xA;
-              idex_reg.alu_src = 0;
-              break;
-            default:
-              alu_control = 0XBADCAFFE;
-              break;
-          }
-        case 0x7:
-          switch(idex_reg.read_funct7) {
-            case 0x00:
-              alu_control = 0x2;
-              idex_reg.alu_src = 0;
-              break;
-            case 0x01: //unsigned rem
-              alu_control = 0xA;
-              idex_reg.alu_src = 0;
-              break;
-            default:
-              alu_control = 0XBADCAFFE;
-              break;
-          }
-        default: // undefined
-          alu_control = 0xBADCAFFE;
-          break;
-      }
-    case 0x13: // I type
-      switch (idex_reg.read_funct3) {
-        case 0x0: // add
-          alu_control = 0x0;
-          idex_reg.alu_src = 1;
-          break;
-        case 0x4: //xor
-          alu_control = 0x6;
-          idex_reg.alu_src = 1;
-          break;
-        case 0x6: // or
-          alu_control = 0x3;
-          idex_reg.alu_src = 1;
-          break;
-        case 0x7:
-          alu_control = 0x2;
-          idex_reg.alu_src = 1;
-          break;
-        case 0x1:
-          switch (idex_reg.read_imm) { //potential error
-            case 0x0: //sll
-              alu_control = 0x4;
-              idex_reg.alu_src = 1;
-              break;
-
-            default:
-              alu_control = 0xBADCAFFE;
-              break;
-          }
-        case 0x5:
-          switch (idex_reg.read_imm[0::11]) {
-            case 0x0:
-              alu_control = 0xD;
-              idex_reg.alu_src = 1;
-              break;
-            case 0x20: //extend
-              alu_control = 0xE;
-              idex_reg.alu_src = 1;
-              break;
-            default:
-              alu_control = 0xBADCAFFE;
-              break;
-          }
-        case 0x2:
-          alu_control = 0x9;
-          idex_reg.alu_src = 1;
-          break;
-        case 0x3: // (U), zero extend
-          alu_control = 0x9;
-          idex_reg.read_rs1 = sign_extend_number(idex_reg.read_rs1, size(idex_reg.read_rs1));
-          idex_reg.alu_src = 1;
-          break;
-        default:
-          alu_control = 0xBADCAFFE;
-          break;
-      }
-  case 0x3: //I type load
-  case 0x6F: // JAL
-  case 0x67: // JALR
-  case 0x23: // store
-      alu_control = 0x0;
-      idex_reg.alu_src = 1;
-      break;
-    case 0x63: //branch
-      alu_control = 0x1;
-      idex_reg.alu_src = 0;
-      break;
-    default: // undefined
-      alu_control = 0xBADCAFFE;
-      break;
+    case 0x13: // I-type
+      return fu_alu_control(idex_reg.instr);
+    case 0x63: // branch, compares rs1 and rs2
+      return 0x1;
+    default: // loads, stores, atomics and jalr add the immediate to rs1
+      return 0x0;
   }
-  return (alu_control);
 }
 
 /**
@@ -235,7 +45,7 @@ uint32_t execute_alu(uint32_t alu_inp1, uint32_t alu_inp2, uint32_t alu_control)
       result = alu_inp1 | alu_inp2;
       break;
     case 0x4: //sll
-      result = (alu_inp1 << alu_inp2);
+      result = (alu_inp1 << (alu_inp2 & 0x1F));
       break;
     case 0x5: // divu
       if (alu_inp2 == 0) {
@@ -249,10 +59,10 @@ uint32_t execute_alu(uint32_t alu_inp1, uint32_t alu_inp2, uint32_t alu_control)
       result = alu_inp1 ^ alu_inp2;
       break;
     case 0x7: // sll
-      result = alu_inp1 << alu_inp2;
+      result = alu_inp1 << (alu_inp2 & 0x1F);
       break;
     case 0x8: // srl
-      result = alu_inp1 >> alu_inp2;
+      result = alu_inp1 >> (alu_inp2 & 0x1F);
       break;
     case 0x9: // ?
       result = (alu_inp1 < alu_inp2) ? 1 : 0;
@@ -267,25 +77,25 @@ uint32_t execute_alu(uint32_t alu_inp1, uint32_t alu_inp2, uint32_t alu_control)
       break;
 
     case 0xB: //mulh
-      result = ((sWord)(sDouble)alu_inp1 * (sWord)(sDouble)alu_inp2) >> 32;
+      result = ((sDouble)(sWord)alu_inp1 * (sDouble)(sWord)alu_inp2) >> 32;
       break;
     
     case 0xC: // mul
       result = (sWord)alu_inp1 * (sWord)alu_inp2;
       break;
     case 0xD: //slri
-      result =(alu_inp1 >> alu_inp2);
+      result =(alu_inp1 >> (alu_inp2 & 0x1F));
       break;
     case 0xE: // sra
-      result = (sWord)alu_inp1 >> (sWord)alu_inp2;
+      result = (sWord)alu_inp1 >> (alu_inp2 & 0x1F);
       break;
 
     case 0xF: //mulsu
-      result = ((sWord)(sDouble)alu_inp1 * (Word)(Double)alu_inp2) >> 32;
+      result = ((sDouble)(sWord)alu_inp1 * (sDouble)(Word)alu_inp2) >> 32;
       break;
 
     case 0x10:
-      result = ((Word)(Double)alu_inp1 * (Word)(Double)alu_inp2) >> 32;
+      result = ((Double)alu_inp1 * (Double)alu_inp2) >> 32;
       break;
     
     case 0x11: // slt
@@ -321,29 +131,37 @@ uint32_t execute_alu(uint32_t alu_inp1, uint32_t alu_inp2, uint32_t alu_control)
 
 /**
  * input  : Instruction
- * output : idex_reg_t
+ * output : its immediate, sign extended (the shift amount for the shift-by-immediate forms)
  * Kirstin
  **/
 uint32_t gen_imm(Instruction instruction) {
 
-  int imm_val = 0;
+  uint32_t imm_val = 0;
   // get the imm values for instructions with imms
   switch (instruction.opcode) {
   case 0x63: // B-type
     imm_val = get_branch_offset(instruction);
     break;
   case 0x13: // I-type
-    imm_val = instruction.itype.imm;
+    imm_val = sign_extend_number(instruction.itype.imm, 12);
+    if (instruction.itype.funct3 == 0x1 || instruction.itype.funct3 == 0x5) {
+      imm_val &= 0x1F; // shamt
+    }
+    break;
+  case 0x03: // loads
+  case 0x67: // jalr
+    imm_val = sign_extend_number(instruction.itype.imm, 12);
     break;
   case 0x23: // S-type
-    imm_val = get_store_offset(instruction);
+    imm_val = sign_extend_number(get_store_offset(instruction), 12);
     break;
   case 0x6F: // J-type
-    imm_val = get_jump_offset(instruction);
+    imm_val = sign_extend_number(get_jump_offset(instruction), 20);
     break;
   case 0x37: // U-type
-    imm_val = instruction.ujtype.imm;
-  default: // R and undefined opcode
+    imm_val = instruction.utype.imm << 12;
+    break;
+  default: // R-type, atomics (the address is rs1) and undefined opcodes
     break;
   };
   return imm_val;
@@ -357,31 +175,109 @@ uint32_t gen_imm(Instruction instruction) {
  **/
 idex_reg_t gen_control(Instruction instruction) {
   idex_reg_t idex_reg = {0};
+  idex_reg.instr = instruction;
+  idex_reg.read_opcode = instruction.opcode;
   // get the opcode instruction, determine what the register idex_reg needs to hold
   switch (instruction.opcode) {
     case 0x33: // R-type
       idex_reg.read_funct3 = instruction.rtype.funct3;
       idex_reg.read_funct7 = instruction.rtype.funct7;
-      idex_reg.read_opcode = instruction.opcode;
-      break;
-    case 0x23: // S-type
-      idex_reg.read_funct3 = instruction.stype.funct3;
-      idex_reg.read_opcode = instruction.opcode;
+      idex_reg.reg_write = 1;
       break;
     case 0x13: // I-type
       idex_reg.read_funct3 = instruction.itype.funct3;
-      idex_reg.read_opcode = instruction.itype.opcode;
+      idex_reg.alu_src = 1;
+      idex_reg.reg_write = 1;
+      break;
+    case 0x03: // loads
+      idex_reg.read_funct3 = instruction.itype.funct3;
+      idex_reg.alu_src = 1;
+      idex_reg.mem_read = 1;
+      idex_reg.mem_to_reg = 1;
+      idex_reg.reg_write = 1;
+      break;
+    case 0x23: // S-type
+      idex_reg.read_funct3 = instruction.stype.funct3;
+      idex_reg.alu_src = 1;
+      idex_reg.mem_write = 1;
       break;
     case 0x63: // B-type
       idex_reg.read_funct3 = instruction.sbtype.funct3;
-      idex_reg.read_opcode = instruction.sbtype.opcode;
       break;
-    default: // Remaining opcodes
+    case 0x2F: // atomics, R-type layout with funct5 in the top of funct7. rd gets the word read, which all but lr.w write back
+      idex_reg.read_funct3 = instruction.rtype.funct3;
+      idex_reg.read_funct7 = instruction.rtype.funct7;
+      idex_reg.alu_src = 1;
+      idex_reg.mem_read = 1;
+      idex_reg.mem_write = ((instruction.rtype.funct7 >> 2) != 0x02);
+      idex_reg.mem_to_reg = 1;
+      idex_reg.reg_write = 1;
+      break;
+    case 0x67: // jalr
+      idex_reg.read_funct3 = instruction.itype.funct3;
+      idex_reg.alu_src = 1;
+      idex_reg.reg_write = 1;
+      break;
+    case 0x37: // lui
+    case 0x6F: // jal
+      idex_reg.reg_write = 1;
+      break;
+    default: // ecall and undefined opcodes
       break;
   }
   return idex_reg;
 }
 
+/**
+ * input  : Instruction
+ * output : destination register written by the instruction (0 if none)
+ */
+unsigned int instr_dest_reg(Instruction instruction) {
+  switch (instruction.opcode) {
+    case 0x33: // R-type
+    case 0x13: // I-type
+    case 0x03: // loads
+    case 0x2F: // atomics
+    case 0x37: // lui
+    case 0x6F: // jal
+    case 0x67: // jalr
+      return instruction.rtype.rd;
+    default: // stores, branches, ecall
+      return 0;
+  }
+}
+
+/**
+ * input  : Instruction, register index
+ * output : true if the instruction reads the register as rs1 or rs2
+ */
+bool instr_reads_reg(Instruction instruction, unsigned int reg) {
+  if (reg == 0) {
+    return false;
+  }
+  switch (instruction.opcode) {
+    case 0x33: // R-type
+    case 0x23: // S-type
+    case 0x63: // B-type
+    case 0x2F: // atomics (lr.w has rs2 = x0)
+      return (instruction.rtype.rs1 == reg) || (instruction.rtype.rs2 == reg);
+    case 0x13: // I-type
+    case 0x03: // loads
+    case 0x67: // jalr
+      return (instruction.itype.rs1 == reg);
+    default:
+      return false;
+  }
+}
+
+/**
+ * input  : Instruction
+ * output : true if its result is read from memory, so it is only known after MEM (loads and atomics)
+ */
+bool instr_reads_memory(Instruction instruction) {
+  return (instruction.opcode == 0x03) || (instruction.opcode == 0x2F);
+}
+
 /// MEMORY STAGE HELPERS ///
 
 /**
@@ -400,9 +296,9 @@ bool gen_branch(Instruction instruction, uint32_t read_rs1, uint32_t read_rs2) {
       case 0x1:
         return (read_rs1 != read_rs2);
       case 0x4:
-        return (read_rs1 < read_rs2);
+        return ((sWord)read_rs1 < (sWord)read_rs2);
       case 0x5:
-        return (read_rs1 >=read_rs2);
+        return ((sWord)read_rs1 >= (sWord)read_rs2);
       case 0x6:
         return (read_rs1 < read_rs2);
       case 0x7:
@@ -415,6 +311,103 @@ bool gen_branch(Instruction instruction, uint32_t read_rs1, uint32_t read_rs2) {
 
 }
 
+/**
+ * Task   : RV32A access of the MEM stage, at cycle `now`. The older stores drain from
+ *          the store buffer first, then the word is read and written in one step. The L1
+ *          access is a read for lr.w and a failed sc.w, and a write, which needs the
+ *          block exclusive, for the others.
+ * input  : Instruction, its PC, physical address, rs2, cycle, Byte*, Cache*
+ * output : the value for rd: the old word, or for sc.w 0 if it stored and 1 if not
+ */
+uint32_t gen_atomic(Instruction instruction, uint32_t pc, uint32_t addr, uint32_t rs2, uint64_t now, Byte *memory_p, Cache *cache_p) {
+  unsigned int funct5 = instruction.rtype.funct7 >> 2;
+  Word value = 0;
+  int type = CACHE_WRITE;
+
+  if (sim_config.storebuf_depth > 0) {
+    uint64_t drained = storebuf_drain(&store_buffer, memory_p, cache_p, now);
+    mem_stall_counter += drained - now;
+    now = drained;
+  }
+
+  atomic_counter++;
+  if (funct5 == 0x02) {
+    value = load_reserved(memory_p, addr);
+    type = CACHE_READ;
+  } else if (funct5 == 0x03) {
+    value = !store_conditional(memory_p, addr, rs2);
+    sc_fail_counter += value;
+    type = value ? CACHE_READ : CACHE_WRITE;
+  } else if (!atomic_rmw(memory_p, addr, funct5, rs2, &value)) {
+    type = CACHE_READ; // not an AMO, memory is left alone
+  }
+  mem_stall_counter += data_access_latency(addr, pc, type, cache_p, now) - 1;
+  return value;
+}
+
+/**
+ * Task   : Data access of the MEM stage. Stores enter the store buffer when it is
+ *          enabled and otherwise write through the L1. Loads take their data from
+ *          the store buffer when it covers them, wait for it to drain on a partial
+ *          overlap, and otherwise read memory through the L1. With -U the address
+ *          is translated first. Latency beyond one cycle is charged to mem_stall_counter,
+ *          except for a load read through a non-blocking L1 (-M): it sets the ready
+ *          cycle of its register instead, and only the instructions that read it wait.
+ * input  : Instruction, its PC, address, store data, Byte*, Cache*
+ * output : loaded value (sign extended for lb/lh), 0 for stores
+ */
+uint32_t gen_mem_access(Instruction instruction, uint32_t pc, uint32_t addr, uint32_t store_value, Byte *memory_p, Cache *cache_p) {
+  unsigned int funct3 = instruction.itype.funct3;
+  Alignment size = ((funct3 & 0x3) == 0x0) ? LENGTH_BYTE : ((funct3 & 0x3) == 0x1) ? LENGTH_HALF_WORD : LENGTH_WORD;
+  uint64_t now = total_cycle_counter + mem_stall_counter;
+  bool writes = (instruction.opcode == 0x23) || (instruction.opcode == 0x2F && (instruction.rtype.funct7 >> 2) != 0x02);
+  Word value;
+
+  uint64_t issued = now;
+  addr = data_translate(addr, writes ? MMU_STORE : MMU_LOAD, &now);
+  mem_stall_counter += now - issued; // D-TLB miss: the page walk comes before the access
+
+  if (instruction.opcode == 0x2F) {
+    return gen_atomic(instruction, pc, addr, store_value, now, memory_p, cache_p);
+  }
+
+  if (instruction.opcode == 0x23) {
+    if (sim_config.storebuf_depth > 0) {
+      mem_stall_counter += storebuf_insert(&store_buffer, memory_p, cache_p, now, addr, size, store_value);
+    } else {
+      store(memory_p, addr, size, store_value);
+      mem_stall_counter += data_access_latency(addr, pc, CACHE_WRITE, cache_p, now) - 1;
+    }
+    return 0;
+  }
+
+  int forward = SB_FORWARD_NONE;
+  if (sim_config.storebuf_depth > 0) {
+    forward = storebuf_forward(&store_buffer, addr, size, &value);
+    if (forward == SB_FORWARD_CONFLICT) {
+      uint64_t drained = storebuf_drain_conflict(&store_buffer, memory_p, cache_p, now, addr, size);
+      mem_stall_counter += drained - now;
+      now = drained;
+    }
+  }
+  if (forward != SB_FORWARD_HIT) {
+    value = load(memory_p, addr, size);
+    int latency = data_access_latency(addr, pc, CACHE_READ, cache_p, now);
+    if (sim_config.cache_en && cache_p->mshrCount > 0) {
+      // non-blocking L1 (-M): MEM moves on, the instructions that read rd wait for the data
+      if (instruction.itype.rd != 0) {
+        fu_scoreboard.reg_ready[instruction.itype.rd] = now + latency;
+      }
+    } else {
+      mem_stall_counter += latency - 1;
+    }
+  }
+
+  if (funct3 == 0x0) return sign_extend_number(value, 8);
+  if (funct3 == 0x1) return sign_extend_number(value, 16);
+  return value;
+}
+
 /// PIPELINE FEATURES ///
 
 /**
@@ -432,43 +425,177 @@ void gen_forward(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p) {
         2. MEM  Hazard:  When  resolving  a  MEM  hazard  (which  will  require  a  forwarding  from 
         MEMWB  register  to  the  EX  stage),  the  simulator  should  print  the  following  line: “[FWD]: Resolving MEM hazard on RS: xREG” 
    */
-  pwires_p->forwardA = 0;
-  pwires_p->forwardB = 0;
+  Instruction instr = pregs_p->idex_preg.out.instr;
+  exmem_reg_t *exmem = &pregs_p->exmem_preg.out;
+  memwb_reg_t *memwb = &pregs_p->memwb_preg.out;
+  unsigned int rs[2] = {instr.rtype.rs1, instr.rtype.rs2};
+  int *forward[2] = {&pwires_p->forwardA, &pwires_p->forwardB};
+  bool uses_rs2 = (instr.opcode == 0x33) || (instr.opcode == 0x23) || (instr.opcode == 0x63) || (instr.opcode == 0x2F);
+  bool source[2] = {instr_reads_reg(instr, rs[0]), uses_rs2 && instr_reads_reg(instr, rs[1])};
+
+  // exmem forwarding, the newest value
+  for (int r = 0; r < 2; r++) {
+    *forward[r] = 0;
+    if (source[r] && exmem->reg_write && exmem->write_rd == rs[r]) {
+      *forward[r] = 2; // (Forward from exmem_reg pipe stage)
+      fwd_exex_counter++;
+      #ifdef DEBUG_CYCLE
+      printf("[FWD]: Resolving EX hazard on rs%d: x%d\n", r + 1, rs[r]);
+      #endif
+    }
+  }
 
-  printf("Checking EX hazard: write_rd = %d, rs1 = %d\n",
-  pregs_p->exmem_preg.out.write_rd, pregs_p->idex_preg.out.read_rs1);
-  
-  // exmem forwarding
-  if ((pregs_p->exmem_preg.out.reg_write && (pregs_p->exmem_preg.out.write_rd != 0)) && (pregs_p->exmem_preg.out.write_rd == pregs_p->idex_preg.out.read_rs1)) {
-    pwires_p->forwardA = 2; // (Forward from exmem_reg pipe stage)
+  // memwb forwarding, unless exmem already has a newer value
+  for (int r = 0; r < 2; r++) {
+    if (source[r] && *forward[r] == 0 && memwb->reg_write && memwb->write_rd == rs[r]) {
+      *forward[r] = 1; // (Forward from memwb_reg pipe stage)
+      fwd_exmem_counter++;
+      #ifdef DEBUG_CYCLE
+      printf("[FWD]: Resolving MEM hazard on rs%d: x%d\n", r + 1, rs[r]);
+      #endif
+    }
+  }
+}
 
-    printf("[FWD]: Resolving EX hazard on RS: x%d\n", pregs_p->idex_preg.out.read_rs1);
+/**
+ * Task   : Functional unit interlocks. The instruction entering EX waits while its
+ *           unit is still busy (initiation interval), otherwise it starts on the unit
+ *           and the scoreboard records when its result is ready. The instruction in
+ *           ID then waits until every source it reads is ready for it in EX.
+ * input  : pipeline_regs_t*, pipeline_wires_t*
+ * output : None
+ */
+void detect_fu_hazard(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p) {
+  Instruction ex_instr = { .bits = pregs_p->idex_preg.out.instr_bits };
+  Instruction id_instr = { .bits = pregs_p->idex_preg.inp.instr_bits };
+  uint64_t now = total_cycle_counter + mem_stall_counter; // the clock of the memory path, memory stalls hold the whole pipeline
+  fu_timing_t timing = fu_timing(ex_instr, sim_config.fu_en);
+
+  if (!fu_unit_free(&fu_scoreboard, timing.unit, now)) {
+    pwires_p->stall_ex = true;
+    fu_scoreboard.unit[timing.unit].structural_stalls++;
+    stall_counter++;
+    #ifdef DEBUG_CYCLE
+    printf("[HZD]: %s unit busy, holding EX\n", fu_unit_name(timing.unit));
+    #endif
+    return;
+  }
+  fu_issue(&fu_scoreboard, ex_instr, sim_config.fu_en, now);
+
+  // the ID instruction would reach EX next cycle
+  for (unsigned int reg = 1; reg < 32; reg++) {
+    if (instr_reads_reg(id_instr, reg) && fu_scoreboard.reg_ready[reg] > now + 1) {
+      pwires_p->stall_id = true;
+      stall_fu_counter++;
+      stall_counter++;
+      #ifdef DEBUG_CYCLE
+      printf("[HZD]: Waiting on multi-cycle result in x%d\n", reg);
+      #endif
+      return;
+    }
+  }
+}
 
+/**
+ * Task   : A load through a non-blocking L1 (-M) leaves MEM before its data arrives. MEM
+ *          runs after detect_hazard, so this checks the instruction in ID again once MEM
+ *          has set the ready cycle of the loaded register; the following cycles are
+ *          covered by detect_fu_hazard. An early branch held here is not taken yet.
+ * input  : pipeline_regs_t*, pipeline_wires_t*
+ * output : None
+ */
+void detect_pending_load(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p) {
+  Instruction id_instr = { .bits = pregs_p->idex_preg.inp.instr_bits };
+  uint64_t now = total_cycle_counter + mem_stall_counter;
+
+  for (unsigned int reg = 1; reg < 32; reg++) {
+    if (instr_reads_reg(id_instr, reg) && fu_scoreboard.reg_ready[reg] > now + 1) {
+      pwires_p->stall_id = true;
+      pwires_p->id_branch_taken = false;
+      stall_fu_counter++;
+      stall_counter++;
+      #ifdef DEBUG_CYCLE
+      printf("[HZD]: Waiting on a load miss in x%d\n", reg);
+      #endif
+      return;
+    }
   }
-  if ((pregs_p->exmem_preg.out.reg_write && (pregs_p->exmem_preg.out.write_rd != 0)) && (pregs_p->exmem_preg.out.write_rd == pregs_p->idex_preg.out.read_rs2)) {
-    pwires_p->forwardB = 2; // (Forward from exmem_reg pipe stage)
-    
-    printf("[FWD]: Resolving EX hazard on RS: x%dn", pregs_p->idex_preg.out.read_rs2);
+}
 
+/**
+ * Task   : Load-use interlock. A load or atomic in EX only has its data at the end of MEM,
+ *           so an instruction in ID that reads the loaded register waits one cycle. Like
+ *           the milestone 2 reference, the EX hazard the stall resolves counts as an
+ *           EX-EX forward.
+ * input  : pipeline_regs_t*, pipeline_wires_t*
+ * output : None
+ */
+void detect_load_use(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p) {
+  Instruction ex_instr = { .bits = pregs_p->idex_preg.out.instr_bits };
+  Instruction id_instr = { .bits = pregs_p->idex_preg.inp.instr_bits };
+
+  if (instr_reads_memory(ex_instr) && instr_reads_reg(id_instr, instr_dest_reg(ex_instr))) {
+    pwires_p->stall_id = true;
+    stall_loaduse_counter++;
+    stall_counter++;
+    fwd_exex_counter++;
+    #ifdef DEBUG_CYCLE
+    printf("[HZD]: Stalling and rewriting PC: 0x%08x\n", pregs_p->ifid_preg.inp.pc);
+    #endif
   }
-  
+}
 
-  // memwb forwarding
-  if ((pregs_p->memwb_preg.out.reg_write && (pregs_p->memwb_preg.out.write_rd != 0)) && (pregs_p->memwb_preg.out.write_rd == pregs_p->idex_preg.out.read_rs1)) {
-    pwires_p->forwardA = 1; // (Forward from memwb_reg pipe stage)
+/**
+ * Task   : Early branch resolution. The branch in ID compares operands read from the
+ *           register file or forwarded into ID from the EXMEM/MEMWB registers. It
+ *           waits while a producer is still in EX, or is a load that is still in MEM.
+ *           The decision is latched in id_branch_taken/id_branch_target and applied
+ *           by cycle_pipeline in place of the late decision of the MEM stage.
+ * input  : pipeline_regs_t*, pipeline_wires_t*, regfile_t*
+ * output : None
+ */
+void detect_branch_hazard(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p, regfile_t *regfile_p) {
+  Instruction id_instr = pregs_p->ifid_preg.out.instr;
+  Instruction ex_instr = { .bits = pregs_p->idex_preg.out.instr_bits };
+  Instruction mem_instr = { .bits = pregs_p->exmem_preg.out.instr_bits };
+  Instruction wb_instr = { .bits = pregs_p->memwb_preg.out.instr_bits };
+
+  pwires_p->id_branch_taken = false;
+  if (id_instr.opcode != 0x63) {
+    return;
+  }
 
-    printf("[FWD]: Resolving MEM hazard on RS: x%d\n", pregs_p->idex_preg.out.read_rs1);
+  unsigned int rs[2] = {id_instr.sbtype.rs1, id_instr.sbtype.rs2};
+  uint32_t value[2];
+  for (int r = 0; r < 2; r++) {
+    if (rs[r] == 0) {
+      value[r] = 0;
+      continue;
+    }
+    if (instr_dest_reg(ex_instr) == rs[r] || (instr_reads_memory(mem_instr) && instr_dest_reg(mem_instr) == rs[r])) {
+      pwires_p->stall_id = true;
+      stall_branch_counter++;
+      stall_counter++;
+      #ifdef DEBUG_CYCLE
+      printf("[HZD]: Stalling branch in ID on RS: x%d\n", rs[r]);
+      #endif
+      return;
+    }
 
+    // newest value first: EXMEM, then MEMWB, then the register file
+    if (instr_dest_reg(mem_instr) == rs[r]) {
+      value[r] = pregs_p->exmem_preg.out.result;
+    } else if (instr_dest_reg(wb_instr) == rs[r]) {
+      value[r] = instr_reads_memory(wb_instr) ? pregs_p->memwb_preg.out.mem_read : pregs_p->memwb_preg.out.alu_result;
+    } else {
+      value[r] = regfile_p->R[rs[r]];
+    }
   }
-  if ((pregs_p->memwb_preg.out.reg_write && (pregs_p->memwb_preg.out.write_rd != 0)) && (pregs_p->memwb_preg.out.write_rd == pregs_p->idex_preg.out.read_rs2)) {
-    pwires_p->forwardB = 1; // (Forward from memwb_reg pipe stage)
-    printf("[FWD]: Resolving MEM hazard on RS: x%d\n", pregs_p->idex_preg.out.read_rs2);
 
+  if (gen_branch(id_instr, value[0], value[1])) {
+    pwires_p->id_branch_taken = true;
+    pwires_p->id_branch_target = pregs_p->ifid_preg.out.pc + get_branch_offset(id_instr);
   }
-  
-  // 2a. memwb_reg.RegisterRd = ID/EX.RegisterRs1
-  // 2b. memwb_reg.RegisterRd = ID/EX.RegisterRs2
-
 }
 
 /**
@@ -479,9 +606,113 @@ void gen_forward(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p) {
  * Lex
  */
 void detect_hazard(pipeline_regs_t *pregs_p, pipeline_wires_t *pwires_p, regfile_t *regfile_p) {
-  printf("detect_hazard() called\n");
-  gen_forward(pregs_p, pwires_p);
-  
+  pwires_p->stall_id = false;
+  pwires_p->stall_ex = false;
+  pwires_p->id_branch_taken = false;
+  pwires_p->forwardA = 0;
+  pwires_p->forwardB = 0;
+  detect_fu_hazard(pregs_p, pwires_p);
+
+  // without forwarding (-f) the program itself keeps dependent instructions apart
+  if (sim_config.fwd_en && !pwires_p->stall_ex) {
+    gen_forward(pregs_p, pwires_p);
+  }
+  if (sim_config.fwd_en && !pwires_p->stall_id && !pwires_p->stall_ex) {
+    detect_load_use(pregs_p, pwires_p);
+  }
+  if (sim_config.early_branch && !pwires_p->stall_id && !pwires_p->stall_ex) {
+    detect_branch_hazard(pregs_p, pwires_p, regfile_p);
+  }
+}
+
+/// SUPERSCALAR FEATURES ///
+
+enum issue_split_enum {
+  ISSUE_OK = 0,
+  ISSUE_SPLIT_MEM = 1,  // a memory instruction is already in the group (single memory port)
+  ISSUE_SPLIT_RAW = 2,  // the candidate reads a register written by an older instruction of the group
+  ISSUE_SPLIT_CTRL = 3  // a control transfer closes the group
+};
+
+/**
+ * Task   : Applies the issue-pairing rules of the N-wide in-order pipeline.
+ *          `group` holds the `count` older instructions already issued this cycle.
+ * input  : Instruction[], int, Instruction
+ * output : ISSUE_OK if the candidate may issue in the same cycle, otherwise the split reason
+ */
+int check_issue_pair(Instruction group[], int count, Instruction candidate) {
+  bool candidate_mem = (candidate.opcode == 0x03) || (candidate.opcode == 0x23) || (candidate.opcode == 0x2F);
+
+  for (int i = 0; i < count; i++) {
+    switch (group[i].opcode) {
+      case 0x63: // B-type
+      case 0x6F: // jal
+      case 0x67: // jalr
+      case 0x73: // ecall
+        return ISSUE_SPLIT_CTRL;
+      case 0x03: // loads
+      case 0x23: // stores
+      case 0x2F: // atomics
+        if (candidate_mem) {
+          return ISSUE_SPLIT_MEM;
+        }
+        break;
+      default:
+        break;
+    }
+    if (instr_reads_reg(candidate, instr_dest_reg(group[i]))) {
+      return ISSUE_SPLIT_RAW;
+    }
+  }
+  return ISSUE_OK;
+}
+
+/**
+ * Task   : Forwarding unit extended to all lanes. Sets forwardA/forwardB (2: EXMEM,
+ *          1: MEMWB, 0: register file) and the source lane for the instruction in
+ *          `lane`'s IDEX register. EXMEM sources are newer than MEMWB sources, and
+ *          within a stage a higher lane is younger, so they are searched in that order.
+ * input  : superscalar_regs_t*, int, pipeline_wires_t*
+ * output : None
+ */
+void gen_forward_superscalar(superscalar_regs_t *sregs_p, int lane, pipeline_wires_t *pwires_p) {
+  Instruction instr = { .bits = sregs_p->lane[lane].idex_preg.out.instr_bits };
+  unsigned int rs[2] = {instr.rtype.rs1, instr.rtype.rs2};
+  int *forward[2] = {&pwires_p->forwardA, &pwires_p->forwardB};
+  int *forward_lane[2] = {&pwires_p->forwardA_lane, &pwires_p->forwardB_lane};
+  bool uses_rs2 = (instr.opcode == 0x33) || (instr.opcode == 0x23) || (instr.opcode == 0x63) || (instr.opcode == 0x2F);
+
+  for (int r = 0; r < 2; r++) {
+    *forward[r] = 0;
+    *forward_lane[r] = 0;
+    if (!instr_reads_reg(instr, rs[r]) || (r == 1 && !uses_rs2)) {
+      continue; // field is not a source register of this instruction
+    }
+
+    for (int src = sim_config.issue_width - 1; src >= 0 && *forward[r] == 0; src--) {
+      exmem_reg_t *exmem = &sregs_p->lane[src].exmem_preg.out;
+      if (sregs_p->exmem_valid[src] && exmem->reg_write && exmem->write_rd != 0 && exmem->write_rd == rs[r]) {
+        *forward[r] = 2;
+        *forward_lane[r] = src;
+        fwd_exex_counter++;
+        #ifdef DEBUG_CYCLE
+        printf("[FWD]: Resolving EX hazard on RS: x%d (lane %d <- lane %d)\n", rs[r], lane, src);
+        #endif
+      }
+    }
+
+    for (int src = sim_config.issue_width - 1; src >= 0 && *forward[r] == 0; src--) {
+      memwb_reg_t *memwb = &sregs_p->lane[src].memwb_preg.out;
+      if (sregs_p->memwb_valid[src] && memwb->reg_write && memwb->write_rd != 0 && memwb->write_rd == rs[r]) {
+        *forward[r] = 1;
+        *forward_lane[r] = src;
+        fwd_exmem_counter++;
+        #ifdef DEBUG_CYCLE
+        printf("[FWD]: Resolving MEM hazard on RS: x%d (lane %d <- lane %d)\n", rs[r], lane, src);
+        #endif
+      }
+    }
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include "riscv.h"
+#include "pipeline.h"
+#include "storebuf.h"
+
+void storebuf_init(store_buffer_t* sb, int depth) {
+  *sb = (store_buffer_t){0};
+  sb->depth = (depth > STORE_BUFFER_MAX) ? STORE_BUFFER_MAX : depth;
+}
+
+// retires the head entry into memory and starts the cache write of the next one at `start`
+static void retire_head(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t start) {
+  store_buffer_entry_t* entry = &sb->entries[sb->head];
+  store(memory_p, entry->addr, entry->size, entry->value);
+  sb->head = (sb->head + 1) % STORE_BUFFER_MAX;
+  sb->count--;
+  sb->drained++;
+
+  sb->draining = (sb->count > 0);
+  if (sb->draining) {
+    sb->drain_done = start + data_access_latency(sb->entries[sb->head].addr, 0, CACHE_WRITE, cache_p, start);
+  }
+}
+
+void storebuf_tick(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now) {
+  if (sb->count > 0 && !sb->draining) {
+    sb->draining = true;
+    sb->drain_done = now + data_access_latency(sb->entries[sb->head].addr, 0, CACHE_WRITE, cache_p, now);
+  }
+  while (sb->draining && sb->drain_done <= now) {
+    retire_head(sb, memory_p, cache_p, sb->drain_done);
+  }
+}
+
+uint64_t storebuf_insert(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now, Address addr, Alignment size, Word value) {
+  uint64_t waited = 0;
+
+  storebuf_tick(sb, memory_p, cache_p, now);
+  if (sb->count == sb->depth) {
+    waited = sb->drain_done - now;
+    sb->full_stalls += waited;
+    storebuf_tick(sb, memory_p, cache_p, sb->drain_done);
+  }
+
+  int tail = (sb->head + sb->count) % STORE_BUFFER_MAX;
+  sb->entries[tail].addr = addr;
+  sb->entries[tail].size = size;
+  sb->entries[tail].value = value;
+  sb->count++;
+  sb->inserted++;
+  storebuf_tick(sb, memory_p, cache_p, now + waited);
+  return waited;
+}
+
+// position (0 = head) of the youngest store overlapping [addr, addr+size), or -1
+static int youngest_overlap(const store_buffer_t* sb, Address addr, Alignment size) {
+  for (int i = sb->count - 1; i >= 0; i--) {
+    const store_buffer_entry_t* entry = &sb->entries[(sb->head + i) % STORE_BUFFER_MAX];
+    if (entry->addr < addr + size && addr < entry->addr + entry->size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int storebuf_forward(store_buffer_t* sb, Address addr, Alignment size, Word* value) {
+  int pos = youngest_overlap(sb, addr, size);
+  if (pos < 0) {
+    return SB_FORWARD_NONE;
+  }
+
+  store_buffer_entry_t* entry = &sb->entries[(sb->head + pos) % STORE_BUFFER_MAX];
+  if (addr < entry->addr || addr + size > entry->addr + entry->size) {
+    sb->forward_conflicts++;
+    return SB_FORWARD_CONFLICT;
+  }
+
+  Word shifted = entry->value >> (8 * (addr - entry->addr));
+  *value = (size == LENGTH_WORD) ? shifted : (shifted & ((1u << (8 * size)) - 1));
+  sb->forward_hits++;
+  return SB_FORWARD_HIT;
+}
+
+uint64_t storebuf_drain_conflict(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now, Address addr, Alignment size) {
+  uint64_t t = now;
+  storebuf_tick(sb, memory_p, cache_p, t);
+  while (youngest_overlap(sb, addr, size) >= 0) {
+    t = sb->drain_done;
+    storebuf_tick(sb, memory_p, cache_p, t);
+  }
+  return t;
+}
+
+uint64_t storebuf_drain(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now) {
+  uint64_t t = now;
+  storebuf_tick(sb, memory_p, cache_p, t);
+  while (sb->count > 0) {
+    t = sb->drain_done;
+    storebuf_tick(sb, memory_p, cache_p, t);
+  }
+  return t;
+}
+
+void storebuf_flush(store_buffer_t* sb, Byte* memory_p) {
+  while (sb->count > 0) {
+    store_buffer_entry_t* entry = &sb->entries[sb->head];
+    store(memory_p, entry->addr, entry->size, entry->value);
+    sb->head = (sb->head + 1) % STORE_BUFFER_MAX;
+    sb->count--;
+    sb->drained++;
+  }
+  sb->draining = false;
+}
@@ -0,0 +1,82 @@
+#ifndef __STOREBUF_H__
+#define __STOREBUF_H__
+
+#include "types.h"
+#include "cache.h"
+#include <stdbool.h>
+
+#ifndef STORE_BUFFER_DEPTH
+#define STORE_BUFFER_DEPTH 8   // default depth, -S overrides it
+#endif
+#define STORE_BUFFER_MAX 64
+
+enum storebuf_forward_enum {
+  SB_FORWARD_NONE = 0,     // no buffered store overlaps the load
+  SB_FORWARD_HIT = 1,      // the youngest overlapping store covers the load, data forwarded
+  SB_FORWARD_CONFLICT = 2  // partial overlap, the load must wait for the store to drain
+};
+
+typedef struct
+{
+  Address addr;
+  Alignment size;
+  Word value;
+}store_buffer_entry_t;
+
+typedef struct
+{
+  store_buffer_entry_t entries[STORE_BUFFER_MAX];
+  int depth;
+  int head;
+  int count;
+  bool draining;        // the head entry is writing into the cache
+  uint64_t drain_done;  // cycle the head's cache write completes
+
+  // stats
+  uint64_t inserted;
+  uint64_t drained;
+  uint64_t full_stalls;     // cycles a store waited for a free entry
+  uint64_t forward_hits;
+  uint64_t forward_conflicts;
+}store_buffer_t;
+
+/**
+ * empties the buffer; depth is clamped to STORE_BUFFER_MAX
+ **/
+void storebuf_init(store_buffer_t* sb, int depth);
+
+/**
+ * retires the stores whose cache write has completed by cycle `now` into memory,
+ * starting the next write as soon as the previous one finishes
+ **/
+void storebuf_tick(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now);
+
+/**
+ * queues a store at cycle `now`. If the buffer is full the store waits for the head
+ * to drain; the cycles waited are returned (0 if an entry was free).
+ **/
+uint64_t storebuf_insert(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now, Address addr, Alignment size, Word value);
+
+/**
+ * searches the buffer for a load, youngest store first. On SB_FORWARD_HIT *value
+ * holds the forwarded data.
+ **/
+int storebuf_forward(store_buffer_t* sb, Address addr, Alignment size, Word* value);
+
+/**
+ * drains the buffer up to and including the youngest store that overlaps the load
+ * and returns the cycle that completes
+ **/
+uint64_t storebuf_drain_conflict(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now, Address addr, Alignment size);
+
+/**
+ * drains every buffered store (a fence, before an atomic) and returns the cycle that completes
+ **/
+uint64_t storebuf_drain(store_buffer_t* sb, Byte* memory_p, Cache* cache_p, uint64_t now);
+
+/**
+ * writes every remaining store to memory, used when the simulation ends
+ **/
+void storebuf_flush(store_buffer_t* sb, Byte* memory_p);
+
+#endif // __STOREBUF_H__
@@ -0,0 +1,171 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "cache.h"
+#include "sweep.h"
+#include "multisim.h"
+
+// one unit of work: a single point, or up to MULTISIM_LANES points simulated in lanes
+typedef struct
+{
+  int points[MULTISIM_LANES];
+  int count;
+  bool batched;
+}sweep_job_t;
+
+// jobs owned by one worker: it pops from the tail, thieves take from the head
+typedef struct
+{
+  pthread_mutex_t lock;
+  int *jobs;
+  int head;
+  int tail;
+}sweep_deque_t;
+
+typedef struct
+{
+  sweep_point_t *points;
+  sweep_job_t *jobs;
+  const belady_trace_t *trace;
+  sweep_deque_t *deques;
+  int threads;
+}sweep_pool_t;
+
+typedef struct
+{
+  sweep_pool_t *pool;
+  int id;
+}sweep_worker_t;
+
+static void simulate(sweep_point_t *point, const belady_trace_t *trace) {
+  Cache cache;
+  cache_config(&cache, point->setBits, point->linesPerSet, point->blockBits, point->policy, CACHE_HIT_LATENCY);
+  cacheSetUp(&cache, "sweep");
+  for (size_t i = 0; i < trace->count; i++) {
+    accessCache(trace->addrs[i], trace->types[i], &cache);
+  }
+  point->hits = cache.hit_count;
+  point->misses = cache.miss_count;
+  point->evictions = cache.eviction_count;
+  point->writebacks = cache.writebacks;
+  deallocate(&cache);
+}
+
+// one pass over the trace for all points of a batch; they share setBits and blockBits
+static void simulate_batch(sweep_point_t *points, const sweep_job_t *job, const belady_trace_t *trace) {
+  int ways[MULTISIM_LANES], policies[MULTISIM_LANES];
+  for (int k = 0; k < job->count; k++) {
+    ways[k] = points[job->points[k]].linesPerSet;
+    policies[k] = points[job->points[k]].policy;
+  }
+  sweep_point_t *first = &points[job->points[0]];
+  multisim_t ms;
+  multisim_init(&ms, first->setBits, first->blockBits, ways, policies, job->count);
+  for (size_t i = 0; i < trace->count; i++) {
+    multisim_access(&ms, trace->addrs[i], trace->types[i]);
+  }
+  for (int k = 0; k < job->count; k++) {
+    sweep_point_t *point = &points[job->points[k]];
+    point->hits = ms.hits[k];
+    point->misses = ms.misses[k];
+    point->evictions = ms.evictions[k];
+    point->writebacks = ms.writebacks[k];
+  }
+  multisim_free(&ms);
+}
+
+// next point for worker `id`: its own newest, else the oldest of another worker
+static bool take(sweep_pool_t *pool, int id, int *job) {
+  for (int k = 0; k < pool->threads; k++) {
+    sweep_deque_t *deque = &pool->deques[(id + k) % pool->threads];
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+      *job = (k == 0) ? deque->jobs[--deque->tail] : deque->jobs[deque->head++];
+      found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    if (found) {
+      return true;
+    }
+  }
+  return false;  // no points are added while running, so every deque is drained
+}
+
+static void *worker(void *arg) {
+  sweep_worker_t *self = arg;
+  int job;
+  while (take(self->pool, self->id, &job)) {
+    sweep_job_t *unit = &self->pool->jobs[job];
+    if (unit->batched) {
+      simulate_batch(self->pool->points, unit, self->pool->trace);
+    } else {
+      simulate(&self->pool->points[unit->points[0]], self->pool->trace);
+    }
+  }
+  return NULL;
+}
+
+// groups the points into jobs: points a lane can model share a batch with others of the same geometry
+static int plan_jobs(const sweep_point_t *points, int count, bool batch, sweep_job_t *jobs) {
+  int njobs = 0;
+  for (int p = 0; p < count; p++) {
+    const sweep_point_t *point = &points[p];
+    sweep_job_t *job = NULL;
+    bool lanes = batch && multisim_supports(point->policy);
+    for (int j = 0; lanes && j < njobs && job == NULL; j++) {
+      const sweep_point_t *first = &points[jobs[j].points[0]];
+      if (jobs[j].batched && jobs[j].count < MULTISIM_LANES &&
+          first->setBits == point->setBits && first->blockBits == point->blockBits) {
+        job = &jobs[j];
+      }
+    }
+    if (job == NULL) {
+      job = &jobs[njobs++];
+      job->count = 0;
+      job->batched = lanes;
+    }
+    job->points[job->count++] = p;
+  }
+  return njobs;
+}
+
+void sweep_run(sweep_point_t *points, int count, const belady_trace_t *trace, int threads, bool batch) {
+  if (threads < 1) {
+    threads = 1;
+  }
+  sweep_job_t *jobs = calloc(count + 1, sizeof(sweep_job_t));
+  assert(jobs != NULL);
+  int njobs = plan_jobs(points, count, batch, jobs);
+  sweep_pool_t pool = {points, jobs, trace, calloc(threads, sizeof(sweep_deque_t)), threads};
+  sweep_worker_t *workers = calloc(threads, sizeof(sweep_worker_t));
+  pthread_t *tids = calloc(threads, sizeof(pthread_t));
+  assert(pool.deques != NULL && workers != NULL && tids != NULL);
+
+  for (int t = 0; t < threads; t++) {
+    pthread_mutex_init(&pool.deques[t].lock, NULL);
+    pool.deques[t].jobs = malloc((njobs / threads + 1) * sizeof(int));
+    assert(pool.deques[t].jobs != NULL);
+  }
+  for (int j = 0; j < njobs; j++) {
+    sweep_deque_t *deque = &pool.deques[j % threads];
+    deque->jobs[deque->tail++] = j;
+  }
+
+  for (int t = 0; t < threads; t++) {
+    workers[t].pool = &pool;
+    workers[t].id = t;
+    pthread_create(&tids[t], NULL, worker, &workers[t]);
+  }
+  for (int t = 0; t < threads; t++) {
+    pthread_join(tids[t], NULL);
+  }
+
+  for (int t = 0; t < threads; t++) {
+    pthread_mutex_destroy(&pool.deques[t].lock);
+    free(pool.deques[t].jobs);
+  }
+  free(pool.deques);
+  free(jobs);
+  free(workers);
+  free(tids);
+}
@@ -0,0 +1,34 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdbool.h>
+#include "belady.h"
+
+// one configuration of a design-space sweep and the result of replaying the trace through it
+typedef struct
+{
+  int setBits;
+  int linesPerSet;
+  int blockBits;
+  int policy;   // replace_policy_enum
+
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  unsigned long long writebacks;
+}sweep_point_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * replays `trace` through a fresh cache for every point, on `threads` host threads.
+ * Points are dealt round-robin to per-thread deques; a thread that runs out steals
+ * from the others, so uneven points still keep every thread busy.
+ * With `batch`, LRU, LFU and SRRIP points of the same set count and block size are
+ * simulated together in the lanes of one multisim_t, reading the trace once per batch.
+ **/
+void sweep_run(sweep_point_t *points, int count, const belady_trace_t *trace, int threads, bool batch);
+
+#endif // __SWEEP_H__
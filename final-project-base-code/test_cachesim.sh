@@ -0,0 +1,101 @@
+#!/bin/bash
+# checks of cachesim, run `make cachesim` first
+# the one-pass modes are checked against plain runs of the same trace, so no reference is needed
+
+RED_BOLD='\033[1;31m'
+GREEN_BOLD='\033[1;32m'
+RESET='\033[0m'
+
+OUT=./code/cachesim/out
+mkdir -p $OUT
+failures=0
+
+# check <name> <expected> <actual>
+check() {
+    if [ "$2" == "$3" ]; then
+        echo -e "${GREEN_BOLD}PASS${RESET} $1"
+    else
+        echo -e "${RED_BOLD}FAIL${RESET} $1: expected $2, got $3"
+        failures=$((failures + 1))
+    fi
+}
+
+# misses of a plain run: cachesim <args>
+misses() {
+    ./cachesim "$@" | sed -n 's/.*misses: \([0-9]*\),.*/\1/p'
+}
+
+# lackey trace whose footprint (about 8k blocks of 64 bytes) is larger than the first
+# block map of -D, mixing random accesses with a stream that keeps returning
+awk 'BEGIN {
+    srand(254);
+    for (i = 0; i < 200000; i++) {
+        r = rand();
+        if (r < 0.5)      addr = 268435456 + int(rand() * 524288);
+        else if (r < 0.9) addr = 536870912 + (i * 8) % 65536;
+        else              addr = 805306368 + int(rand() * 16777216);
+        op = (rand() < 0.75) ? "L" : "S";
+        printf " %s %x,4\n", op, addr;
+    }
+}' > $OUT/footprint.trace
+
+# -D: the miss-ratio curve against plain LRU runs of every geometry in it
+./cachesim -D -b 6 -t $OUT/footprint.trace > $OUT/footprint.mrc
+for geometry in "0 1" "0 16" "0 64" "2 4" "4 8" "6 2" "8 16" "10 1"; do
+    set -- $geometry
+    expected=$(misses -s $1 -E $2 -b 6 -t $OUT/footprint.trace)
+    actual=$(awk -v sets=$((1 << $1)) -v ways=$2 '$2 == sets && $3 == ways { print $5 }' $OUT/footprint.mrc)
+    check "-D sets=$((1 << $1)) ways=$2" "$expected" "$actual"
+done
+
+# -S: every row of a sweep against a plain run of its configuration
+./cachesim -S -s 0:4 -E 1,2,4 -b 4,6 -R lru,plru,srrip,random -t $OUT/footprint.trace > $OUT/footprint.csv
+while IFS=, read sets ways block policy bytes hit_latency mem_latency accesses hits misses evictions rest; do
+    [ "$sets" == "sets" ] && continue
+    setBits=$(awk -v n=$sets 'BEGIN { print int(log(n) / log(2) + 0.5) }')
+    blockBits=$(awk -v n=$block 'BEGIN { print int(log(n) / log(2) + 0.5) }')
+    expected=$(./cachesim -s $setBits -E $ways -b $blockBits -R $policy -t $OUT/footprint.trace)
+    check "-S sets=$sets ways=$ways block=$block $policy" "$expected" "L1 hits: $hits, misses: $misses, evictions: $evictions"
+done < $OUT/footprint.csv
+
+# -H: the three classes add up to the misses, and the compulsory ones are the first touches
+for geometry in "4 4" "0 64" "8 1"; do
+    set -- $geometry
+    ./cachesim -H -s $1 -E $2 -b 6 -t $OUT/footprint.trace > $OUT/footprint.3c
+    expected=$(sed -n 's/.*misses: \([0-9]*\),.*/\1/p' $OUT/footprint.3c)
+    actual=$(awk '$2 == "compulsory" || $2 == "capacity" || $2 == "conflict" { sum += $4 } END { print sum }' $OUT/footprint.3c)
+    check "-H -s $1 -E $2 classes" "$expected" "$actual"
+    expected=$(awk '$1 == "#REUSE" && $2 == "first" { print $3 }' $OUT/footprint.3c)
+    actual=$(awk '$2 == "compulsory" { print $4 }' $OUT/footprint.3c)
+    check "-H -s $1 -E $2 compulsory" "$expected" "$actual"
+done
+# a fully associative LRU cache has no conflict misses
+actual=$(./cachesim -H -s 0 -E 64 -b 6 -t $OUT/footprint.trace | awk '$2 == "conflict" { print $4 }')
+check "-H fully associative conflicts" "0" "$actual"
+
+# -H on a fixed trace against its reference
+./cachesim -H -s 4 -E 4 -b 6 -t ./code/cachesim/input/mix.trace > $OUT/mix.3c
+check "-H reference" "" "$(diff ./code/cachesim/ref/mix.3c $OUT/mix.3c)"
+
+# -V: a victim cache only turns L1 misses into victim hits, it does not change the L1 evictions
+for geometry in "2 1 4" "4 2 8" "6 4 16"; do
+    set -- $geometry
+    plain=$(./cachesim -s $1 -E $2 -b 6 -t $OUT/footprint.trace)
+    ./cachesim -s $1 -E $2 -b 6 -V $3 -t $OUT/footprint.trace > $OUT/footprint.victim
+    victim_hits=$(sed -n 's/.*victim cache hits: \([0-9]*\) of.*/\1/p' $OUT/footprint.victim)
+    expected=$(echo "$plain" | awk -F'[:,] *' -v v=$victim_hits '{ print $2 + v, $4 - v, $6 }')
+    actual=$(awk -F'[:,] *' 'NR == 1 { print $2, $4, $6 }' $OUT/footprint.victim)
+    check "-V $3 -s $1 -E $2" "$expected" "$actual"
+done
+
+# -V on a fixed trace against its reference
+for geometry in "-s 2 -E 2 -b 4 -V 4" "-s 4 -E 1 -b 6 -V 8" "-s 3 -E 4 -b 5 -V 2 -R srrip"; do
+    echo "$geometry"
+    ./cachesim $geometry -t ./code/cachesim/input/mix.trace
+done > $OUT/mix.victim
+check "-V reference" "" "$(diff ./code/cachesim/ref/mix.victim $OUT/mix.victim)"
+
+if [ $failures -ne 0 ]; then
+    echo -e "${RED_BOLD}$failures check(s) failed${RESET}"
+    exit 1
+fi
@@ -0,0 +1,39 @@
+#!/bin/bash
+# checks of the multi-core simulator (-N), run `make riscv` first
+# lockstep runs must be reproducible, so each program is checked against a second run of itself
+
+RED_BOLD='\033[1;31m'
+GREEN_BOLD='\033[1;32m'
+RESET='\033[0m'
+
+OUT=./code/out/multicore
+mkdir -p $OUT
+failures=0
+
+# stats of a run: stats <name> <args>, the lines of the trace before them are dropped
+stats() {
+    local name=$1
+    shift
+    ./riscv "$@" | sed -n '/^#/p' > $OUT/$name.stats
+}
+
+# reproducible <name> <args>: two runs print the same stats
+reproducible() {
+    local name=$1
+    shift
+    stats $name.1 "$@"
+    stats $name.2 "$@"
+    if [ -s $OUT/$name.1.stats ] && diff -q $OUT/$name.1.stats $OUT/$name.2.stats > /dev/null; then
+        echo -e "${GREEN_BOLD}PASS${RESET} $name"
+    else
+        echo -e "${RED_BOLD}FAIL${RESET} $name: the stats of two runs differ"
+        diff $OUT/$name.1.stats $OUT/$name.2.stats
+        failures=$((failures + 1))
+    fi
+}
+
+reproducible vec_xprod_tiny.N2 -s -e -f -c -N 2 code/ms2/input/vec_xprod_tiny.input
+reproducible vec_xprod_tiny.N3 -s -e -f -c -N 3 code/ms2/input/vec_xprod_tiny.input
+reproducible vec_xprod_tiny.N4 -s -e -f -c -N 4 code/ms2/input/vec_xprod_tiny.input
+
+exit $failures
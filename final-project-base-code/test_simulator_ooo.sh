@@ -0,0 +1,11 @@
+# tests of the out-of-order core (-o), not scored
+# remember to update config.h before running this: DEBUG_REG_TRACE and PRINT_STATS only, MEM_LATENCY 0
+mkdir -p ./code/ooo/out
+
+./riscv -o -s -e ./code/ms2/input/multiply.input > ./code/ooo/out/multiply.trace
+echo "diff ./code/ooo/ref/multiply.trace ./code/ooo/out/multiply.trace"
+diff ./code/ooo/ref/multiply.trace ./code/ooo/out/multiply.trace
+
+./riscv -o -s -e -w 4 -u ./code/ms2/input/random.input > ./code/ooo/out/random.trace
+echo "diff ./code/ooo/ref/random.trace ./code/ooo/out/random.trace"
+diff ./code/ooo/ref/random.trace ./code/ooo/out/random.trace
@@ -0,0 +1,113 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace.h"
+
+bool trace_open(trace_reader_t *reader, const char *path) {
+  memset(reader, 0, sizeof(*reader));
+  reader->fd = open(path, O_RDONLY);
+  if (reader->fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(reader->fd, &st) < 0) {
+    close(reader->fd);
+    return false;
+  }
+  reader->length = st.st_size;
+  if (reader->length > 0) {
+    void *data = mmap(NULL, reader->length, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+    if (data == MAP_FAILED) {
+      close(reader->fd);
+      return false;
+    }
+    madvise(data, reader->length, MADV_SEQUENTIAL);  // read once, front to back
+    reader->data = data;
+  }
+
+  reader->binary = reader->length >= TRACE_MAGIC_SIZE
+                   && memcmp(reader->data, TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0;
+  reader->pos = reader->binary ? TRACE_MAGIC_SIZE : 0;
+  return true;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// parses one lackey line starting at `line`; false if it is not an access
+static bool parse_lackey(const char *line, const char *end, trace_record_t *record) {
+  const char *p = line;
+  while (p < end && *p == ' ') p++;
+  if (p >= end || (*p != TRACE_INSTR && *p != TRACE_LOAD && *p != TRACE_STORE && *p != TRACE_MODIFY)) {
+    return false;
+  }
+  record->op = *p++;
+  if (p >= end || *p != ' ') {
+    return false;
+  }
+  while (p < end && *p == ' ') p++;
+
+  uint64_t addr = 0;
+  int digits = 0;
+  for (int d; p < end && (d = hex_digit(*p)) >= 0; p++, digits++) {
+    addr = (addr << 4) | d;
+  }
+  if (digits == 0 || p >= end || *p != ',') {
+    return false;
+  }
+  p++;
+
+  uint32_t size = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    size = size * 10 + (*p - '0');
+  }
+  record->addr = addr;
+  record->size = size;
+  return true;
+}
+
+bool trace_next(trace_reader_t *reader, trace_record_t *record) {
+  if (reader->binary) {
+    if (reader->pos + sizeof(*record) > reader->length) {
+      return false;
+    }
+    memcpy(record, reader->data + reader->pos, sizeof(*record));
+    reader->pos += sizeof(*record);
+    return true;
+  }
+
+  while (reader->pos < reader->length) {
+    const char *line = reader->data + reader->pos;
+    const char *eol = memchr(line, '\n', reader->length - reader->pos);
+    const char *end = (eol != NULL) ? eol : reader->data + reader->length;
+    reader->pos = end - reader->data + 1;
+    if (parse_lackey(line, end, record)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void trace_close(trace_reader_t *reader) {
+  if (reader->data != NULL) {
+    munmap((void *)reader->data, reader->length);
+  }
+  close(reader->fd);
+  reader->data = NULL;
+}
+
+void trace_write_header(FILE *out) {
+  fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, out);
+}
+
+void trace_write_record(FILE *out, uint64_t addr, uint32_t size, uint32_t op) {
+  trace_record_t record = {addr, size, op};
+  fwrite(&record, sizeof(record), 1, out);
+}
@@ -0,0 +1,68 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Memory address traces, read by cachesim
+///
+/// Two formats are accepted:
+///   - valgrind lackey (--tool=lackey --trace-mem=yes): lines such as
+///     "I  04000000,3", " L 7ff000398,8", " S ...", " M ..."; other lines are skipped.
+///   - binary: TRACE_MAGIC followed by trace_record_t records in host byte order,
+///     as written by riscv -T and cachesim -w.
+///////////////////////////////////////////////////////////////////////////////
+
+#define TRACE_MAGIC "RVCTRC01"
+#define TRACE_MAGIC_SIZE 8
+
+enum trace_op_enum {
+  TRACE_INSTR = 'I',
+  TRACE_LOAD = 'L',
+  TRACE_STORE = 'S',
+  TRACE_MODIFY = 'M'   // a load and a store to the same address
+};
+
+typedef struct
+{
+  uint64_t addr;
+  uint32_t size;  // bytes accessed, 0 if unknown
+  uint32_t op;    // trace_op_enum
+}trace_record_t;
+
+typedef struct
+{
+  const char *data;  // the whole file, mapped read-only
+  size_t length;
+  size_t pos;
+  bool binary;
+  int fd;
+}trace_reader_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Function definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * maps the trace at `path` and detects its format.
+ * output : false if the file cannot be opened or mapped
+ **/
+bool trace_open(trace_reader_t *reader, const char *path);
+
+/**
+ * output : false at the end of the trace, otherwise *record holds the next access
+ **/
+bool trace_next(trace_reader_t *reader, trace_record_t *record);
+
+void trace_close(trace_reader_t *reader);
+
+/**
+ * writes the binary header, then one record per call
+ **/
+void trace_write_header(FILE *out);
+void trace_write_record(FILE *out, uint64_t addr, uint32_t size, uint32_t op);
+
+#endif // __TRACE_H__
@@ -18,8 +18,9 @@ Instruction parse_instruction(uint32_t instruction_bits) {
   instruction_bits >>= 7;
 
   switch (instruction.opcode) {
-  // R-Type
+  // R-Type, and the atomics (RV32A), which share its layout
   case 0x33:
+  case 0x2F:
     // instruction: 0000 0001 0101 1010 0000 0100 1, destination : 01001
     instruction.rtype.rd = instruction_bits & ((1U << 5) - 1);
     instruction_bits >>= 5;
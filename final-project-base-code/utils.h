@@ -10,9 +10,14 @@
 #define JAL_FORMAT "jal\tx%d, %d\n"
 #define BRANCH_FORMAT "%s\tx%d, x%d, %d\n"
 #define ECALL_FORMAT "ecall\n"
+#define AMO_FORMAT "%s\tx%d, x%d, (x%d)\n"
+#define LR_FORMAT "%s\tx%d, (x%d)\n"
 #define CACHE_EVICTION_FORMAT "[MEM]: Cache eviction for address: 0x%.8llx\n"
 #define CACHE_HIT_FORMAT "[MEM]: Cache hit for address: 0x%.8llx\n"
 #define CACHE_MISS_FORMAT "[MEM]: Cache miss for address: 0x%.8llx\n"
+#define ICACHE_EVICTION_FORMAT "[IF ]: I-cache eviction for address: 0x%.8llx\n"
+#define ICACHE_HIT_FORMAT "[IF ]: I-cache hit for address: 0x%.8llx\n"
+#define ICACHE_MISS_FORMAT "[IF ]: I-cache miss for address: 0x%.8llx\n"
 
 Instruction parse_instruction(uint32_t);
 int sign_extend_number(unsigned, unsigned);